@@ -1,6 +1,8 @@
 #ifndef ADAPTER_H
 #define ADAPTER_H
 
+#include <stdint.h>
+
 typedef enum adapter_state_e {
     STATE_NONE,
     STATE_INIT,
@@ -10,15 +12,57 @@ typedef enum adapter_state_e {
     STATE_POWER_OFF,
 } adapter_state_t;
 
+#define ANNOUNCE_MIN_INTERVAL_MS 50
 #define ANNOUNCE_INTERVAL_MS 2000
 #define VELOCITY_THRESH 10
 #define TRIGGER_HOLD_MS 40
 #define ON_DELAY_MS 20
+#define XBOX_RUNNING_POLL_INTERVAL_MS 16
 
 #define ENDPOINT_DIR_OUT 0x00
 #define ENDPOINT_DIR_IN 0x80
 
+#define SYS_CLOCK_KHZ 120000
+// PIO-USB needs SYS_CLOCK_KHZ, but the host port is powered off while the console sleeps
+#define SLEEP_SYS_CLOCK_KHZ 48000
+
+#define DEBUG_UART_ID uart1
+#define DEBUG_UART_BAUD 115200
+#define TRACE_UART_BAUD 921600
+#define DEBUG_UART_TX_PIN 24
+#define DEBUG_UART_RX_PIN 25
+
+#define SERIAL_MIDI_BAUD 31250
+
 #define ADAPTER_OUT_INTERVAL 4
 #define ADAPTER_IN_INTERVAL 4
+// what both get asked for instead with OPENRB_FAST_POLL, see inc/usb_descriptors.h
+#define ADAPTER_FAST_INTERVAL 1
+
+// first hit in a drum report to that report completing on the wire - every report is held back
+// ON_DELAY_MS, then can wait a poll for the coalescing window and another for the host to ask
+#define HIT_LATENCY_BUDGET_US(interval) ((ON_DELAY_MS + 2 * (interval)) * 1000)
+
+// one IN transaction to the next while reports are queued back to back, a poll that comes more
+// than half a frame late counts against the console
+#define IN_POLL_BUDGET_US(interval) ((interval) * 1000 + 500)
+
+// src/adapter.c - the console handshake, controller traffic and the core 0 tasks that move us
+// between states, kept apart from main.c's chip bring-up so test/ can run it on a host
+
+// core 0, the end of init - announcing starts once the console and a controller are both there
+void adapter_start();
+
+// core 0, runs whatever tasks events_wait handed back
+void adapter_run_tasks(uint32_t tasks);
+
+// core 0 only
+void power_task();
+void control_task();
+void announce_task();
+
+// core 0, once core 1's been reset to restart the usb host - lets go of whatever it held, starts
+// its queues over and unmounts the controllers, tinyusb won't be around to
+void adapter_core1_reset();
 
 #endif  // ADAPTER_H
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef ORB_BENCH_H_
+#define ORB_BENCH_H_
+
+#include <stdint.h>
+
+// set by the OPENRB_BENCH cmake option, builds an image that runs the benchmarks below and prints
+// one json object per line on the debug uart instead of running the adapter. test/bench.c runs the
+// same ones natively against the host build and prints the same lines
+#ifndef OPENRB_BENCH_ENABLED
+#define OPENRB_BENCH_ENABLED 0
+#endif
+
+#if OPENRB_BENCH_ENABLED
+
+#include <stdbool.h>
+
+// set for the host build's bench (test/bench.c), the same benches timed natively
+#ifndef OPENRB_BENCH_NATIVE
+#define OPENRB_BENCH_NATIVE 0
+#endif
+
+#if !OPENRB_BENCH_NATIVE
+#include <hardware/structs/systick.h>
+#include <hardware/structs/xip_ctrl.h>
+#endif
+
+#define BENCH_ITERATIONS 1000
+
+// natively a cycle is a host nanosecond, and there's no xip cache or second core
+typedef struct {
+    const char *name;
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    bool cold;       // the xip cache is flushed before every sample
+    bool contended;  // core 1 ran bench.c's report copy loop the whole time
+    uint32_t xip_accesses;
+    uint32_t xip_hits;
+} bench_t;
+
+#if OPENRB_BENCH_NATIVE
+// the host's monotonic clock in ns, counting up - test/host/bench.c
+uint32_t bench_now();
+
+static inline uint32_t bench_start(bench_t *bench) {
+    (void)bench;
+    return bench_now();
+}
+#else
+// systick counts core clock cycles down from 2^24, which is plenty for one call of anything here
+static inline uint32_t bench_now() { return systick_hw->cvr; }
+
+// call right before the code being measured and hand the result to bench_sample(), the xip cache
+// counters then only see what ran in between
+static inline uint32_t bench_start(bench_t *bench) {
+    if (bench->cold) {
+        xip_ctrl_hw->flush = 1;
+        (void)xip_ctrl_hw->flush;  // the read stalls until the flush is done
+    }
+    xip_ctrl_hw->ctr_acc = 0;
+    xip_ctrl_hw->ctr_hit = 0;
+    return bench_now();
+}
+#endif
+
+void bench_begin(bench_t *bench, const char *name);
+// records one sample from a bench_start() or bench_now() taken right before the code being measured
+void bench_sample(bench_t *bench, uint32_t start);
+void bench_end(bench_t *bench);
+
+// the adapter's main() hands over to this when OPENRB_BENCH_ENABLED, it never returns, every bench
+// runs three times - warm, cold and contended
+void bench_main();
+
+// each module benchmarks its own static hot paths
+void drums_bench();
+void serial_midi_bench();
+void midi_parser_bench();
+void xbox_one_protocol_bench();
+void packet_queue_bench();
+
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef ORB_BOOT_REPORT_H_
+#define ORB_BOOT_REPORT_H_
+
+#include <stdint.h>
+
+typedef enum {
+    FIRST_BOOT_PHASE,
+    BOOT_PHASE_CLOCKS = FIRST_BOOT_PHASE,
+    BOOT_PHASE_TUD_INIT,
+    BOOT_PHASE_HOST_ENUMERATED,
+    BOOT_PHASE_ANNOUNCE,
+    BOOT_PHASE_IDENTIFY,
+    BOOT_PHASE_AUTH,
+    BOOT_PHASE_RUNNING,
+    N_BOOT_PHASES,
+} boot_phase_e;
+
+// records the first time (us since boot) a phase was reached, later calls are ignored
+void boot_report_mark(boot_phase_e phase);
+
+// returns 0 if the phase hasn't been reached yet
+uint32_t boot_report_get(boot_phase_e phase);
+
+void boot_report_print();
+
+#endif
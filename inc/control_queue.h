@@ -0,0 +1,34 @@
+#ifndef ORB_CONTROL_QUEUE_H_
+#define ORB_CONTROL_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// hot-plug changes, posted from anywhere and applied by TASK_CONTROL on core 0 so only core 0 ever
+// writes the instrument table, the controller slots or the packets that announce them
+typedef enum {
+    CONTROL_CONNECT,               // arg is an instruments_e
+    CONTROL_DISCONNECT,            // arg is an instruments_e
+    CONTROL_CONTROLLER_MOUNTED,    // arg is the host driver instance, addr its device address
+    CONTROL_CONTROLLER_UNMOUNTED,  // arg is the host driver instance, addr its device address
+    N_CONTROLS,
+} control_e;
+
+typedef struct {
+    uint8_t type;
+    uint8_t arg;
+    uint8_t addr;  // only for the controller events
+} control_event_t;
+
+// safe from any context on either core and never waits on the other core, returns false (and
+// counts it in STAT_CONTROL_DROPPED) if the posting core's queue is full
+bool control_post(control_e type, uint8_t arg, uint8_t addr);
+
+// core 0 only - takes the next event, events keep their order per posting core
+bool control_read(control_event_t *event);
+
+// core 0, once core 1's been reset and control_read has had everything it posted - starts its
+// queue over
+void control_core1_reset();
+
+#endif
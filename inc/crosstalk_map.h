@@ -0,0 +1,5 @@
+#if defined(CUSTOM_CROSSTALK_MAP)
+#include CUSTOM_CROSSTALK_MAP
+#else
+#include "default_crosstalk_mapping.tbl"
+#endif  // CUSTOM_CROSSTALK_MAP
@@ -77,7 +77,8 @@ extern "C" {
 #define CFG_TUD_XINPUT_RX_BUFSIZE 64
 
 #define CFG_TUH_XINPUT 1
-#define CFG_TUH_DEVICE_MAX (2)
+// every controller plus the midi device
+#define CFG_TUH_DEVICE_MAX (4)
 
 // #define CFG_TUH_CDC 1
 // #define CFG_TUD_HID 1
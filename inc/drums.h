@@ -1,6 +1,36 @@
 #ifndef ORB_DRUMS_H_
 #define ORB_DRUMS_H_
 
+#include <stdint.h>
+
+// the lanes the midi map sends notes to, what TRACE_NOTE_ON and TRACE_NOTE_OFF carry
+typedef enum {
+    FIRST_OUT,
+    OUT_KICK = FIRST_OUT,
+    OUT_DOUBLE_KICK,
+    OUT_PAD_RED,
+    OUT_PAD_YELLOW,
+    OUT_PAD_BLUE,
+    OUT_PAD_GREEN,
+    OUT_CYM_YELLOW,
+    OUT_CYM_BLUE,
+    OUT_CYM_GREEN,
+    LAST_OUT = OUT_CYM_GREEN,
+    NUM_OUT,
+    NO_OUT,
+} output_e;
+
+// why a note on didn't make it onto an output, TRACE_HIT_DROPPED's arg1 - crosstalk has its own
+// event, TRACE_CROSSTALK
+typedef enum {
+    HIT_DROP_THRESHOLD,
+    HIT_DROP_UNMAPPED,
+    HIT_DROP_HOLD,
+} hit_drop_e;
+
 void drum_task();
 
+// feeds a hit through the same path as a kit's note on, the caller posts TASK_DRUM
+void drums_inject_note(uint8_t note, uint8_t velocity);
+
 #endif
@@ -0,0 +1,43 @@
+#ifndef ORB_EVENTS_H_
+#define ORB_EVENTS_H_
+
+#include <stdint.h>
+
+#include "timebase.h"
+
+// everything main's loop on core 0 can run - a task only runs once something marks it ready
+typedef enum {
+    FIRST_TASK,
+    TASK_USB_DEVICE = FIRST_TASK,
+    TASK_POWER,
+    TASK_ANNOUNCE,
+    TASK_SEND,
+    TASK_DRUM,
+    TASK_TRACE,
+    TASK_LOADGEN,
+    TASK_CONTROL,
+    TASK_SUPERVISOR,
+    N_TASKS,
+} task_e;
+
+#define TASK_BIT(task) (1u << (task))
+#define ALL_TASKS (TASK_BIT(N_TASKS) - 1)
+
+// core 0, before core 1 is launched
+void events_init();
+
+// safe from any context on either core, core 1 rings core 0's doorbell through the sio fifo
+void events_post(task_e task);
+void events_post_mask(uint32_t tasks);
+
+// core 0, once core 1's been reset - it may have gone while holding the lock its posts take
+void events_core1_reset();
+
+// core 0 only - mark a task ready once timebase_now() reaches deadline, an earlier deadline for
+// the same task replaces a later one
+void events_post_at(task_e task, timebase_us_t deadline);
+
+// core 0 only - sleeps in wfe until at least one task is ready, returns (and clears) the ready set
+uint32_t events_wait();
+
+#endif
@@ -6,8 +6,11 @@
 #include <common/tusb_fifo.h>
 // clang-format on
 
+#include "hot_path.h"
+
 #define GENERIC_FIFO_EXPORTS(name, type)            \
     void name##_fifo_init();                        \
+    void name##_fifo_init_mutexes();                \
     uint32_t name##_fifo_read(type *buffer);        \
     uint32_t name##_fifo_peek(type *buffer);        \
     void name##_fifo_advance();                     \
@@ -17,7 +20,8 @@
     bool name##_fifo_full();                        \
     void name##_fifo_clear();
 
-#define CREATE_GENERIC_FIFO(name, type, size, rd_mtx, wr_mtx)                                    \
+// on_write(written) is called after every write attempt, from whatever context did the write
+#define CREATE_GENERIC_FIFO(name, type, size, rd_mtx, wr_mtx, on_write)                          \
     static struct {                                                                              \
         tu_fifo_t fifo;                                                                          \
         type buffer[size];                                                                       \
@@ -25,8 +29,8 @@
         osal_mutex_def_t rd_mutex;                                                               \
     } fifo;                                                                                      \
                                                                                                  \
-    void name##_fifo_init() {                                                                    \
-        tu_fifo_config(&fifo.fifo, fifo.buffer, size, sizeof(type), false);                      \
+    /* on its own after a core was reset, it may have gone holding one */                        \
+    void name##_fifo_init_mutexes() {                                                            \
         osal_mutex_t write_mtx = NULL;                                                           \
         if (wr_mtx) {                                                                            \
             write_mtx = osal_mutex_create(&fifo.wr_mutex);                                       \
@@ -37,11 +41,25 @@
         }                                                                                        \
         tu_fifo_config_mutex(&fifo.fifo, write_mtx, read_mtx);                                   \
     }                                                                                            \
-    uint32_t name##_fifo_read(type *buffer) { return tu_fifo_read(&fifo.fifo, buffer); }         \
-    uint32_t name##_fifo_peek(type *buffer) { return tu_fifo_peek(&fifo.fifo, buffer); }         \
-    void name##_fifo_advance() { return tu_fifo_advance_read_pointer(&fifo.fifo, 1); }           \
-    uint32_t name##_fifo_write(const type *buffer) { return tu_fifo_write(&fifo.fifo, buffer); } \
-    uint32_t name##_fifo_count() { return tu_fifo_count(&fifo.fifo); }                           \
+    void name##_fifo_init() {                                                                    \
+        tu_fifo_config(&fifo.fifo, fifo.buffer, size, sizeof(type), false);                      \
+        name##_fifo_init_mutexes();                                                              \
+    }                                                                                            \
+    uint32_t OPENRB_HOT_FUNC(name##_fifo_read)(type *buffer) {                                   \
+        return tu_fifo_read(&fifo.fifo, buffer);                                                 \
+    }                                                                                            \
+    uint32_t OPENRB_HOT_FUNC(name##_fifo_peek)(type *buffer) {                                   \
+        return tu_fifo_peek(&fifo.fifo, buffer);                                                 \
+    }                                                                                            \
+    void OPENRB_HOT_FUNC(name##_fifo_advance)() {                                                \
+        return tu_fifo_advance_read_pointer(&fifo.fifo, 1);                                      \
+    }                                                                                            \
+    uint32_t OPENRB_HOT_FUNC(name##_fifo_write)(const type *buffer) {                            \
+        uint32_t written = tu_fifo_write(&fifo.fifo, buffer);                                    \
+        on_write(written);                                                                       \
+        return written;                                                                          \
+    }                                                                                            \
+    uint32_t OPENRB_HOT_FUNC(name##_fifo_count)() { return tu_fifo_count(&fifo.fifo); }          \
     bool name##_fifo_empty() { return tu_fifo_empty(&fifo.fifo); }                               \
     bool name##_fifo_full() { return tu_fifo_full(&fifo.fifo); }                                 \
     void name##_fifo_clear() { tu_fifo_clear(&fifo.fifo); }
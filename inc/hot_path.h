@@ -0,0 +1,44 @@
+#ifndef ORB_HOT_PATH_H_
+#define ORB_HOT_PATH_H_
+
+#include <pico/platform.h>
+
+// set by the OPENRB_RAM_HOT_PATH cmake option, runs everything between a pad hit (or a controller
+// report) and the packet reaching the console out of sram so it never stalls on an xip cache miss,
+// core 1's pio-usb shares that cache and evicts us whenever it likes
+#ifndef OPENRB_RAM_HOT_PATH_ENABLED
+#define OPENRB_RAM_HOT_PATH_ENABLED 0
+#endif
+
+#if OPENRB_RAM_HOT_PATH_ENABLED
+// wraps the function name in a definition, e.g. void OPENRB_HOT_FUNC(drum_task)() {
+#define OPENRB_HOT_FUNC(name) __not_in_flash_func(name)
+// for const tables the hot path reads, they get copied to sram with .data at boot
+#define OPENRB_HOT_DATA __not_in_flash("openrb_hot")
+#else
+#define OPENRB_HOT_FUNC(name) name
+#define OPENRB_HOT_DATA __in_flash()
+#endif
+
+// set by the OPENRB_SCRATCH_BANKS cmake option (on by default), each core keeps its own state in
+// the scratch bank that already holds its stack - core 0's in scratch y, core 1's in scratch x -
+// so neither core's accesses can stall on the other's, anything both cores touch (the xbox fifo,
+// controller slots, the host driver's interfaces, stats) stays in striped main sram where
+// consecutive words land in different banks. each scratch bank is 4k and the stack takes
+// PICO_STACK_SIZE / PICO_CORE1_STACK_SIZE (2k) of it, the link fails if what's placed here
+// outgrows the rest. tinyusb's usbh and pio-usb's state stay where the sdk links them: core 0
+// goes through usbh's endpoint state whenever it forwards an auth frame, and pio-usb's endpoint
+// pool alone is bigger than what scratch x has left next to core 1's stack
+#ifndef OPENRB_SCRATCH_BANKS_ENABLED
+#define OPENRB_SCRATCH_BANKS_ENABLED 0
+#endif
+
+#if OPENRB_SCRATCH_BANKS_ENABLED
+#define OPENRB_CORE0_DATA __scratch_y("openrb_core0")
+#define OPENRB_CORE1_DATA __scratch_x("openrb_core1")
+#else
+#define OPENRB_CORE0_DATA
+#define OPENRB_CORE1_DATA
+#endif
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef ORB_INSTRUMENT_MANAGER_H_
 #define ORB_INSTRUMENT_MANAGER_H_
 
+#include <stdbool.h>
+
 typedef enum {
     FIRST_INSTRUMENT,
     GUITAR_ONE = FIRST_INSTRUMENT,
@@ -9,9 +11,17 @@ typedef enum {
     N_INSTRUMENTS,
 } instruments_e;
 
+// core 0 only
 void notify_xbox_of_all_instruments();
 void notify_xbox_of_single_instrumenty(instruments_e instrument);
+
+// safe from any context on either core, posted to the control queue and applied on core 0
 void connect_instrument(instruments_e instrument);
 void disconnect_instrument(instruments_e instrument);
 
+// core 0 only - what TASK_CONTROL does with a connect or disconnect, tells the console if we're
+// running
+void instrument_set_connected(instruments_e instrument, bool connected);
+bool instrument_is_connected(instruments_e instrument);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef ORB_LOADGEN_H_
+#define ORB_LOADGEN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// vendor request (device recipient, OUT) whose data stage is a loadgen_config_t, see
+// tools/openrb_loadgen.py
+#define LOADGEN_VENDOR_REQUEST 0xA1
+#define LOADGEN_PADS 8
+
+typedef enum {
+    LOADGEN_OFF,
+    LOADGEN_PATTERN,  // every pad fires on its own fixed interval
+    LOADGEN_RANDOM,   // intervals jitter uniformly between half and one and a half times the setting
+    N_LOADGEN_MODES,
+} loadgen_mode_e;
+
+// keep tools/openrb_loadgen.py in sync
+typedef struct {
+    uint8_t mode;
+    uint8_t velocity;
+    uint8_t burst_hits;             // hits per pad before pausing for burst_gap_ms, 0 never pauses
+    uint8_t controller_interval_ms; // synthetic controller reports mixed in, 0 for none
+    uint16_t burst_gap_ms;
+    uint16_t pad_interval_ms[LOADGEN_PADS];  // 0 leaves that pad quiet
+    uint8_t notes[LOADGEN_PADS];             // midi notes, mapped through the midi map like a kit's
+} __attribute__((packed)) loadgen_config_t;
+
+// safe from the usb device task, takes effect on the next loadgen_task
+void loadgen_configure(const loadgen_config_t *config);
+bool loadgen_active();
+
+// core 0, TASK_LOADGEN
+void loadgen_task();
+
+// drums.c reports the hits it accepted, the device driver the ones that reached the console - a
+// hit only counts as reported once the IN transfer carrying it completes
+void loadgen_hit_accepted();
+void loadgen_hits_reported(uint32_t hits);
+
+uint32_t loadgen_generated();
+uint32_t loadgen_accepted();
+uint32_t loadgen_reported();
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef ORB_MIDI_PARSER_H_
+#define ORB_MIDI_PARSER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    InvalidType = 0x00,                      ///< For notifying errors
+    NoteOff = 0x80,                          ///< Channel Message - Note Off
+    NoteOn = 0x90,                           ///< Channel Message - Note On
+    AfterTouchPoly = 0xA0,                   ///< Channel Message - Polyphonic AfterTouch
+    ControlChange = 0xB0,                    ///< Channel Message - Control Change / Channel Mode
+    ProgramChange = 0xC0,                    ///< Channel Message - Program Change
+    AfterTouchChannel = 0xD0,                ///< Channel Message - Channel (monophonic) AfterTouch
+    PitchBend = 0xE0,                        ///< Channel Message - Pitch Bend
+    SystemExclusive = 0xF0,                  ///< System Exclusive
+    SystemExclusiveStart = SystemExclusive,  ///< System Exclusive Start
+    TimeCodeQuarterFrame = 0xF1,             ///< System Common - MIDI Time Code Quarter Frame
+    SongPosition = 0xF2,                     ///< System Common - Song Position Pointer
+    SongSelect = 0xF3,                       ///< System Common - Song Select
+    Undefined_F4 = 0xF4,
+    Undefined_F5 = 0xF5,
+    TuneRequest = 0xF6,         ///< System Common - Tune Request
+    SystemExclusiveEnd = 0xF7,  ///< System Exclusive End
+    Clock = 0xF8,               ///< System Real Time - Timing Clock
+    Undefined_F9 = 0xF9,
+    Tick = Undefined_F9,  ///< System Real Time - Timing Tick (1 tick = 10 milliseconds)
+    Start = 0xFA,         ///< System Real Time - Start
+    Continue = 0xFB,      ///< System Real Time - Continue
+    Stop = 0xFC,          ///< System Real Time - Stop
+    Undefined_FD = 0xFD,
+    ActiveSensing = 0xFE,  ///< System Real Time - Active Sensing
+    SystemReset = 0xFF,    ///< System Real Time - System Reset
+} midi_type_e;
+
+typedef struct {
+    midi_type_e type;  // channel nibble stripped, a NoteOn with velocity 0 comes out as NoteOff
+    uint8_t channel;
+    uint8_t data1;
+    uint8_t data2;
+} midi_event_t;
+
+// one per byte stream, the serial port and each usb device keep their own
+typedef struct {
+    uint8_t status;    // status of the message being collected, kept across messages as running
+                       // status for channel messages, 0 when there's nothing to collect for
+    uint8_t expected;  // data bytes the status takes
+    uint8_t count;
+    uint8_t data[2];
+    bool in_sysex;
+} midi_parser_t;
+
+void midi_parser_init(midi_parser_t *parser);
+
+midi_type_e midi_get_type_from_status(uint8_t status);
+
+// returns true and fills event when byte completes a message, realtime bytes complete on their own
+// and can land anywhere without disturbing the message they interrupt, sysex is skipped
+bool midi_parse_byte(midi_parser_t *parser, uint8_t byte, midi_event_t *event);
+
+// parses until len bytes are used up or max_events are out, returns the number of events and sets
+// consumed to the bytes it got through
+uint8_t midi_parse(midi_parser_t *parser, const uint8_t *bytes, uint32_t len, midi_event_t *events,
+                   uint8_t max_events, uint32_t *consumed);
+
+#endif
@@ -3,6 +3,13 @@
 
 #define OPENRB_DEBUG_ENABLED 0
 
+// binary event trace (see trace.h), cheap enough to leave on in release builds
+#define OPENRB_TRACE_ENABLED 1
+
+#if OPENRB_DEBUG_ENABLED && OPENRB_TRACE_ENABLED
+#error "printf debugging and the binary trace share the debug uart, only enable one of them"
+#endif
+
 #if OPENRB_DEBUG_ENABLED
 #include <stdio.h>
 
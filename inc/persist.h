@@ -0,0 +1,81 @@
+#ifndef ORB_PERSIST_H_
+#define ORB_PERSIST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "timebase.h"
+
+// vendor request (device recipient, IN) that returns a persist_record_t, wIndex 0 is this boot's
+// live record and 1.. walk back through the flash log newest first, see tools/openrb_persist.py
+#define PERSIST_VENDOR_REQUEST 0xA2
+#define PERSIST_VERSION 1
+
+// the log is a ring of one record per flash page in the last PERSIST_LOG_SECTORS of flash, the
+// sector after the one being written is erased ahead of time so it holds one sector less history
+#define PERSIST_LOG_SECTORS 4
+// checkpoints stall both cores (and the usb irqs) while flash is written, so they only happen
+// this far apart and once the kit has been quiet for a while - every few minutes of changes wears
+// each sector a few thousand times a year
+#define PERSIST_CHECKPOINT_INTERVAL_MS 60000
+#define PERSIST_CHECKPOINT_QUIET_MS 10000
+// nothing can feed the watchdog while flash is busy and a sector erase can outlast
+// WATCHDOG_TIMEOUT_MS on slow parts, so erasing gets this long instead - it only happens at boot
+// or while the adapter isn't running, checkpoints mid-session only program a page
+#define PERSIST_ERASE_WATCHDOG_MS 1000
+
+typedef enum {
+    RESET_POWER_ON,
+    RESET_RUN_PIN,
+    RESET_DEBUGGER,
+    RESET_WATCHDOG,  // core 0 stopped feeding it
+    RESET_REBOOT,    // the supervisor gave up on a targeted recovery
+    RESET_FAULT,     // a hard fault, the record that faulted has the pc
+    N_RESET_REASONS,
+} reset_reason_e;
+
+// one per boot - append only, bump PERSIST_VERSION when the layout changes and keep
+// tools/openrb_persist.py in sync. new fields go in before crc, which is always the last four
+// bytes of size, so a reader takes what it knows and skips the rest
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t sequence;  // flash copies only, the newest checkpoint has the highest
+    uint32_t boot;      // counted from the first record the log ever saw
+    uint32_t uptime_ms;
+    uint8_t reset_reason;  // reset_reason_e that started this boot
+    uint8_t recovery;      // recovery_e the supervisor rebooted us for, if it did
+    uint8_t adapter_state;
+    uint8_t fifo_high_water;
+    uint32_t fifo_write_failures;
+    uint32_t control_dropped;
+    uint32_t host_restarts;
+    uint32_t device_recoveries;
+    uint32_t hits_accepted;
+    uint32_t hit_latency_count;
+    uint32_t hit_latency_p50_us;
+    uint32_t hit_latency_p99_us;
+    uint32_t hit_latency_max_us;
+    uint32_t hit_latency_over_budget;
+    // what ended this boot if a hard fault did, 0 otherwise
+    uint32_t fault_pc;
+    uint32_t fault_lr;
+    uint8_t fault_core;
+    uint8_t reserved[3];
+    uint32_t crc;  // crc32 of everything above, always last
+} __attribute__((packed)) persist_record_t;
+
+// core 0, before core 1 is launched - checks the record the last boot left in retained ram, logs
+// it to flash and starts this boot's record
+void persist_init();
+
+// core 0 only, every supervisor pass - refreshes the retained record and checkpoints it to flash
+// when it's changed and the kit's been quiet long enough, erases the next sector when it isn't
+// running
+void persist_update(timebase_us_t now);
+
+// index 0 is the live record, 1.. the flash log newest first - false if there's nothing there
+bool persist_get(uint32_t index, persist_record_t *record);
+
+#endif
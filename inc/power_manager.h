@@ -0,0 +1,33 @@
+#ifndef ORB_POWER_MANAGER_H_
+#define ORB_POWER_MANAGER_H_
+
+#include <stdbool.h>
+
+// requests can come from any context (usb callbacks, uart irq), they're acted on in main's loop
+void power_request_sleep();
+void power_request_wake();
+bool power_sleep_pending();
+bool power_wake_pending();
+
+// core 1 gets out of tuh_task within a frame or two of being asked to park, this is plenty
+#define HOST_PARK_TIMEOUT_MS 5
+
+// core 0 only - parks the usb host on core 1, cuts the host port's 5v and drops the system clock
+void power_enter_sleep();
+void power_exit_sleep();
+bool power_is_sleeping();
+
+// core 0 - core 1 is parked with the host stack stopped, it doesn't come round its loop until
+// power_exit_sleep lets it go
+bool power_host_parked();
+
+// core 1 loop body, runs tuh_task unless the host port is gated
+void power_host_init();
+void power_host_task();
+
+// implemented by main - core 1 only, stops the usb host stack (and pio-usb's sof timer with it)
+// when it parks and brings it back up when it's let go
+void power_host_stop_cb();
+void power_host_start_cb();
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef ORB_PROFILER_H_
+#define ORB_PROFILER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "timebase.h"
+
+#define OPENRB_PROFILER_ENABLED 1
+
+typedef enum {
+    FIRST_PROFILE,
+    PROFILE_TUD_TASK = FIRST_PROFILE,
+    PROFILE_POWER_TASK,
+    PROFILE_ANNOUNCE_TASK,
+    PROFILE_SEND_TASK,
+    PROFILE_DRUM_TASK,
+    PROFILE_CORE0_LOOP,
+    PROFILE_TUH_TASK,
+    PROFILE_HIT_LATENCY,  // not a task, see HIT_LATENCY_BUDGET_US
+    PROFILE_IN_POLL,      // nor this, see IN_POLL_BUDGET_US
+    N_PROFILES,
+} profile_e;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t max_us;
+    uint32_t p50_us;
+    uint32_t p99_us;  // upper edge of the histogram bucket the percentile falls in
+    uint32_t budget_us;
+    uint32_t over_budget;
+} profile_report_t;
+
+// each profile must only ever be recorded from one core, reading is fine from anywhere
+void profiler_record(profile_e profile, uint32_t elapsed_us);
+
+void profiler_get(profile_e profile, profile_report_t *report);
+// from the core that records the profile
+void profiler_set_budget(profile_e profile, uint32_t budget_us);
+void profiler_reset(profile_e profile);
+
+// bitmask of profiles that went over budget since the last call
+uint32_t profiler_take_overruns();
+
+// each core reports the time it spent asleep in wfe, utilization is worked out over
+// PROFILER_UTILIZATION_WINDOW_US windows of wall time
+#define PROFILER_UTILIZATION_WINDOW_US 1000000
+void profiler_record_idle(uint32_t idle_us);
+
+// core 0 only, every supervisor pass - closes each core's window once it's run its length
+void profiler_update_utilization(timebase_us_t now);
+
+// busy time in the last full window, 0-1000
+uint16_t profiler_utilization_permille(uint8_t core);
+
+#if OPENRB_PROFILER_ENABLED
+#include <hardware/timer.h>
+
+#define OPENRB_PROFILE(profile, ...)                             \
+    do {                                                         \
+        uint32_t _profile_start = time_us_32();                  \
+        __VA_ARGS__;                                             \
+        profiler_record(profile, time_us_32() - _profile_start); \
+    } while (0)
+
+#else
+
+#define OPENRB_PROFILE(profile, ...) \
+    do {                             \
+        __VA_ARGS__;                 \
+    } while (0)
+
+#endif
+#endif
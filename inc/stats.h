@@ -0,0 +1,85 @@
+#ifndef ORB_STATS_H_
+#define ORB_STATS_H_
+
+#include <stdint.h>
+
+#include "boot_report.h"
+
+// vendor request (device recipient, IN) that returns a stats_block_t
+#define STATS_VENDOR_REQUEST 0xA0
+#define STATS_VERSION 10
+
+typedef enum {
+    STAT_FIFO_WRITE_FAILURES,
+    STAT_HITS_ACCEPTED,
+    STAT_HITS_DROPPED_HOLD,
+    STAT_HITS_DROPPED_THRESHOLD,
+    STAT_REPORTS_SENT,
+    STAT_HOST_SEND_FAILURES,
+    STAT_STATE_TRANSITIONS,
+    // what the v1 block's counters held, anything added since goes in later_counters
+    N_STATS_V1,
+    STAT_HITS_DROPPED_CROSSTALK = N_STATS_V1,
+    STAT_CONTROL_DROPPED,
+    STAT_HOST_RESTARTS,
+    STAT_DEVICE_RECOVERIES,
+    N_STATS,
+} stat_e;
+
+// append only - bump STATS_VERSION when the layout changes, keep tools/openrb_stats.py in sync.
+// later_counters is the one member that grows in place and it's always last: a new stat_e only
+// grows it, a new field goes in before it and the header says where it starts. a reader takes
+// each field from any version at or after the one that added it and later_counters from
+// later_counters_offset up to size
+typedef struct {
+    uint16_t version;
+    uint16_t size;
+    uint32_t uptime_ms;
+    uint8_t adapter_state;
+    uint8_t fifo_high_water;
+    uint16_t later_counters_offset;  // v10, 0 before it
+    uint32_t counters[N_STATS_V1];
+    uint32_t boot_phase_us[N_BOOT_PHASES];
+    // v2
+    uint16_t core_utilization_permille[2];
+    // v3
+    uint8_t loadgen_active;
+    uint8_t reserved_v3[3];
+    uint32_t loadgen_generated;
+    uint32_t loadgen_accepted;
+    uint32_t loadgen_reported;
+    // v4 - first hit in a drum report to the report completing, see HIT_LATENCY_BUDGET_US
+    uint32_t hit_latency_count;
+    uint32_t hit_latency_p50_us;
+    uint32_t hit_latency_p99_us;
+    uint32_t hit_latency_max_us;
+    uint32_t hit_latency_budget_us;
+    uint32_t hit_latency_over_budget;
+    // v7 - what the supervisor left behind before the last reboot, all 0 after a power on
+    uint8_t resume_reason;
+    uint8_t resume_state;
+    uint8_t supervised_reboots;
+    uint8_t reserved_v7;
+    // v8 - the IN interval the console was asked for and how it's really polling, see
+    // inc/usb_descriptors.h and IN_POLL_BUDGET_US
+    uint8_t poll_mode;
+    uint8_t poll_interval_ms;
+    uint8_t reserved_v8[2];
+    uint32_t in_poll_count;
+    uint32_t in_poll_min_us;
+    uint32_t in_poll_avg_us;  // exact, unlike the histogram's percentiles
+    uint32_t in_poll_max_us;
+    uint32_t in_poll_budget_us;
+    uint32_t in_poll_over_budget;
+    // v9 - counters from STAT_HITS_DROPPED_CROSSTALK on. v5 to v8 kept them in counters, so each
+    // one added there moved everything after it
+    uint32_t later_counters[N_STATS - N_STATS_V1];
+} __attribute__((packed)) stats_block_t;
+
+void stats_inc(stat_e stat);
+void stats_fifo_level(uint32_t count);
+uint32_t stats_get(stat_e stat);
+uint8_t stats_fifo_high_water();
+void stats_snapshot(stats_block_t *block);
+
+#endif
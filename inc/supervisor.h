@@ -0,0 +1,57 @@
+#ifndef ORB_SUPERVISOR_H_
+#define ORB_SUPERVISOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// how often TASK_SUPERVISOR looks at the heartbeats, each pass is also core 0's heartbeat - it's
+// the only thing that feeds the hardware watchdog
+#define SUPERVISOR_INTERVAL_MS 20
+// core 0 has to get round its loop at least this often or the chip resets
+#define WATCHDOG_TIMEOUT_MS 250
+// core 1 comes through its loop at least once a ms off the pio-usb sof timer, except while it's
+// parked for sleep with the timer stopped
+#define HOST_STALL_MS 50
+// the console polls every ADAPTER_IN_INTERVAL, a report on the wire this long isn't coming back
+#define DEVICE_STALL_MS 100
+// how long the host port's 5v stays off when core 1 is restarted, long enough for a controller
+// to actually lose power
+#define HOST_POWER_OFF_MS 100
+// targeted recoveries allowed in RECOVERY_WINDOW_MS before we give up and reboot
+#define MAX_RECOVERIES 3
+#define RECOVERY_WINDOW_MS 5000
+
+typedef enum {
+    RECOVERY_NONE,
+    RECOVERY_HOST_STALL,    // core 1 stopped coming round its loop
+    RECOVERY_DEVICE_STALL,  // the console stopped collecting reports
+    RECOVERY_WATCHDOG,      // core 0 stopped feeding the watchdog, nothing got to say why
+    N_RECOVERIES,
+} recovery_e;
+
+// what the last boot left in the watchdog scratch registers, kept up to date every pass so a
+// reset core 0 never saw coming still has it
+typedef struct {
+    uint8_t reason;       // recovery_e that rebooted us
+    uint8_t state;        // adapter_state_t at the time
+    uint8_t instruments;  // bit per connected instruments_e
+    uint8_t reboots;      // supervised reboots since power on
+} supervisor_resume_t;
+
+// core 0, in init after persist_init - picks up the last boot's record and arms the watchdog
+void supervisor_init();
+
+// false after a power on or any reset the watchdog didn't cause, fine to call before
+// supervisor_init
+bool supervisor_resumed(supervisor_resume_t *resume);
+
+// core 1's heartbeat, once per pass of its loop
+void supervisor_core1_beat();
+
+// TASK_SUPERVISOR, core 0 only
+void supervisor_task();
+
+// implemented by main - core 0 only, core 1 has wedged so start the usb host over from scratch
+void supervisor_restart_host_cb();
+
+#endif
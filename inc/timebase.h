@@ -0,0 +1,27 @@
+#ifndef ORB_TIMEBASE_H_
+#define ORB_TIMEBASE_H_
+
+#include <hardware/timer.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// microseconds since boot, the one clock every scheduler in the firmware runs on. 64 bits won't
+// wrap in the life of the device, so deadlines compare with plain < and > instead of the
+// (int32_t)(a - b) dance a 32 bit ms counter needs - durations measured with time_us_32() (trace,
+// profiler) are fine as they are, unsigned subtraction of two 32 bit stamps survives the wrap
+typedef uint64_t timebase_us_t;
+
+#define TIMEBASE_MS(ms) ((timebase_us_t)(ms) * 1000)
+
+// safe from any context on either core, reads the raw timer registers rather than the latched pair
+static inline timebase_us_t timebase_now() { return time_us_64(); }
+
+static inline bool timebase_reached(timebase_us_t deadline, timebase_us_t now) {
+    return now >= deadline;
+}
+
+static inline timebase_us_t timebase_earlier(timebase_us_t a, timebase_us_t b) {
+    return a < b ? a : b;
+}
+
+#endif
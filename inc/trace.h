@@ -0,0 +1,77 @@
+#ifndef ORB_TRACE_H_
+#define ORB_TRACE_H_
+
+#include <hardware/timer.h>
+#include <stdint.h>
+
+#include "orb_debug.h"
+
+// keep in sync with EVENT_NAMES in tools/trace_decode.py
+typedef enum {
+    TRACE_NONE,
+    TRACE_STATE,           // arg0: new adapter_state
+    TRACE_XBOXD_RX,        // arg0: command, arg1: length
+    TRACE_XBOXD_TX_START,  // arg0: command, arg1: length
+    TRACE_XBOXD_TX_DONE,   // arg0: command, arg1: length
+    TRACE_XBOXH_RX,        // arg0: command, arg1: length
+    TRACE_XBOXH_TX,        // arg0: command, arg1: length
+    TRACE_NOTE_ON,         // arg0: note, arg1: velocity | output << 8
+    TRACE_NOTE_OFF,        // arg0: output
+    TRACE_DRUM_REPORT,     // arg0: sequence
+    TRACE_FIFO_FULL,       // arg0: command
+    TRACE_INSTRUMENT,      // arg0: instrument, arg1: connected
+    TRACE_POWER,           // arg0: sleeping
+    TRACE_LOADGEN_HIT,     // arg0: note, arg1: generator pad
+    TRACE_XBOXD_HANDLED,   // arg0: command, arg1: us spent handling it
+    TRACE_XBOXH_HANDLED,   // arg0: command, arg1: us spent handling it
+    TRACE_CROSSTALK,       // arg0: note dropped, arg1: output that masked it
+    TRACE_RECOVERY,        // arg0: recovery_e, arg1: recoveries already in this window
+    TRACE_HIT_DROPPED,     // arg0: note, arg1: hit_drop_e
+    N_TRACE_EVENTS,
+} trace_event_e;
+
+#define TRACE_SYNC 0xA5
+
+// wire format, little endian, DMA'd straight out of the ring
+typedef struct {
+    uint8_t sync;
+    uint8_t event;
+    uint8_t core;
+    uint8_t sequence;  // per core, gaps mean the ring overflowed
+    uint32_t time_us;
+    uint32_t arg0;
+    uint32_t arg1;
+} __attribute__((packed)) trace_record_t;
+
+// core 0, after events_init - takes over DEBUG_UART_ID
+void trace_init();
+
+// safe from any context on either core
+void trace_event(trace_event_e event, uint32_t arg0, uint32_t arg1);
+
+// core 0 task, starts a DMA if one isn't already running
+void trace_drain();
+
+uint32_t trace_dropped(uint8_t core);
+
+// core 0, once core 1's been reset - starts its ring over, what it had buffered counts as dropped
+void trace_core1_reset();
+
+// throws away whatever this core has buffered, only for when nothing's draining (the bench image)
+void trace_discard();
+
+#if OPENRB_TRACE_ENABLED
+#define OPENRB_TRACE(event, arg0, arg1) trace_event(event, arg0, arg1)
+// runs the statement and traces how long it took as arg1
+#define OPENRB_TRACE_COST(event, arg0, ...)                           \
+    do {                                                              \
+        uint32_t _trace_start = time_us_32();                         \
+        __VA_ARGS__;                                                  \
+        trace_event(event, arg0, time_us_32() - _trace_start);        \
+    } while (0)
+#else
+#define OPENRB_TRACE(...)
+#define OPENRB_TRACE_COST(event, arg0, ...) __VA_ARGS__
+#endif
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef ORB_USB_DESCRIPTORS_H_
+#define ORB_USB_DESCRIPTORS_H_
+
+#include <stdint.h>
+
+#include "timebase.h"
+
+// set by the OPENRB_FAST_POLL cmake option - the adapter's endpoints ask to be polled every
+// ADAPTER_FAST_INTERVAL instead of ADAPTER_IN_INTERVAL / ADAPTER_OUT_INTERVAL
+#ifndef OPENRB_FAST_POLL_ENABLED
+#define OPENRB_FAST_POLL_ENABLED 0
+#endif
+
+// a console that's read the fast configuration but hasn't set it this long after is taken to have
+// refused it, we drop off the bus and come back with the standard one
+#define FAST_POLL_MOUNT_TIMEOUT_MS 2000
+// long enough off the bus for the console to see a disconnect
+#define FAST_POLL_RECONNECT_MS 100
+
+typedef enum {
+    POLL_STANDARD,      // built without OPENRB_FAST_POLL
+    POLL_FAST_PENDING,  // offering the fast configuration, not configured yet
+    POLL_FAST,
+    POLL_FALLING_BACK,  // off the bus, coming back with the standard configuration
+    POLL_FELL_BACK,
+} poll_mode_e;
+
+poll_mode_e usb_poll_mode();
+
+// the IN interval the console was asked for, reports are paced to match
+uint8_t usb_poll_interval_ms();
+
+// core 0 only, from tud_mount_cb / tud_umount_cb
+void usb_poll_mounted();
+void usb_poll_unmounted();
+
+// core 0 only, every supervisor pass - falls back to the standard configuration if the console
+// never takes the fast one
+void usb_poll_check(timebase_us_t now);
+
+#endif
@@ -13,7 +13,16 @@
 
 #include "xbox_one_protocol.h"
 
+// one auth source plus a controller per guitar slot
+#define XBOX_MAX_CONTROLLERS 3
+
 bool xboxh_receive_report(uint8_t daddr, uint8_t idx);
+
+// core 1, re-arms IN polling for every controller whose interval has come up
+void xboxh_task(void);
+
+// 0 goes back to polling at each controller's own bInterval
+void xboxh_set_poll_interval(uint8_t interval_ms);
 bool xboxh_send_report(uint8_t daddr, uint8_t idx, const void *report, uint16_t len);
 
 TU_ATTR_WEAK void xboxh_mount_cb(uint8_t dev_addr, uint8_t instance);
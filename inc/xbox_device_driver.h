@@ -6,6 +6,11 @@
 
 bool xboxd_send_task();
 
+// core 0 only - false if no report is waiting on the console, otherwise when it went out
+bool xboxd_in_flight_since(timebase_us_t *sent_at);
+// core 0 only - drops the report the console never collected and re-arms both endpoints
+void xboxd_recover();
+
 TU_ATTR_WEAK bool xboxd_packet_received_cb(uint8_t rhport, const xbox_packet_t *buf,
                                            uint32_t xferred_bytes);
 
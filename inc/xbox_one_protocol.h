@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include "orb_debug.h"
+#include "timebase.h"
 
 enum frame_command_e {
     CMD_ACKNOWLEDGE = 0x01,
@@ -167,8 +168,10 @@ typedef struct {
         uint8_t buffer[XBOX_ONE_EP_MAXPKTSIZE];
     };
     uint8_t length;
-    uint32_t triggered_time;
+    timebase_us_t triggered_at;  // held back until ON_DELAY_MS after this, 0 goes straight out
     uint8_t handled;
+    uint32_t hit_time_us;    // time_us_32() of the first hit a drum report carries, 0 otherwise
+    uint8_t generated_hits;  // load generator hits it carries, counted once the console has it
 } __attribute__((packed)) xbox_packet_t;
 
 // static_assert(sizeof(xbox_packet_t) == XBOX_ONE_EP_MAXPKTSIZE, "Incorrect Xbox Packet Size");
@@ -176,7 +179,7 @@ typedef struct {
 uint8_t xboxp_get_size(const xbox_packet_t *packet);
 uint8_t get_sequence();
 
-void init_packet(xbox_packet_t *pkt, uint32_t time, uint8_t length);
+void init_packet(xbox_packet_t *pkt, timebase_us_t triggered_at, uint8_t length);
 
 void fill_drum_input_from_controller(const xbox_packet_t *controller_input,
                                      xbox_packet_t *wla_output, uint8_t player_id);
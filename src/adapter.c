@@ -0,0 +1,465 @@
+#include "adapter.h"
+
+#include <device/usbd.h>
+#include <hardware/gpio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "boot_report.h"
+#include "control_queue.h"
+#include "drums.h"
+#include "events.h"
+#include "hot_path.h"
+#include "identifiers.h"
+#include "instrument_manager.h"
+#include "loadgen.h"
+#include "orb_debug.h"
+#include "packet_queue.h"
+#include "pins_rp2040_usbh.h"
+#include "power_manager.h"
+#include "profiler.h"
+#include "stats.h"
+#include "supervisor.h"
+#include "timebase.h"
+#include "trace.h"
+#include "usb_descriptors.h"
+#include "util.h"
+#include "xbox_controller_driver.h"
+#include "xbox_device_driver.h"
+
+// only written on core 0, core 1 only ever reads it
+volatile adapter_state_t adapter_state = STATE_NONE;
+
+#define NO_CONTROLLER UINT8_MAX
+
+// indexed by the host driver's instance, the first controller to mount authenticates us with the
+// console and navigates as DRUMS, the rest take a guitar slot each. core 0 only, control_task
+// applies the mounts and unmounts core 1's host driver posts
+typedef struct {
+    uint8_t addr;  // 0 when nothing's mounted in this slot
+    instruments_e player;
+} controller_t;
+
+static controller_t controllers[XBOX_MAX_CONTROLLERS];
+static uint8_t auth_controller_idx = NO_CONTROLLER;
+
+// what core 1 does with each slot's reports - DRUMS is the auth controller, a guitar plays as that
+// guitar and N_INSTRUMENTS drops them. only written on core 0 as controllers[] changes, a byte a
+// slot so core 1 never reads half an update
+static volatile uint8_t slot_players[XBOX_MAX_CONTROLLERS] = {
+        [0 ... XBOX_MAX_CONTROLLERS - 1] = N_INSTRUMENTS,
+};
+
+static xbox_packet_t out_packet;
+
+// core 0 only, every task gets a look after a state change, they each decide for themselves if
+// there's work
+static void set_adapter_state(adapter_state_t state) {
+    adapter_state = state;
+    OPENRB_TRACE(TRACE_STATE, state, 0);
+    // auth is done by the time we're running, the controller is only used to navigate menus
+    xboxh_set_poll_interval(state == STATE_RUNNING ? XBOX_RUNNING_POLL_INTERVAL_MS : 0);
+    stats_inc(STAT_STATE_TRANSITIONS);
+    events_post_mask(ALL_TASKS);
+}
+
+// state to go back to when the console wakes us up, cleared if the console re-enumerates us while
+// we're asleep since it'll want the whole handshake again
+static adapter_state_t resume_state = STATE_NONE;
+
+static inline bool xboxh_send(const xbox_packet_t *buffer) {
+    uint8_t idx = auth_controller_idx;
+    bool sent = idx != NO_CONTROLLER &&
+                xboxh_send_report(controllers[idx].addr, idx, buffer, buffer->length);
+    if (!sent) stats_inc(STAT_HOST_SEND_FAILURES);
+    return sent;
+}
+
+static instruments_e claim_guest_player() {
+    static const instruments_e guest_players[] = {GUITAR_ONE, GUITAR_TWO};
+    for (uint8_t i = 0; i < UTIL_NUM(guest_players); i++) {
+        bool taken = false;
+        for (uint8_t idx = 0; idx < XBOX_MAX_CONTROLLERS; idx++) {
+            if (controllers[idx].addr && controllers[idx].player == guest_players[i]) taken = true;
+        }
+        if (!taken) return guest_players[i];
+    }
+    return N_INSTRUMENTS;
+}
+
+static void publish_slots() {
+    for (uint8_t idx = 0; idx < XBOX_MAX_CONTROLLERS; idx++) {
+        slot_players[idx] = controllers[idx].addr ? controllers[idx].player : N_INSTRUMENTS;
+    }
+}
+
+static void controller_unmounted(uint8_t idx, uint8_t addr) {
+    // a stale unmount for a slot that's since been taken by something else
+    if (controllers[idx].addr != addr) return;
+
+    instruments_e player = controllers[idx].player;
+    controllers[idx].addr = 0;
+
+    if (idx != auth_controller_idx) {
+        publish_slots();
+        if (player < N_INSTRUMENTS) disconnect_instrument(player);
+        return;
+    }
+
+    // hand auth duties to whoever's left, they give up their guitar slot for it
+    auth_controller_idx = NO_CONTROLLER;
+    for (uint8_t other = 0; other < XBOX_MAX_CONTROLLERS; other++) {
+        if (!controllers[other].addr) continue;
+        if (controllers[other].player < N_INSTRUMENTS)
+            disconnect_instrument(controllers[other].player);
+        controllers[other].player = DRUMS;
+        auth_controller_idx = other;
+        break;
+    }
+    publish_slots();
+}
+
+static void controller_mounted(uint8_t idx, uint8_t addr) {
+    // the unmount for whatever was here before never made it through the queue
+    if (controllers[idx].addr) controller_unmounted(idx, controllers[idx].addr);
+
+    if (auth_controller_idx == NO_CONTROLLER) {
+        controllers[idx].player = DRUMS;
+        controllers[idx].addr = addr;
+        auth_controller_idx = idx;
+        publish_slots();
+        boot_report_mark(BOOT_PHASE_HOST_ENUMERATED);
+        events_post(TASK_ANNOUNCE);
+        return;
+    }
+
+    instruments_e player = claim_guest_player();
+    controllers[idx].player = player;
+    controllers[idx].addr = addr;
+    publish_slots();
+    if (player < N_INSTRUMENTS) connect_instrument(player);
+}
+
+// the host driver's callbacks run on core 1 inside tuh_task, they only say what happened
+void xboxh_mount_cb(uint8_t dev_addr, uint8_t instance) {
+    OPENRB_DEBUG("Controller %d Connected\r\n", instance);
+    if (instance < XBOX_MAX_CONTROLLERS)
+        control_post(CONTROL_CONTROLLER_MOUNTED, instance, dev_addr);
+}
+
+void xboxh_umount_cb(uint8_t dev_addr, uint8_t instance) {
+    OPENRB_DEBUG("Controller %d Disconnected\r\n", instance);
+    if (instance < XBOX_MAX_CONTROLLERS)
+        control_post(CONTROL_CONTROLLER_UNMOUNTED, instance, dev_addr);
+}
+
+// runs on core 1, so it gets its own packet rather than sharing out_packet with core 0
+static void OPENRB_HOT_FUNC(handle_controller_packet_running)(instruments_e player,
+                                                              const xbox_packet_t *data) {
+    static xbox_packet_t OPENRB_CORE1_DATA controller_out_packet;
+    switch (data->frame.command) {
+        case CMD_GUIDE_BTN:
+            xbox_fifo_write(data);
+            break;
+
+        case CMD_INPUT:
+            fill_drum_input_from_controller(data, &controller_out_packet, player);
+            xbox_fifo_write(&controller_out_packet);
+            break;
+        default:
+            break;
+    }
+}
+
+static void OPENRB_HOT_FUNC(handle_xboxh_packet)(uint8_t idx, const xbox_packet_t *data) {
+    instruments_e player = slot_players[idx];
+    switch (adapter_state) {
+        case STATE_AUTHENTICATING:
+            if (player == DRUMS) xbox_fifo_write(data);
+            break;
+        // case STATE_POWER_OFF:
+        //     break;
+        case STATE_RUNNING:
+            if (player < N_INSTRUMENTS) handle_controller_packet_running(player, data);
+            break;
+        default:
+            break;
+    }
+}
+
+void OPENRB_HOT_FUNC(xboxh_packet_received_cb)(uint8_t idx, const xbox_packet_t *data,
+                                               const uint8_t ndata) {
+    if (idx >= XBOX_MAX_CONTROLLERS) return;
+    if (ndata < sizeof(frame_t)) return;
+    OPENRB_DEBUG("IN FROM CONTROLLER: %s\r\n", get_command_name(data->frame.command));
+    OPENRB_TRACE(TRACE_XBOXH_RX, data->frame.command, ndata);
+    OPENRB_TRACE_COST(TRACE_XBOXH_HANDLED, data->frame.command, handle_xboxh_packet(idx, data));
+}
+
+void xboxh_packet_sent_cb(uint8_t idx, const xbox_packet_t *data, const uint8_t ndata) {
+    (void)idx;
+    (void)data;
+    (void)ndata;
+    OPENRB_DEBUG("Sent Controller %d bytes (%s)\r\n", ndata, get_command_name(data->frame.command));
+    OPENRB_TRACE(TRACE_XBOXH_TX, data->frame.command, ndata);
+}
+
+static void enter_running() {
+    gpio_put(PIN_LED, true);
+    set_adapter_state(STATE_RUNNING);
+    boot_report_mark(BOOT_PHASE_RUNNING);
+    boot_report_print();
+    notify_xbox_of_all_instruments();
+}
+
+// console packets are all handled on core 0 from tud_task, so the move to running is done before
+// the next packet in the same pass comes through here
+static void handle_auth(const xbox_packet_t *packet) {
+    if (packet->frame.command == CMD_AUTHENTICATE && packet->frame.length == 2 &&
+        packet->buffer[3] == 2 && packet->buffer[4] == 1 && packet->buffer[5] == 0) {
+        OPENRB_DEBUG("AUTHENTICATED!\r\n");
+        enter_running();
+    }
+
+    OPENRB_DEBUG("Sending controller %d bytes\n", packet->length);
+    xboxh_send(packet);
+    return;
+}
+
+static void handle_identify(const xbox_packet_t *packet) {
+    static uint8_t identify_sequence = 0;
+    switch (packet->frame.command) {
+        case CMD_IDENTIFY:
+        case CMD_ACKNOWLEDGE:
+            if (identify_sequence >= identifiers_get_n()) {
+                OPENRB_DEBUG("Starting identify sequence over\r\n");
+                identify_sequence = 0;
+            }
+            identifiers_get(identify_sequence, &out_packet);
+            xbox_fifo_write(&out_packet);
+            identify_sequence++;
+            break;
+        case CMD_AUTHENTICATE:
+            OPENRB_DEBUG("Moving to Authenticate\r\n");
+            set_adapter_state(STATE_AUTHENTICATING);
+            boot_report_mark(BOOT_PHASE_AUTH);
+            return handle_auth(packet);
+            break;
+        default:
+            break;
+    }
+    return;
+}
+
+static void handle_init(const xbox_packet_t *packet) {
+    switch (packet->frame.command) {
+        case CMD_IDENTIFY:
+            OPENRB_DEBUG("Moving to Identify\r\n");
+            set_adapter_state(STATE_IDENTIFYING);
+            boot_report_mark(BOOT_PHASE_IDENTIFY);
+            return handle_identify(packet);
+        default:
+            break;
+    }
+}
+
+static void OPENRB_HOT_FUNC(handle_running)(const xbox_packet_t *packet) {
+    switch (packet->frame.command) {
+        case CMD_POWER_MODE:
+            if (packet->power.data.data != POWER_ON) power_request_sleep();
+            break;
+        case CMD_ACKNOWLEDGE:
+            xboxh_send(packet);
+            break;
+
+        case CMD_LIST_CONNECTED_INSTRUMENTS:
+            notify_xbox_of_all_instruments();
+            break;
+        case CMD_LIST_INSTRUMENT:
+            notify_xbox_of_single_instrumenty(packet->buffer[4]);
+            break;
+        default:
+            break;
+    }
+    return;
+}
+
+static void handle_power_off(const xbox_packet_t *packet) {
+    switch (packet->frame.command) {
+        case CMD_POWER_MODE:
+            if (packet->power.data.data == POWER_ON) power_request_wake();
+            break;
+        default:
+            break;
+    }
+}
+
+static void OPENRB_HOT_FUNC(handle_xboxd_packet)(const xbox_packet_t *packet) {
+    switch (adapter_state) {
+        case STATE_NONE:
+            return;
+        case STATE_INIT:
+            return handle_init(packet);
+        case STATE_IDENTIFYING:
+            return handle_identify(packet);
+        case STATE_AUTHENTICATING:
+            return handle_auth(packet);
+        case STATE_RUNNING:
+            return handle_running(packet);
+        case STATE_POWER_OFF:
+            return handle_power_off(packet);
+        default:
+            break;
+    }
+    return;
+}
+
+bool OPENRB_HOT_FUNC(xboxd_packet_received_cb)(uint8_t rhport, const xbox_packet_t *buf,
+                                               uint32_t xferred_bytes) {
+    (void)rhport;
+    if (xferred_bytes < sizeof(frame_t)) return false;
+
+    OPENRB_TRACE_COST(TRACE_XBOXD_HANDLED, buf->frame.command, handle_xboxd_packet(buf));
+    return true;
+}
+
+void tud_suspend_cb(bool remote_wakeup_en) {
+    (void)remote_wakeup_en;
+    if (adapter_state == STATE_RUNNING) power_request_sleep();
+}
+
+void tud_resume_cb(void) {
+    if (adapter_state == STATE_POWER_OFF) power_request_wake();
+}
+
+void tud_mount_cb(void) {
+    usb_poll_mounted();
+    // a console that re-enumerates us while we're asleep won't necessarily resume the bus first,
+    // tud_umount_cb has already cleared resume_state so this starts the handshake over
+    if (adapter_state == STATE_POWER_OFF) power_request_wake();
+    events_post_mask(TASK_BIT(TASK_ANNOUNCE) | TASK_BIT(TASK_SEND));
+}
+
+void tud_umount_cb(void) {
+    usb_poll_unmounted();
+    resume_state = STATE_INIT;
+}
+
+void power_task() {
+    if (power_sleep_pending() && adapter_state == STATE_RUNNING) {
+        resume_state = STATE_RUNNING;
+        set_adapter_state(STATE_POWER_OFF);
+        gpio_put(PIN_LED, false);
+        power_enter_sleep();
+    }
+
+    if (adapter_state != STATE_POWER_OFF) return;
+
+    if (!power_wake_pending()) return;
+
+    power_exit_sleep();
+    if (resume_state == STATE_RUNNING) {
+        // console still has our identity and auth from before it slept, skip straight to running
+        OPENRB_DEBUG("resuming straight to running\r\n");
+        gpio_put(PIN_LED, true);
+        set_adapter_state(STATE_RUNNING);
+        notify_xbox_of_all_instruments();
+        // the kit wakes us whether or not the console's awake, and tud_suspend_cb only fires on
+        // the bus going into suspend, so nothing else would put us back to sleep
+        if (tud_suspended()) power_request_sleep();
+    } else {
+        OPENRB_DEBUG("console re-enumerated while asleep, starting over\r\n");
+        set_adapter_state(STATE_INIT);
+    }
+}
+
+// the single owner of hot-plug changes posted from irqs and core 1
+void control_task() {
+    control_event_t event;
+    while (control_read(&event)) {
+        switch (event.type) {
+            case CONTROL_CONNECT:
+                instrument_set_connected(event.arg, true);
+                break;
+            case CONTROL_DISCONNECT:
+                instrument_set_connected(event.arg, false);
+                break;
+            case CONTROL_CONTROLLER_MOUNTED:
+                if (event.arg < XBOX_MAX_CONTROLLERS) controller_mounted(event.arg, event.addr);
+                break;
+            case CONTROL_CONTROLLER_UNMOUNTED:
+                if (event.arg < XBOX_MAX_CONTROLLERS) controller_unmounted(event.arg, event.addr);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// announce as soon as the console has configured us and we have a controller to authenticate
+// with, then back off exponentially up to ANNOUNCE_INTERVAL_MS until the console starts identifying
+void announce_task() {
+    static timebase_us_t next_announce_at = 0;
+    static uint32_t announce_interval = 0;
+
+    if (adapter_state != STATE_INIT) return;
+
+    if (!tud_mounted() || auth_controller_idx == NO_CONTROLLER) {
+        announce_interval = 0;
+        return;
+    }
+
+    timebase_us_t now = timebase_now();
+    if (announce_interval && !timebase_reached(next_announce_at, now)) return;
+
+    OPENRB_DEBUG("ANNOUNCING\r\n");
+    identifiers_get_announce(&out_packet);
+    if (!xbox_fifo_write(&out_packet)) {
+        // fifo's full, the send task will make room
+        events_post_at(TASK_ANNOUNCE, now + TIMEBASE_MS(1));
+        return;
+    }
+    boot_report_mark(BOOT_PHASE_ANNOUNCE);
+
+    if (!announce_interval) {
+        announce_interval = ANNOUNCE_MIN_INTERVAL_MS;
+    } else if (announce_interval < ANNOUNCE_INTERVAL_MS) {
+        announce_interval = tu_min32(announce_interval * 2, ANNOUNCE_INTERVAL_MS);
+    }
+    next_announce_at = now + TIMEBASE_MS(announce_interval);
+    events_post_at(TASK_ANNOUNCE, next_announce_at);
+}
+
+void adapter_start() {
+    memset(out_packet.buffer, 0, sizeof(out_packet.buffer));
+    set_adapter_state(STATE_INIT);
+}
+
+void adapter_core1_reset() {
+    events_core1_reset();
+    trace_core1_reset();
+    // core 1 queues the controllers' input
+    xbox_fifo_init_mutexes();
+
+    // whatever core 1 posted before it went first, so nothing it mounted comes back after this
+    control_task();
+    control_core1_reset();
+    for (uint8_t idx = 0; idx < XBOX_MAX_CONTROLLERS; idx++) {
+        if (controllers[idx].addr) controller_unmounted(idx, controllers[idx].addr);
+    }
+}
+
+void adapter_run_tasks(uint32_t tasks) {
+    OPENRB_PROFILE(PROFILE_CORE0_LOOP, {
+        if (tasks & TASK_BIT(TASK_USB_DEVICE)) OPENRB_PROFILE(PROFILE_TUD_TASK, tud_task());
+        if (tasks & TASK_BIT(TASK_CONTROL)) control_task();
+        if (tasks & TASK_BIT(TASK_POWER)) OPENRB_PROFILE(PROFILE_POWER_TASK, power_task());
+        if (tasks & TASK_BIT(TASK_ANNOUNCE)) OPENRB_PROFILE(PROFILE_ANNOUNCE_TASK, announce_task());
+        if (tasks & TASK_BIT(TASK_SEND)) OPENRB_PROFILE(PROFILE_SEND_TASK, xboxd_send_task());
+        if (tasks & TASK_BIT(TASK_DRUM)) OPENRB_PROFILE(PROFILE_DRUM_TASK, drum_task());
+        if (tasks & TASK_BIT(TASK_LOADGEN)) loadgen_task();
+        if (tasks & TASK_BIT(TASK_TRACE)) trace_drain();
+        if (tasks & TASK_BIT(TASK_SUPERVISOR)) supervisor_task();
+    });
+}
@@ -0,0 +1,171 @@
+#include "bench.h"
+
+#if OPENRB_BENCH_ENABLED
+
+#include <hardware/clocks.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+#include <pico/multicore.h>
+#include <pico/stdio.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "adapter.h"
+#include "hot_path.h"
+#include "midi.h"
+#include "packet_queue.h"
+#include "trace.h"
+#include "xbox_one_protocol.h"
+
+// what an empty bench_now() / bench_sample() pair costs, taken off every sample
+static uint32_t overhead_cycles = 0;
+static bool cold = false;
+static bool contended = false;
+
+void bench_begin(bench_t *bench, const char *name) {
+    memset(bench, 0, sizeof(*bench));
+    bench->name = name;
+    bench->min_cycles = UINT32_MAX;
+    bench->cold = cold;
+    bench->contended = contended;
+}
+
+// in sram so its own fetches stay out of the xip counters it reads
+void __not_in_flash_func(bench_sample)(bench_t *bench, uint32_t start) {
+    // counts down and wraps at 24 bits
+    uint32_t cycles = (start - bench_now()) & 0x00ffffff;
+    bench->xip_accesses += xip_ctrl_hw->ctr_acc;
+    bench->xip_hits += xip_ctrl_hw->ctr_hit;
+    cycles = cycles > overhead_cycles ? cycles - overhead_cycles : 0;
+
+    bench->count++;
+    bench->total_cycles += cycles;
+    if (cycles < bench->min_cycles) bench->min_cycles = cycles;
+    if (cycles > bench->max_cycles) bench->max_cycles = cycles;
+    trace_discard();
+}
+
+void bench_end(bench_t *bench) {
+    if (!bench->count) return;
+    uint32_t mean = bench->total_cycles / bench->count;
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+    printf("{\"bench\":\"%s\",\"cold\":%s,\"contended\":%s,\"ram_hot_path\":%s,"
+           "\"scratch_banks\":%s,\"count\":%lu,\"min_cycles\":%lu,\"mean_cycles\":%lu,"
+           "\"max_cycles\":%lu,\"jitter_cycles\":%lu,\"mean_ns\":%lu,\"clock_mhz\":%lu",
+           bench->name, bench->cold ? "true" : "false", bench->contended ? "true" : "false",
+           OPENRB_RAM_HOT_PATH_ENABLED ? "true" : "false",
+           OPENRB_SCRATCH_BANKS_ENABLED ? "true" : "false", (unsigned long)bench->count,
+           (unsigned long)bench->min_cycles, (unsigned long)mean, (unsigned long)bench->max_cycles,
+           (unsigned long)(bench->max_cycles - bench->min_cycles),
+           (unsigned long)(mean * 1000 / mhz), (unsigned long)mhz);
+    // the counters are shared by both cores, with core 1 running they'd count its fetches too
+    if (!bench->contended) {
+        // no xip accesses at all reads as a perfect hit rate, that's what the ram hot path is after
+        uint32_t hit_permille = bench->xip_accesses
+                                        ? (uint64_t)bench->xip_hits * 1000 / bench->xip_accesses
+                                        : 1000;
+        printf(",\"xip_accesses\":%lu,\"xip_hit_permille\":%lu",
+               (unsigned long)bench->xip_accesses, (unsigned long)hit_permille);
+    }
+    printf("}\r\n");
+}
+
+static void start_systick() {
+    systick_hw->rvr = 0x00ffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+static void calibrate() {
+    bench_t bench;
+    bench_begin(&bench, "overhead");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t start = bench_now();
+        bench_sample(&bench, start);
+    }
+    overhead_cycles = bench.min_cycles;
+}
+
+// core 1's load for the contended pass. it isn't the host stack - tinyusb and pio-usb don't run -
+// it's a loop copying one report's worth of words between two buffers wherever OPENRB_CORE1_DATA
+// puts core 1's own state, as fast as it can, timed on core 1's own systick. so the contended rows
+// show whether core 0 stalls on core 1 working its own state, the worst that state's placement
+// can do, not what pio-usb's traffic through striped sram costs
+#define CORE1_REPORT_WORDS (sizeof(xbox_packet_t) / sizeof(uint32_t))
+
+static volatile uint32_t OPENRB_CORE1_DATA core1_rx[CORE1_REPORT_WORDS];
+static volatile uint32_t OPENRB_CORE1_DATA core1_report[CORE1_REPORT_WORDS];
+static bench_t core1_bench;
+static volatile bool core1_stop;
+static volatile bool core1_done;
+
+static void __not_in_flash_func(core1_load)() {
+    start_systick();
+    uint32_t save = save_and_disable_interrupts();
+    while (!core1_stop) {
+        uint32_t start = bench_now();
+        for (uint32_t i = 0; i < CORE1_REPORT_WORDS; i++) core1_report[i] = core1_rx[i];
+        core1_rx[0]++;
+        bench_sample(&core1_bench, start);
+    }
+    restore_interrupts(save);
+    core1_done = true;
+    while (true) __wfi();
+}
+
+static void start_core1_load() {
+    bench_begin(&core1_bench, "core1_report_copy");
+    core1_stop = false;
+    core1_done = false;
+    multicore_reset_core1();
+    multicore_launch_core1(core1_load);
+}
+
+static void stop_core1_load() {
+    core1_stop = true;
+    while (!core1_done) tight_loop_contents();
+    bench_end(&core1_bench);
+}
+
+void bench_main() {
+    stdio_uart_init_full(DEBUG_UART_ID, DEBUG_UART_BAUD, DEBUG_UART_TX_PIN, DEBUG_UART_RX_PIN);
+    xbox_fifo_init();
+    serial_midi_init();
+
+    start_systick();
+
+    // nothing else is running, but the uart irq and the timer would still land in samples
+    uint32_t save = save_and_disable_interrupts();
+    calibrate();
+    restore_interrupts(save);
+
+    printf("{\"bench_start\":true,\"overhead_cycles\":%lu}\r\n", (unsigned long)overhead_cycles);
+    // core 1 on its own first, so its contended numbers below have something to compare with
+    start_core1_load();
+    busy_wait_ms(100);
+    stop_core1_load();
+
+    // warm first, then again with every sample starting from an empty xip cache, which is where
+    // a hit lands when pio-usb on core 1 has just run through it, then warm with core 1 hammering
+    // its own state the whole time - with OPENRB_SCRATCH_BANKS off both cores share the striped
+    // banks and the jitter on each side shows it
+    for (int pass = 0; pass < 3; pass++) {
+        cold = pass == 1;
+        contended = pass == 2;
+        if (contended) start_core1_load();
+        save = save_and_disable_interrupts();
+        drums_bench();
+        serial_midi_bench();
+        midi_parser_bench();
+        xbox_one_protocol_bench();
+        packet_queue_bench();
+        restore_interrupts(save);
+        if (contended) stop_core1_load();
+    }
+    printf("{\"bench_done\":true}\r\n");
+
+    while (true) __wfi();
+}
+
+#endif
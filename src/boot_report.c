@@ -0,0 +1,45 @@
+#include "boot_report.h"
+
+#include <pico/time.h>
+#include <stdint.h>
+
+#include "orb_debug.h"
+
+#if OPENRB_DEBUG_ENABLED
+static const char *phase_names[N_BOOT_PHASES] = {"CLOCKS",   "TUD_INIT", "HOST_ENUMERATED",
+                                                 "ANNOUNCE", "IDENTIFY", "AUTH",
+                                                 "RUNNING"};
+#endif
+
+// phases are marked from both cores, but each slot only ever goes from 0 to its final value once
+static volatile uint32_t phase_times_us[N_BOOT_PHASES] = {0};
+
+void boot_report_mark(boot_phase_e phase) {
+    if (phase >= N_BOOT_PHASES || phase_times_us[phase]) return;
+
+    uint32_t now = time_us_32();
+    // 0 means "not reached", we'll never realistically get here in the first microsecond
+    phase_times_us[phase] = now ? now : 1;
+}
+
+uint32_t boot_report_get(boot_phase_e phase) {
+    if (phase >= N_BOOT_PHASES) return 0;
+    return phase_times_us[phase];
+}
+
+void boot_report_print() {
+#if OPENRB_DEBUG_ENABLED
+    uint32_t previous = 0;
+    OPENRB_DEBUG("boot report (us since boot / since previous phase):\r\n");
+    for (int i = FIRST_BOOT_PHASE; i < N_BOOT_PHASES; i++) {
+        uint32_t at = phase_times_us[i];
+        if (!at) {
+            OPENRB_DEBUG("  %-16s --\r\n", phase_names[i]);
+            continue;
+        }
+        OPENRB_DEBUG("  %-16s %10lu %10lu\r\n", phase_names[i], (unsigned long)at,
+                     (unsigned long)(at - previous));
+        previous = at;
+    }
+#endif
+}
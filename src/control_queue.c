@@ -0,0 +1,67 @@
+#include "control_queue.h"
+
+#include <hardware/sync.h>
+#include <pico/platform.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "events.h"
+#include "stats.h"
+
+// per posting core, power of two so head/tail can free-run
+#define CONTROL_QUEUE_SIZE 16
+#define N_CORES 2
+
+typedef struct {
+    control_event_t events[CONTROL_QUEUE_SIZE];
+    volatile uint32_t head;  // only written by the posting core
+    volatile uint32_t tail;  // only written by control_read on core 0
+} control_ring_t;
+
+static control_ring_t rings[N_CORES];
+
+bool control_post(control_e type, uint8_t arg, uint8_t addr) {
+    control_ring_t *ring = &rings[get_core_num()];
+
+    // producers on a core can be interrupted by other producers on the same core (the serial
+    // disconnect alarm), this is the only thing guarding the ring against them
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t head = ring->head;
+    bool full = head - ring->tail >= CONTROL_QUEUE_SIZE;
+    if (!full) {
+        control_event_t *event = &ring->events[head % CONTROL_QUEUE_SIZE];
+        event->type = type;
+        event->arg = arg;
+        event->addr = addr;
+        __dmb();
+        ring->head = head + 1;
+    }
+    restore_interrupts(save);
+
+    if (full) {
+        stats_inc(STAT_CONTROL_DROPPED);
+        return false;
+    }
+    events_post(TASK_CONTROL);
+    return true;
+}
+
+bool control_read(control_event_t *event) {
+    for (uint8_t core = 0; core < N_CORES; core++) {
+        control_ring_t *ring = &rings[core];
+        uint32_t tail = ring->tail;
+        if (tail == ring->head) continue;
+
+        __dmb();
+        *event = ring->events[tail % CONTROL_QUEUE_SIZE];
+        __dmb();
+        ring->tail = tail + 1;
+        return true;
+    }
+    return false;
+}
+
+void control_core1_reset() {
+    rings[1].head = 0;
+    rings[1].tail = 0;
+}
@@ -2,32 +2,44 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "adapter.h"
-#include "bsp/board_api.h"
+#include "bench.h"
+#include "hardware/timer.h"
+#include "events.h"
+#include "hot_path.h"
 #include "instrument_manager.h"
+#include "loadgen.h"
 #include "midi.h"
 #include "packet_queue.h"
+#include "stats.h"
+#include "timebase.h"
+#include "trace.h"
+#include "usb_descriptors.h"
 #include "usb_midi_host.h"
+#include "util.h"
 #include "xbox_one_protocol.h"
 
-typedef enum {
-    FIRST_OUT,
-    OUT_KICK = FIRST_OUT,
-    OUT_PAD_RED,
-    OUT_PAD_YELLOW,
-    OUT_PAD_BLUE,
-    OUT_PAD_GREEN,
-    OUT_CYM_YELLOW,
-    OUT_CYM_BLUE,
-    OUT_CYM_GREEN,
-    LAST_OUT = OUT_CYM_GREEN,
-    NUM_OUT,
-    NO_OUT,
-} output_e;
+#define MIDI_EVENT_BATCH 16
+
+// hits recent enough to still mask crosstalk, must cover every window in the crosstalk map at the
+// fastest rate a kit can send hits
+#define RECENT_HITS 8
+
+typedef struct {
+    uint8_t window_ms;  // 0 means the pair is never masked
+    uint8_t velocity_percent;
+} crosstalk_mask_t;
+
+typedef struct {
+    timebase_us_t at;
+    uint8_t out;
+    uint8_t velocity;  // 0 for an unused slot
+} recent_hit_t;
 
 typedef struct {
-    uint32_t triggered_at;
+    timebase_us_t release_at;
     bool triggered;
 } output_state_t;
 
@@ -36,11 +48,14 @@ enum state_flags_t {
     changed_flag = (1 << 0),
 };
 
-static struct {
+static OPENRB_CORE0_DATA struct {
     xbox_packet_t input_pkt;
     uint8_t midi_dev_addr;
     output_state_t midi_output_states[NUM_OUT];
     uint8_t flags;
+    uint32_t generated_pending;  // loadgen hits waiting on the next report
+    uint32_t first_hit_us;       // oldest hit waiting on the next report, 0 if none
+    midi_parser_t usb_midi_parser;
 } drum_state = {.midi_dev_addr = 0,
                 .input_pkt = {.wla_header.playerId = DRUMS,
                               .wla_header.frame =
@@ -54,7 +69,40 @@ static struct {
                               .wla_header.unknown = 0x01},
                 .flags = 0};
 
-static output_e get_output_for_note(uint8_t note) {
+static const crosstalk_mask_t OPENRB_HOT_DATA crosstalk_masks[NUM_OUT][NUM_OUT] = {
+#define CROSSTALK_MASK(source_out, victim_out, window, percent) \
+    [source_out][victim_out] = {window, percent},
+#include "crosstalk_map.h"
+#undef CROSSTALK_MASK
+};
+
+static recent_hit_t OPENRB_CORE0_DATA recent_hits[RECENT_HITS];
+static uint8_t OPENRB_CORE0_DATA recent_hits_head = 0;
+
+// constant time - only ever looks at RECENT_HITS entries, returns the masking output or NO_OUT
+static output_e OPENRB_HOT_FUNC(crosstalk_source)(output_e out, uint8_t velocity,
+                                                  timebase_us_t now) {
+    for (uint8_t i = 0; i < RECENT_HITS; i++) {
+        const recent_hit_t *hit = &recent_hits[i];
+        if (!hit->velocity) continue;
+
+        const crosstalk_mask_t *mask = &crosstalk_masks[hit->out][out];
+        if (!mask->window_ms || now - hit->at > TIMEBASE_MS(mask->window_ms)) continue;
+        if ((uint32_t)velocity * 100 < (uint32_t)hit->velocity * mask->velocity_percent) {
+            return hit->out;
+        }
+    }
+    return NO_OUT;
+}
+
+static void OPENRB_HOT_FUNC(remember_hit)(output_e out, uint8_t velocity, timebase_us_t now) {
+    recent_hit_t *hit = &recent_hits[recent_hits_head++ % RECENT_HITS];
+    hit->at = now;
+    hit->out = out;
+    hit->velocity = velocity;
+}
+
+static output_e OPENRB_HOT_FUNC(get_output_for_note)(uint8_t note) {
     switch (note) {
 #define MIDI_MAP(midi_note, rb_out) \
     case midi_note:                 \
@@ -66,12 +114,15 @@ static output_e get_output_for_note(uint8_t note) {
     }
 }
 
-static void update_drum_state_with_midi_input(output_e out, uint8_t state,
-                                              xb_one_drum_input_pkt_t *drum_input) {
+static void OPENRB_HOT_FUNC(update_drum_state_with_midi_input)(
+        output_e out, uint8_t state, xb_one_drum_input_pkt_t *drum_input) {
     switch (out) {
         case OUT_KICK:
             drum_input->kick = state;
             break;
+        case OUT_DOUBLE_KICK:
+            drum_input->doublekick = state;
+            break;
         case OUT_PAD_RED:
             drum_input->pad_red = state;
             break;
@@ -99,78 +150,141 @@ static void update_drum_state_with_midi_input(output_e out, uint8_t state,
     return;
 }
 
-static void note_on(uint8_t note, uint8_t velocity) {
-    if (velocity <= VELOCITY_THRESH) return;
+// the game reads kick and doublekick as the same lane, so a pedal hit that lands while its own
+// output is still held spills onto the other one instead of being merged
+static output_e OPENRB_HOT_FUNC(kick_lane_for)(output_e out) {
+    if (!drum_state.midi_output_states[out].triggered) return out;
+    output_e other = (out == OUT_KICK) ? OUT_DOUBLE_KICK : OUT_KICK;
+    return drum_state.midi_output_states[other].triggered ? out : other;
+}
+
+static bool OPENRB_HOT_FUNC(note_on)(uint8_t note, uint8_t velocity) {
+    if (velocity <= VELOCITY_THRESH) {
+        stats_inc(STAT_HITS_DROPPED_THRESHOLD);
+        OPENRB_TRACE(TRACE_HIT_DROPPED, note, HIT_DROP_THRESHOLD);
+        return false;
+    }
 
     output_e out = get_output_for_note(note);
-    if (out == NO_OUT) return;
+    if (out == NO_OUT) {
+        OPENRB_TRACE(TRACE_HIT_DROPPED, note, HIT_DROP_UNMAPPED);
+        return false;
+    }
 
-    if (drum_state.midi_output_states[out].triggered) return;
+    timebase_us_t now = timebase_now();
+    output_e source = crosstalk_source(out, velocity, now);
+    if (source != NO_OUT) {
+        stats_inc(STAT_HITS_DROPPED_CROSSTALK);
+        OPENRB_TRACE(TRACE_CROSSTALK, note, source);
+        return false;
+    }
+    remember_hit(out, velocity, now);
+
+    if (out == OUT_KICK || out == OUT_DOUBLE_KICK) out = kick_lane_for(out);
+
+    if (drum_state.midi_output_states[out].triggered) {
+        stats_inc(STAT_HITS_DROPPED_HOLD);
+        OPENRB_TRACE(TRACE_HIT_DROPPED, note, HIT_DROP_HOLD);
+        return false;
+    }
+    stats_inc(STAT_HITS_ACCEPTED);
 
     update_drum_state_with_midi_input(out, 1, &drum_state.input_pkt.drum_input);
     drum_state.flags |= changed_flag;
 
     OPENRB_DEBUG("NOTE ON: %d %d\r\n", out, velocity);
+    OPENRB_TRACE(TRACE_NOTE_ON, note, velocity | out << 8);
 
     drum_state.midi_output_states[out].triggered = true;
-    drum_state.midi_output_states[out].triggered_at = board_millis();
-    return;
+    drum_state.midi_output_states[out].release_at = now + TIMEBASE_MS(TRIGGER_HOLD_MS);
+    if (!drum_state.first_hit_us) {
+        uint32_t now_us = time_us_32();
+        drum_state.first_hit_us = now_us ? now_us : 1;
+    }
+    return true;
 }
 
-extern volatile adapter_state_t adapter_state;
-
-static midi_type_e get_type_from_status(uint8_t status) {
-    if ((status < 0x80) || (status == Undefined_F4) || (status == Undefined_F5) ||
-        (status == Undefined_FD))
-        return InvalidType;  // Data bytes and undefined.
-
-    if (status < 0xf0)
-        // Channel message, remove channel nibble.
-        return status & 0xf0;
-
-    return status;
+void drums_inject_note(uint8_t note, uint8_t velocity) {
+    if (note_on(note, velocity)) {
+        drum_state.generated_pending++;
+        loadgen_hit_accepted();
+    }
 }
 
-void drum_task() {
-    if (adapter_state != STATE_RUNNING) return;
-
-    static uint8_t pending_msg[48];
-    static uint8_t cable_num;
-    static midi_type_e type;
-    static uint32_t current_time;
-
-    while (tuh_midi_stream_read(drum_state.midi_dev_addr, &cable_num, pending_msg,
-                                sizeof(pending_msg)) != 0) {
-        type = get_type_from_status(pending_msg[0]);
-        if (type == NoteOn) note_on(pending_msg[1], pending_msg[2]);
-    }
+extern volatile adapter_state_t adapter_state;
 
-    while (serial_midi_read(pending_msg)) {
-        type = get_type_from_status(pending_msg[0]);
-        if (type == NoteOn) note_on(pending_msg[1], pending_msg[2]);
+static void OPENRB_HOT_FUNC(handle_midi_events)(const midi_event_t *events, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (events[i].type == NoteOn) note_on(events[i].data1, events[i].data2);
     }
+}
 
-    current_time = board_millis();
+static void OPENRB_HOT_FUNC(release_held_outputs)(timebase_us_t now) {
     for (int out = 0; out < NUM_OUT; out++) {
         if (!drum_state.midi_output_states[out].triggered) {
             continue;
         }
 
-        uint32_t time_since_trigger =
-                current_time - drum_state.midi_output_states[out].triggered_at;
-        if (time_since_trigger > TRIGGER_HOLD_MS) {
+        if (timebase_reached(drum_state.midi_output_states[out].release_at, now)) {
             OPENRB_DEBUG("NOTE OFF: %d\r\n", out);
+            OPENRB_TRACE(TRACE_NOTE_OFF, out, 0);
             update_drum_state_with_midi_input(out, 0, &drum_state.input_pkt.drum_input);
             drum_state.midi_output_states[out].triggered = false;
             drum_state.flags |= changed_flag;
+        } else {
+            events_post_at(TASK_DRUM, drum_state.midi_output_states[out].release_at);
+        }
+    }
+}
+
+void OPENRB_HOT_FUNC(drum_task)() {
+    if (adapter_state != STATE_RUNNING) return;
+
+    static uint8_t OPENRB_CORE0_DATA pending_msg[48];
+    static midi_event_t OPENRB_CORE0_DATA events[MIDI_EVENT_BATCH];
+    static uint8_t cable_num;
+    uint32_t len;
+    uint8_t count;
+
+    // a read can hold several messages, and running status can carry over between reads
+    while ((len = tuh_midi_stream_read(drum_state.midi_dev_addr, &cable_num, pending_msg,
+                                       sizeof(pending_msg))) != 0) {
+        uint32_t offset = 0;
+        while (offset < len) {
+            uint32_t consumed;
+            count = midi_parse(&drum_state.usb_midi_parser, pending_msg + offset, len - offset,
+                               events, MIDI_EVENT_BATCH, &consumed);
+            handle_midi_events(events, count);
+            offset += consumed;
         }
     }
 
-    if (drum_state.flags & changed_flag &&
-        current_time - drum_state.input_pkt.triggered_time > ADAPTER_OUT_INTERVAL) {
-        init_packet(&drum_state.input_pkt, current_time, sizeof(xb_one_drum_input_pkt_t));
-        xbox_fifo_write(&drum_state.input_pkt);
-        drum_state.flags &= ~changed_flag;
+    while ((count = serial_midi_read(events, MIDI_EVENT_BATCH))) handle_midi_events(events, count);
+
+    timebase_us_t now = timebase_now();
+    release_held_outputs(now);
+
+    if (drum_state.flags & changed_flag) {
+        // reports go out no closer together than the console polls for them
+        timebase_us_t next_report_at =
+                drum_state.input_pkt.triggered_at + TIMEBASE_MS(usb_poll_interval_ms());
+        if (timebase_reached(next_report_at, now)) {
+            init_packet(&drum_state.input_pkt, now, sizeof(xb_one_drum_input_pkt_t));
+            drum_state.input_pkt.hit_time_us = drum_state.first_hit_us;
+            drum_state.input_pkt.generated_hits =
+                    drum_state.generated_pending < UINT8_MAX ? drum_state.generated_pending
+                                                             : UINT8_MAX;
+            drum_state.first_hit_us = 0;
+            if (xbox_fifo_write(&drum_state.input_pkt)) {
+                OPENRB_TRACE(TRACE_DRUM_REPORT, drum_state.input_pkt.frame.sequence, 0);
+            } else {
+                OPENRB_TRACE(TRACE_FIFO_FULL, CMD_INPUT, 0);
+            }
+            drum_state.generated_pending = 0;
+            drum_state.flags &= ~changed_flag;
+        } else {
+            events_post_at(TASK_DRUM, next_report_at);
+        }
     }
 }
 
@@ -189,6 +303,7 @@ void tuh_midi_mount_cb(uint8_t dev_addr, uint8_t in_ep, uint8_t out_ep, uint8_t
     if (drum_state.midi_dev_addr == 0) {
         // then no MIDI device is currently connected
         drum_state.midi_dev_addr = dev_addr;
+        midi_parser_init(&drum_state.usb_midi_parser);
         connect_instrument(DRUMS);
     } else {
         OPENRB_DEBUG(
@@ -212,7 +327,62 @@ void tuh_midi_umount_cb(uint8_t dev_addr, uint8_t instance) {
     }
 }
 
+// runs on core 1, the doorbell gets the drum task on core 0 to come read it
 void tuh_midi_rx_cb(uint8_t dev_addr, uint32_t num_packets) {
     (void)dev_addr;
-    (void)num_packets;
-}
\ No newline at end of file
+    if (num_packets) events_post(TASK_DRUM);
+}
+
+#if OPENRB_BENCH_ENABLED
+static void reset_outputs() {
+    for (int out = 0; out < NUM_OUT; out++) {
+        drum_state.midi_output_states[out].triggered = false;
+        update_drum_state_with_midi_input(out, 0, &drum_state.input_pkt.drum_input);
+    }
+    memset(recent_hits, 0, sizeof(recent_hits));
+    drum_state.flags = 0;
+}
+
+void drums_bench() {
+    // one note per output in the default map
+    static const uint8_t notes[] = {36, 35, 38, 48, 45, 43, 42, 51, 49};
+    static volatile output_e sink;
+    bench_t bench;
+
+    bench_begin(&bench, "get_output_for_note");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint8_t note = i & 0x7f;
+        uint32_t start = bench_start(&bench);
+        sink = get_output_for_note(note);
+        bench_sample(&bench, start);
+    }
+    bench_end(&bench);
+    (void)sink;
+
+    bench_begin(&bench, "note_on");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        reset_outputs();
+        uint8_t note = notes[i % UTIL_NUM(notes)];
+        uint32_t start = bench_start(&bench);
+        note_on(note, 100);
+        bench_sample(&bench, start);
+    }
+    bench_end(&bench);
+
+    // worst case, every output is due for release
+    bench_begin(&bench, "release_scan");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        timebase_us_t now = timebase_now();
+        for (int out = 0; out < NUM_OUT; out++) {
+            drum_state.midi_output_states[out].triggered = true;
+            drum_state.midi_output_states[out].release_at = now;
+        }
+        uint32_t start = bench_start(&bench);
+        release_held_outputs(now);
+        bench_sample(&bench, start);
+    }
+    bench_end(&bench);
+
+    reset_outputs();
+}
+#endif
@@ -0,0 +1,136 @@
+#include "events.h"
+
+#include <device/usbd.h>
+#include <hardware/irq.h>
+#include <hardware/structs/scb.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+#include <pico/multicore.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hot_path.h"
+#include "profiler.h"
+
+// only touched on core 0, posts from irqs are covered by disabling interrupts
+static volatile uint32_t OPENRB_CORE0_DATA ready = 0;
+
+// posts from core 1 land here and get folded into ready by the doorbell irq
+static uint32_t remote_ready = 0;
+static spin_lock_t *remote_lock;
+
+static timebase_us_t OPENRB_CORE0_DATA deadlines[N_TASKS];
+static uint32_t OPENRB_CORE0_DATA pending_deadlines = 0;
+static int alarm_number = 0;
+
+static void OPENRB_HOT_FUNC(on_doorbell_irq)() {
+    while (multicore_fifo_rvalid()) (void)multicore_fifo_pop_blocking();
+    multicore_fifo_clear_irq();
+
+    uint32_t save = spin_lock_blocking(remote_lock);
+    ready |= remote_ready;
+    remote_ready = 0;
+    spin_unlock(remote_lock, save);
+}
+
+static void on_deadline_alarm(uint alarm_num) {
+    // nothing to do, taking the irq is enough to get events_wait out of wfe
+    (void)alarm_num;
+}
+
+void events_init() {
+    // lets events_wait sleep with interrupts masked, so the time spent in wfe doesn't include
+    // whatever irq woke us up
+    scb_hw->scr |= M0PLUS_SCR_SEVONPEND_BITS;
+
+    remote_lock = spin_lock_init(spin_lock_claim_unused(true));
+
+    alarm_number = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_number, on_deadline_alarm);
+
+    multicore_fifo_clear_irq();
+    irq_set_exclusive_handler(SIO_IRQ_PROC0, on_doorbell_irq);
+    irq_set_enabled(SIO_IRQ_PROC0, true);
+}
+
+void events_core1_reset() {
+    // the doorbell irq is the only other taker and it can't be running under us, whoever holds
+    // the lock now is gone
+    spin_unlock_unsafe(remote_lock);
+}
+
+void OPENRB_HOT_FUNC(events_post_mask)(uint32_t tasks) {
+    if (get_core_num() == 0) {
+        uint32_t save = save_and_disable_interrupts();
+        ready |= tasks;
+        restore_interrupts(save);
+        return;
+    }
+
+    uint32_t save = spin_lock_blocking(remote_lock);
+    remote_ready |= tasks;
+    spin_unlock(remote_lock, save);
+
+    // the value is ignored, if the fifo is full core 0 already has a doorbell pending that will
+    // pick up our bits
+    if (multicore_fifo_wready()) multicore_fifo_push_blocking(tasks);
+}
+
+void events_post(task_e task) { events_post_mask(TASK_BIT(task)); }
+
+void OPENRB_HOT_FUNC(events_post_at)(task_e task, timebase_us_t deadline) {
+    if (task >= N_TASKS) return;
+    if ((pending_deadlines & TASK_BIT(task)) && deadline >= deadlines[task]) return;
+
+    deadlines[task] = deadline;
+    pending_deadlines |= TASK_BIT(task);
+}
+
+// posts every expired deadline and returns the earliest one still pending
+static bool OPENRB_HOT_FUNC(check_deadlines)(timebase_us_t now, timebase_us_t *next) {
+    bool have_next = false;
+    for (int task = FIRST_TASK; task < N_TASKS; task++) {
+        if (!(pending_deadlines & TASK_BIT(task))) continue;
+
+        if (timebase_reached(deadlines[task], now)) {
+            pending_deadlines &= ~TASK_BIT(task);
+            events_post(task);
+        } else {
+            *next = have_next ? timebase_earlier(*next, deadlines[task]) : deadlines[task];
+            have_next = true;
+        }
+    }
+    return have_next;
+}
+
+uint32_t OPENRB_HOT_FUNC(events_wait)() {
+    while (true) {
+        timebase_us_t next_deadline = 0;
+        bool have_deadline = check_deadlines(timebase_now(), &next_deadline);
+
+        if (tud_task_event_ready()) events_post(TASK_USB_DEVICE);
+
+        uint32_t save = save_and_disable_interrupts();
+        uint32_t tasks = ready;
+        ready = 0;
+
+        if (tasks) {
+            restore_interrupts(save);
+            return tasks;
+        }
+
+        // set_target returns true if the deadline has already gone by
+        if (have_deadline &&
+            hardware_alarm_set_target(alarm_number, from_us_since_boot(next_deadline))) {
+            restore_interrupts(save);
+            continue;
+        }
+
+        // with SEVONPEND any irq going pending after we masked them wakes the wfe, so this can't
+        // sleep through a post - the irq itself runs once we restore
+        uint32_t idle_start = time_us_32();
+        __wfe();
+        profiler_record_idle(time_us_32() - idle_start);
+        restore_interrupts(save);
+    }
+}
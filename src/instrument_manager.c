@@ -2,12 +2,16 @@
 #include "instrument_manager.h"
 
 #include <pico/platform.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
 #include "adapter.h"
+#include "control_queue.h"
+#include "hot_path.h"
 #include "orb_debug.h"
 #include "packet_queue.h"
+#include "trace.h"
 #include "util.h"
 #include "xbox_one_protocol.h"
 
@@ -17,10 +21,11 @@ const char *instrument_names[N_INSTRUMENTS] = {"GUITAR_ONE", "GUITAR_TWO", "DRUM
 
 extern volatile adapter_state_t adapter_state;
 
-static volatile uint8_t connected_instruments[N_INSTRUMENTS] = {0, 0, 0};
+// only touched on core 0, everyone else goes through the control queue
+static uint8_t connected_instruments[N_INSTRUMENTS] = {0, 0, 0};
 static xbox_packet_t out_packet;
 
-const uint8_t __in_flash() instrument_notify[N_INSTRUMENTS][22] = {
+const uint8_t OPENRB_HOT_DATA instrument_notify[N_INSTRUMENTS][22] = {
     {0x22, 0x00, 0x00, 0x12, 0x00, 0x01, 0x14, 0x30, 0x00, 0x87, 0x67,
      0x00, 0x75, 0x00, 0x69, 0x00, 0x74, 0x00, 0x61, 0x00, 0x72, 0x00},
     {0x22, 0x00, 0x00, 0x12, 0x01, 0x01, 0x14, 0x30, 0x00, 0x87, 0x67,
@@ -29,7 +34,7 @@ const uint8_t __in_flash() instrument_notify[N_INSTRUMENTS][22] = {
      0x00, 0x72, 0x00, 0x75, 0x00, 0x6D, 0x00, 0x73, 0x00, 0x00, 0x00}
 };
 
-const uint8_t __in_flash() instrument_drop_out[N_INSTRUMENTS][22] = {
+const uint8_t OPENRB_HOT_DATA instrument_drop_out[N_INSTRUMENTS][22] = {
     {0x23, 0x00, 0x00, 0x01, 0x00, 0xFF, 0x05},
     {0x23, 0x00, 0x00, 0x01, 0x01, 0xFF, 0x05},
     {0x23, 0x00, 0x00, 0x01, 0x02, 0xFF, 0x05},
@@ -66,23 +71,26 @@ void notify_xbox_of_single_instrumenty(instruments_e instrument) {
 }
 
 void connect_instrument(instruments_e instrument) {
-    if (connected_instruments[instrument]) return;
-    OPENRB_DEBUG("%s connected!\r\n", instrument_names[instrument]);
-    connected_instruments[instrument] = 1;
+    if (instrument < N_INSTRUMENTS) control_post(CONTROL_CONNECT, instrument, 0);
+}
 
-    if (adapter_state != STATE_RUNNING) return;
+void disconnect_instrument(instruments_e instrument) {
+    if (instrument < N_INSTRUMENTS) control_post(CONTROL_DISCONNECT, instrument, 0);
+}
 
-    grab_packet(&out_packet, instrument, true);
-    xbox_fifo_write(&out_packet);
+bool instrument_is_connected(instruments_e instrument) {
+    return instrument < N_INSTRUMENTS && connected_instruments[instrument];
 }
 
-void disconnect_instrument(instruments_e instrument) {
-    if (!connected_instruments[instrument]) return;
-    OPENRB_DEBUG("%s disconnected!\r\n", instrument_names[instrument]);
-    connected_instruments[instrument] = 0;
+void instrument_set_connected(instruments_e instrument, bool connected) {
+    if (instrument >= N_INSTRUMENTS || connected_instruments[instrument] == connected) return;
+    OPENRB_DEBUG("%s %s!\r\n", instrument_names[instrument],
+                 connected ? "connected" : "disconnected");
+    connected_instruments[instrument] = connected;
+    OPENRB_TRACE(TRACE_INSTRUMENT, instrument, connected);
 
     if (adapter_state != STATE_RUNNING) return;
 
-    grab_packet(&out_packet, instrument, false);
+    grab_packet(&out_packet, instrument, connected);
     xbox_fifo_write(&out_packet);
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "loadgen.h"
+
+#include <hardware/timer.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "adapter.h"
+#include "drums.h"
+#include "events.h"
+#include "instrument_manager.h"
+#include "packet_queue.h"
+#include "profiler.h"
+#include "timebase.h"
+#include "trace.h"
+#include "usb_descriptors.h"
+#include "xbox_one_protocol.h"
+
+extern volatile adapter_state_t adapter_state;
+
+typedef struct {
+    timebase_us_t next_at;
+    uint8_t hits_left;
+} pad_schedule_t;
+
+static loadgen_config_t config = {.mode = LOADGEN_OFF};
+static bool reschedule = false;
+
+static pad_schedule_t pads[LOADGEN_PADS];
+static timebase_us_t controller_next_at;
+static uint8_t controller_buttons;
+
+static uint32_t rng_state = 1;
+
+static uint32_t generated = 0;
+static uint32_t accepted = 0;
+static uint32_t reported = 0;
+
+// xorshift32, only has to be cheap and repeatable for a given seed
+static uint32_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint32_t pad_interval(uint8_t pad) {
+    // nothing faster than the console polls us makes it into a report anyway
+    uint32_t interval = config.pad_interval_ms[pad];
+    if (interval < usb_poll_interval_ms()) interval = usb_poll_interval_ms();
+    if (config.mode == LOADGEN_RANDOM) interval = interval / 2 + next_random() % (interval + 1);
+    return interval;
+}
+
+static void restart_schedule(timebase_us_t now) {
+    for (uint8_t pad = 0; pad < LOADGEN_PADS; pad++) {
+        pads[pad].next_at = now + TIMEBASE_MS(pad_interval(pad));
+        pads[pad].hits_left = config.burst_hits;
+    }
+    controller_next_at = now + TIMEBASE_MS(config.controller_interval_ms);
+}
+
+void loadgen_configure(const loadgen_config_t *new_config) {
+    config = *new_config;
+    if (config.mode >= N_LOADGEN_MODES) config.mode = LOADGEN_OFF;
+    if (!config.velocity) config.velocity = 127;
+
+    // stopping leaves the counts from the run that just ended readable
+    if (config.mode != LOADGEN_OFF) {
+        rng_state = time_us_32() | 1;
+        generated = accepted = reported = 0;
+        // so each run's latency numbers only cover that run
+        profiler_reset(PROFILE_HIT_LATENCY);
+    }
+    reschedule = true;
+    events_post(TASK_LOADGEN);
+}
+
+bool loadgen_active() { return config.mode != LOADGEN_OFF; }
+
+static void fire_pad(uint8_t pad, timebase_us_t now) {
+    generated++;
+    OPENRB_TRACE(TRACE_LOADGEN_HIT, config.notes[pad], pad);
+    drums_inject_note(config.notes[pad], config.velocity);
+
+    pad_schedule_t *schedule = &pads[pad];
+    schedule->next_at = now + TIMEBASE_MS(pad_interval(pad));
+    if (config.burst_hits && --schedule->hits_left == 0) {
+        schedule->next_at += TIMEBASE_MS(config.burst_gap_ms);
+        schedule->hits_left = config.burst_hits;
+    }
+}
+
+// walks the face buttons so every synthetic report differs from the last
+static void send_controller_report(timebase_us_t now) {
+    static xbox_packet_t controller_packet;
+    static xbox_packet_t wla_packet;
+
+    memset(&controller_packet, 0, sizeof(controller_packet));
+    controller_packet.frame.command = CMD_INPUT;
+    controller_buttons = (controller_buttons + 1) & 0x0f;
+    controller_packet.controller_input.buttons.coloredButtonState = controller_buttons;
+
+    fill_drum_input_from_controller(&controller_packet, &wla_packet, DRUMS);
+    xbox_fifo_write(&wla_packet);
+    controller_next_at = now + TIMEBASE_MS(config.controller_interval_ms);
+}
+
+void loadgen_task() {
+    if (config.mode == LOADGEN_OFF || adapter_state != STATE_RUNNING) return;
+
+    timebase_us_t now = timebase_now();
+    if (reschedule) {
+        restart_schedule(now);
+        reschedule = false;
+    }
+
+    bool fired = false;
+    for (uint8_t pad = 0; pad < LOADGEN_PADS; pad++) {
+        if (!config.pad_interval_ms[pad]) continue;
+        if (timebase_reached(pads[pad].next_at, now)) {
+            fire_pad(pad, now);
+            fired = true;
+        }
+        events_post_at(TASK_LOADGEN, pads[pad].next_at);
+    }
+    if (fired) events_post(TASK_DRUM);
+
+    if (config.controller_interval_ms) {
+        if (timebase_reached(controller_next_at, now)) send_controller_report(now);
+        events_post_at(TASK_LOADGEN, controller_next_at);
+    }
+}
+
+void loadgen_hit_accepted() { accepted++; }
+
+void loadgen_hits_reported(uint32_t hits) { reported += hits; }
+
+uint32_t loadgen_generated() { return generated; }
+uint32_t loadgen_accepted() { return accepted; }
+uint32_t loadgen_reported() { return reported; }
@@ -4,15 +4,22 @@
 #include <string.h>
 
 #include "bsp/board_api.h"
+#include "adapter.h"
+#include "bench.h"
+#include "events.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 #include "hardware/timer.h"
 #include "hardware/uart.h"
+#include "hot_path.h"
 #include "instrument_manager.h"
+#include "midi_parser.h"
 #include "orb_debug.h"
 #include "pins_rp2040_usbh.h"
+#include "power_manager.h"
+#include "util.h"
 
-static int count = 0;
-static uint8_t note_on_message[3] = {NoteOn, 0, 0};
+static midi_parser_t OPENRB_CORE0_DATA parser;
 static int alarm_number = 0;
 
 static volatile bool drums_connected = false;
@@ -20,18 +27,6 @@ static volatile bool drums_connected = false;
 // 15 minutes
 static uint32_t serial_timeout_ms = 900000;
 
-static midi_type_e get_type_from_status(uint8_t status) {
-    if ((status < 0x80) || (status == Undefined_F4) || (status == Undefined_F5) ||
-        (status == Undefined_FD))
-        return InvalidType;  // Data bytes and undefined.
-
-    if (status < 0xf0)
-        // Channel message, remove channel nibble.
-        return status & 0xf0;
-
-    return status;
-}
-
 void on_disconnect_timeout_cb() {
     if (drums_connected) {
         disconnect_instrument(DRUMS);
@@ -43,62 +38,93 @@ void setup_disconnect_timer() {
     hardware_alarm_set_callback(alarm_number, on_disconnect_timeout_cb);
 }
 
-void reset_disconnect_timer() {
+void OPENRB_HOT_FUNC(reset_disconnect_timer)() {
     hardware_alarm_cancel(alarm_number);  // Cancel any existing timer
     hardware_alarm_set_target(alarm_number, make_timeout_time_ms(serial_timeout_ms));
 }
 
+// the uart fifo is disabled and drained from the rx irq, so the drum task hears about every byte
+// as it arrives instead of waiting on the fifo's rx timeout
+#define SERIAL_MIDI_RX_BUF_SIZE 64
+
+static volatile uint8_t OPENRB_CORE0_DATA rx_buf[SERIAL_MIDI_RX_BUF_SIZE];
+static volatile uint8_t rx_head = 0;
+static volatile uint8_t rx_tail = 0;
+
+static void OPENRB_HOT_FUNC(on_serial_midi_rx_irq)() {
+    while (uart_is_readable(uart0)) {
+        uint8_t data = uart_getc(uart0);
+        if ((uint8_t)(rx_head - rx_tail) < SERIAL_MIDI_RX_BUF_SIZE) {
+            rx_buf[rx_head % SERIAL_MIDI_RX_BUF_SIZE] = data;
+            rx_head++;
+        }
+    }
+
+    if (power_is_sleeping()) power_request_wake();
+    events_post(TASK_DRUM);
+}
+
 void serial_midi_init() {
     gpio_set_function(PIN_SERIAL1_TX, GPIO_FUNC_UART);
     gpio_set_function(PIN_SERIAL1_RX, GPIO_FUNC_UART);
 
-    OPENRB_DEBUG("uart baud: %d", uart_init(uart0, 31250));  // MIDI baud rate
+    OPENRB_DEBUG("uart baud: %d", uart_init(uart0, SERIAL_MIDI_BAUD));
+
+    midi_parser_init(&parser);
+    uart_set_fifo_enabled(uart0, false);
+    irq_set_exclusive_handler(UART0_IRQ, on_serial_midi_rx_irq);
+    irq_set_enabled(UART0_IRQ, true);
+    uart_set_irq_enables(uart0, true, false);
 
     setup_disconnect_timer();
 }
 
-int serial_midi_read(uint8_t* buf) {
-    while (uart_is_readable(uart0)) {
-        bool status_byte = false;
-        uint8_t data = uart_getc(uart0);
-        midi_type_e type = get_type_from_status(data);
-        switch (type) {
-            case NoteOn:
-                status_byte = true;
-                note_on_message[0] = data;
-                count = 1;
-                break;
-            case InvalidType:
-                // data
-                if (count) {
-                    note_on_message[count] = data;
-                    count++;
-                }
-                break;
-            case ActiveSensing:
-                serial_timeout_ms = 1000;
-                // fallthrough
-            default:
-                status_byte = true;
-                count = 0;
-                break;
-        }
+void serial_midi_assume_connected() {
+    connect_instrument(DRUMS);
+    drums_connected = true;
+    reset_disconnect_timer();
+}
+
+uint8_t OPENRB_HOT_FUNC(serial_midi_read)(midi_event_t* events, uint8_t max_events) {
+    uint8_t n = 0;
+    while (n < max_events && rx_tail != rx_head) {
+        uint8_t data = rx_buf[rx_tail % SERIAL_MIDI_RX_BUF_SIZE];
+        rx_tail++;
 
-        if (status_byte) {
+        if (data == ActiveSensing) serial_timeout_ms = 1000;
+        bool complete = midi_parse_byte(&parser, data, &events[n]);
+
+        // running status means a busy kit can go a long time without sending a status byte
+        if (complete || (data & 0x80)) {
             if (!drums_connected) {
                 connect_instrument(DRUMS);
                 drums_connected = true;
             }
             reset_disconnect_timer();
         }
+        if (complete) n++;
+    }
+
+    return n;
+}
 
-        if (count >= 3) {
-            OPENRB_DEBUG("Found Note On\r\n");
-            memcpy(buf, note_on_message, 3);
-            count = 1;
-            return 3;
+#if OPENRB_BENCH_ENABLED
+void serial_midi_bench() {
+    static const uint8_t message[] = {NoteOn | 9, 38, 100};
+    midi_event_t events[4];
+    bench_t bench;
+
+    // stands in for the rx irq, one whole note on per read
+    bench_begin(&bench, "serial_midi_read");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        for (uint8_t b = 0; b < sizeof(message); b++) {
+            rx_buf[rx_head % SERIAL_MIDI_RX_BUF_SIZE] = message[b];
+            rx_head++;
         }
+        uint32_t start = bench_start(&bench);
+        serial_midi_read(events, UTIL_NUM(events));
+        bench_sample(&bench, start);
     }
-
-    return 0;
-}
\ No newline at end of file
+    bench_end(&bench);
+}
+#endif
@@ -0,0 +1,116 @@
+#include "midi_parser.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.h"
+#include "hot_path.h"
+
+#define NOT_A_MESSAGE 0xff
+#define SYSEX_DATA 0xfe
+
+// data bytes following each status - channel messages by high nibble (0x8-0xE), system messages
+// by low nibble (0xF0-0xFF)
+static const uint8_t OPENRB_HOT_DATA channel_data_len[7] = {2, 2, 2, 2, 1, 1, 2};
+static const uint8_t OPENRB_HOT_DATA system_data_len[16] = {
+        SYSEX_DATA, 1, 2, 1, NOT_A_MESSAGE, NOT_A_MESSAGE, 0, NOT_A_MESSAGE,  // common
+        0,          0, 0, 0, 0,             NOT_A_MESSAGE, 0, 0,              // realtime
+};
+
+void midi_parser_init(midi_parser_t *parser) { memset(parser, 0, sizeof(*parser)); }
+
+static uint8_t OPENRB_HOT_FUNC(data_len)(uint8_t status) {
+    if (status < 0x80) return NOT_A_MESSAGE;
+    if (status < 0xf0) return channel_data_len[(status >> 4) - 8];
+    return system_data_len[status & 0x0f];
+}
+
+midi_type_e OPENRB_HOT_FUNC(midi_get_type_from_status)(uint8_t status) {
+    if (data_len(status) == NOT_A_MESSAGE) return InvalidType;  // data bytes and undefined
+    // channel message, remove channel nibble
+    if (status < 0xf0) return status & 0xf0;
+    return status;
+}
+
+static void OPENRB_HOT_FUNC(emit)(uint8_t status, const uint8_t *data, midi_event_t *event) {
+    event->type = midi_get_type_from_status(status);
+    event->channel = status < 0xf0 ? status & 0x0f : 0;
+    event->data1 = data ? data[0] : 0;
+    event->data2 = data ? data[1] : 0;
+    if (event->type == NoteOn && event->data2 == 0) event->type = NoteOff;
+}
+
+bool OPENRB_HOT_FUNC(midi_parse_byte)(midi_parser_t *parser, uint8_t byte, midi_event_t *event) {
+    if (byte >= Clock) {
+        if (data_len(byte) == NOT_A_MESSAGE) return false;
+        emit(byte, NULL, event);
+        return true;
+    }
+
+    if (byte & 0x80) {
+        uint8_t len = data_len(byte);
+        parser->in_sysex = len == SYSEX_DATA;
+        parser->count = 0;
+        parser->data[1] = 0;
+        if (len == NOT_A_MESSAGE || len == SYSEX_DATA) {
+            parser->status = 0;
+            return false;
+        }
+        if (len == 0) {
+            parser->status = 0;
+            emit(byte, NULL, event);
+            return true;
+        }
+        parser->status = byte;
+        parser->expected = len;
+        return false;
+    }
+
+    if (parser->in_sysex || !parser->status) return false;
+
+    parser->data[parser->count++] = byte;
+    if (parser->count < parser->expected) return false;
+
+    emit(parser->status, parser->data, event);
+    parser->count = 0;
+    parser->data[1] = 0;
+    // only channel messages carry running status
+    if (parser->status >= 0xf0) parser->status = 0;
+    return true;
+}
+
+uint8_t OPENRB_HOT_FUNC(midi_parse)(midi_parser_t *parser, const uint8_t *bytes, uint32_t len,
+                                    midi_event_t *events, uint8_t max_events, uint32_t *consumed) {
+    uint8_t n = 0;
+    uint32_t i = 0;
+    while (i < len && n < max_events) {
+        if (midi_parse_byte(parser, bytes[i++], &events[n])) n++;
+    }
+    *consumed = i;
+    return n;
+}
+
+#if OPENRB_BENCH_ENABLED
+void midi_parser_bench() {
+    // a dense running status stream with a clock in the middle of a message, as a kit sends it
+    static const uint8_t stream[] = {
+            0x99, 36, 100, 38, 90,  42, 80, 46, 70,  49, 127, 51, 60, 36, 0,   38,
+            0,    42, 0,   46, 0xf8, 0,  49, 0,  51, 0,  36, 100, 38, 90, 42, 80,
+            46,   70, 49,  127, 51, 60, 36, 0,  38, 0,   42, 0,  46, 0,  49, 0,
+    };
+    static midi_event_t events[sizeof(stream)];
+    midi_parser_t parser;
+    uint32_t consumed;
+    bench_t bench;
+
+    midi_parser_init(&parser);
+    bench_begin(&bench, "midi_parse_48_bytes");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t start = bench_start(&bench);
+        midi_parse(&parser, stream, sizeof(stream), events, sizeof(stream), &consumed);
+        bench_sample(&bench, start);
+    }
+    bench_end(&bench);
+}
+#endif
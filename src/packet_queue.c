@@ -1,5 +1,45 @@
 #include "packet_queue.h"  // IWYU pragma: export
 
+#include "bench.h"
+#include "events.h"
+#include "hot_path.h"
+#include "stats.h"
+
 #define XBOX_FIFO_SIZE 16
 
-CREATE_GENERIC_FIFO(xbox, xbox_packet_t, XBOX_FIFO_SIZE, false, true)
+static void xbox_fifo_written(uint32_t written);
+
+CREATE_GENERIC_FIFO(xbox, xbox_packet_t, XBOX_FIFO_SIZE, false, true, xbox_fifo_written)
+
+static void OPENRB_HOT_FUNC(xbox_fifo_written)(uint32_t written) {
+    if (!written) {
+        stats_inc(STAT_FIFO_WRITE_FAILURES);
+        return;
+    }
+    stats_fifo_level(xbox_fifo_count());
+    events_post(TASK_SEND);
+}
+
+#if OPENRB_BENCH_ENABLED
+void packet_queue_bench() {
+    static xbox_packet_t packet;
+    bench_t write_bench;
+    bench_t read_bench;
+
+    xbox_fifo_clear();
+    init_packet(&packet, 0, sizeof(xb_one_drum_input_pkt_t));
+    bench_begin(&write_bench, "xbox_fifo_write");
+    bench_begin(&read_bench, "xbox_fifo_read");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t start = bench_start(&write_bench);
+        xbox_fifo_write(&packet);
+        bench_sample(&write_bench, start);
+
+        start = bench_start(&read_bench);
+        xbox_fifo_read(&packet);
+        bench_sample(&read_bench, start);
+    }
+    bench_end(&write_bench);
+    bench_end(&read_bench);
+}
+#endif
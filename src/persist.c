@@ -0,0 +1,274 @@
+#include "persist.h"
+
+#include <hardware/exception.h>
+#include <hardware/flash.h>
+#include <hardware/structs/psm.h>
+#include <hardware/structs/vreg_and_chip_reset.h>
+#include <hardware/structs/watchdog.h>
+#include <hardware/sync.h>
+#include <hardware/watchdog.h>
+#include <pico/multicore.h>
+#include <pico/platform.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "adapter.h"
+#include "orb_debug.h"
+#include "profiler.h"
+#include "stats.h"
+#include "supervisor.h"
+
+extern volatile adapter_state_t adapter_state;
+
+#define PERSIST_MAGIC 0x6f726270  // "orbp"
+#define LOG_OFFSET (PICO_FLASH_SIZE_BYTES - PERSIST_LOG_SECTORS * FLASH_SECTOR_SIZE)
+#define SLOTS_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define LOG_SLOTS (PERSIST_LOG_SECTORS * SLOTS_PER_SECTOR)
+
+_Static_assert(sizeof(persist_record_t) <= FLASH_PAGE_SIZE, "a record has to fit in a flash page");
+
+// the runtime's startup doesn't touch this, so whatever the last boot wrote is still here after
+// any reset that kept sram powered - a power on leaves garbage that the magic and crc catch
+static persist_record_t __uninitialized_ram(retained);
+
+// LOG_SLOTS when the log's empty
+static uint32_t newest_slot = LOG_SLOTS;
+static uint32_t sequence = 0;
+
+// the sector the log moves into after the one it's in, erased ahead of time - at boot or while
+// nobody's playing - so a checkpoint in the middle of a session only ever programs a page
+static uint32_t ahead_sector = 0;
+static bool ahead_erased = false;
+
+static persist_record_t checkpointed;
+static timebase_us_t checkpointed_at = 0;
+static uint32_t last_hits = 0;
+static timebase_us_t last_hit_at = 0;
+
+// record_fault runs these from ram, the fault may have come in the middle of a flash write
+static uint32_t __not_in_flash_func(crc32)(const void *data, size_t length) {
+    const uint8_t *bytes = data;
+    uint32_t crc = 0xffffffff;
+    while (length--) {
+        crc ^= *bytes++;
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static uint32_t __not_in_flash_func(record_crc)(const persist_record_t *record) {
+    return crc32(record, offsetof(persist_record_t, crc));
+}
+
+static bool record_valid(const persist_record_t *record) {
+    return record->magic == PERSIST_MAGIC && record->version == PERSIST_VERSION &&
+           record->size == sizeof(*record) && record->crc == record_crc(record);
+}
+
+static inline const persist_record_t *log_slot(uint32_t slot) {
+    return (const persist_record_t *)(uintptr_t)(XIP_BASE + LOG_OFFSET + slot * FLASH_PAGE_SIZE);
+}
+
+static bool sector_erased(uint32_t sector) {
+    uint32_t offset = LOG_OFFSET + sector * FLASH_SECTOR_SIZE;
+    const uint32_t *words = (const uint32_t *)(uintptr_t)(XIP_BASE + offset);
+    for (uint32_t i = 0; i < FLASH_SECTOR_SIZE / sizeof(uint32_t); i++) {
+        if (words[i] != 0xffffffff) return false;
+    }
+    return true;
+}
+
+static void scan_log() {
+    for (uint32_t slot = 0; slot < LOG_SLOTS; slot++) {
+        const persist_record_t *record = log_slot(slot);
+        if (!record_valid(record)) continue;
+        if (newest_slot == LOG_SLOTS || (int32_t)(record->sequence - sequence) > 0) {
+            newest_slot = slot;
+            sequence = record->sequence;
+        }
+    }
+    ahead_sector = newest_slot == LOG_SLOTS ? 0 : newest_slot / SLOTS_PER_SECTOR + 1;
+    ahead_sector %= PERSIST_LOG_SECTORS;
+    ahead_erased = sector_erased(ahead_sector);
+}
+
+// nothing can run from flash while it's being written, so with core 1 running it has to be held
+// off too. re-arming the watchdog feeds it, so each write starts with the whole timeout in hand
+static void write_flash(uint32_t offset, const uint8_t *page, bool lockout) {
+    // not armed yet at boot, supervisor_init comes after persist_init
+    bool watched = watchdog_hw->ctrl & WATCHDOG_CTRL_ENABLE_BITS;
+
+    if (lockout) multicore_lockout_start_blocking();
+    if (watched) watchdog_enable(page ? WATCHDOG_TIMEOUT_MS : PERSIST_ERASE_WATCHDOG_MS, true);
+    uint32_t save = save_and_disable_interrupts();
+    if (page) {
+        flash_range_program(offset, page, FLASH_PAGE_SIZE);
+    } else {
+        flash_range_erase(offset, FLASH_SECTOR_SIZE);
+    }
+    restore_interrupts(save);
+    if (watched && !page) watchdog_enable(WATCHDOG_TIMEOUT_MS, true);
+    if (lockout) multicore_lockout_end_blocking();
+}
+
+static void erase_ahead(bool lockout) {
+    write_flash(LOG_OFFSET + ahead_sector * FLASH_SECTOR_SIZE, NULL, lockout);
+    ahead_erased = true;
+}
+
+// everything after the newest record is always blank, so this only programs - false if the next
+// slot is in the sector ahead and that hasn't been erased yet
+static bool checkpoint(const persist_record_t *record, bool lockout) {
+    static uint8_t page[FLASH_PAGE_SIZE] __attribute__((aligned(4)));
+    uint32_t slot = newest_slot == LOG_SLOTS ? 0 : (newest_slot + 1) % LOG_SLOTS;
+    bool enters_ahead = slot % SLOTS_PER_SECTOR == 0;
+    if (enters_ahead && !ahead_erased) return false;
+
+    memset(page, 0xff, sizeof(page));
+    persist_record_t *copy = (persist_record_t *)page;
+    *copy = *record;
+    copy->sequence = ++sequence;
+    copy->crc = record_crc(copy);
+    write_flash(LOG_OFFSET + slot * FLASH_PAGE_SIZE, page, lockout);
+
+    newest_slot = slot;
+    if (enters_ahead) {
+        ahead_sector = (ahead_sector + 1) % PERSIST_LOG_SECTORS;
+        ahead_erased = false;
+    }
+    return true;
+}
+
+static void refresh(timebase_us_t now) {
+    profile_report_t latency;
+    profiler_get(PROFILE_HIT_LATENCY, &latency);
+
+    retained.uptime_ms = now / 1000;
+    retained.adapter_state = adapter_state;
+    retained.fifo_high_water = stats_fifo_high_water();
+    retained.fifo_write_failures = stats_get(STAT_FIFO_WRITE_FAILURES);
+    retained.control_dropped = stats_get(STAT_CONTROL_DROPPED);
+    retained.host_restarts = stats_get(STAT_HOST_RESTARTS);
+    retained.device_recoveries = stats_get(STAT_DEVICE_RECOVERIES);
+    retained.hits_accepted = stats_get(STAT_HITS_ACCEPTED);
+    retained.hit_latency_count = latency.count;
+    retained.hit_latency_p50_us = latency.p50_us;
+    retained.hit_latency_p99_us = latency.p99_us;
+    retained.hit_latency_max_us = latency.max_us;
+    retained.hit_latency_over_budget = latency.over_budget;
+    retained.crc = record_crc(&retained);
+}
+
+// r0 is the exception frame the faulting core pushed - r0-r3, r12, lr, pc, xpsr - on the main
+// stack, nothing here runs with a process stack
+static void __attribute__((used)) __not_in_flash_func(record_fault)(const uint32_t *frame) {
+    retained.fault_lr = frame[5];
+    retained.fault_pc = frame[6];
+    retained.fault_core = get_core_num();
+    retained.crc = record_crc(&retained);
+
+    // what watchdog_reboot(0, 0, 0) does, it's in flash - reset everything but the oscillators,
+    // boot normally rather than to a pc, and trigger it now
+    psm_hw->wdsel = PSM_WDSEL_BITS & ~(PSM_WDSEL_ROSC_BITS | PSM_WDSEL_XOSC_BITS);
+    watchdog_hw->scratch[4] = 0;
+    hw_set_bits(&watchdog_hw->ctrl, WATCHDOG_CTRL_TRIGGER_BITS);
+    while (true) tight_loop_contents();
+}
+
+static void __attribute__((naked)) on_hard_fault() {
+    __asm volatile(
+            "mrs r0, msp\n"
+            "ldr r1, =record_fault\n"
+            "bx r1\n");
+}
+
+static reset_reason_e reset_reason(bool faulted) {
+    // both bits are clear after anything but a watchdog reset
+    if (watchdog_hw->reason & WATCHDOG_REASON_TIMER_BITS) return RESET_WATCHDOG;
+    if (watchdog_hw->reason & WATCHDOG_REASON_FORCE_BITS) {
+        return faulted ? RESET_FAULT : RESET_REBOOT;
+    }
+
+    uint32_t chip_reset = vreg_and_chip_reset_hw->chip_reset;
+    if (chip_reset & VREG_AND_CHIP_RESET_CHIP_RESET_HAD_PSM_RESTART_BITS) return RESET_DEBUGGER;
+    if (chip_reset & VREG_AND_CHIP_RESET_CHIP_RESET_HAD_RUN_BITS) return RESET_RUN_PIN;
+    return RESET_POWER_ON;
+}
+
+void persist_init() {
+    scan_log();
+    uint32_t boot = newest_slot < LOG_SLOTS ? log_slot(newest_slot)->boot + 1 : 0;
+
+    bool faulted = false;
+    if (record_valid(&retained)) {
+        // the last boot, with whatever it got up to after its last checkpoint - nothing else is
+        // running yet, so this is the one checkpoint that doesn't have to wait for a quiet kit
+        faulted = retained.fault_pc != 0;
+        boot = retained.boot + 1;
+        if (!ahead_erased) erase_ahead(false);
+        checkpoint(&retained, false);
+    }
+    // and again for the sector after, so none of this boot's checkpoints have to
+    if (!ahead_erased) erase_ahead(false);
+
+    memset(&retained, 0, sizeof(retained));
+    retained.magic = PERSIST_MAGIC;
+    retained.version = PERSIST_VERSION;
+    retained.size = sizeof(retained);
+    retained.boot = boot;
+    retained.reset_reason = reset_reason(faulted);
+
+    supervisor_resume_t resume;
+    if (supervisor_resumed(&resume)) retained.recovery = resume.reason;
+
+    refresh(timebase_now());
+    checkpointed = retained;
+    OPENRB_DEBUG("boot %lu, reset reason %d\r\n", (unsigned long)boot, retained.reset_reason);
+
+    exception_set_exclusive_handler(HARDFAULT_EXCEPTION, on_hard_fault);
+}
+
+static bool changed_since_checkpoint() {
+    size_t from = offsetof(persist_record_t, reset_reason);
+    size_t to = offsetof(persist_record_t, crc);
+    return memcmp((const uint8_t *)&retained + from, (const uint8_t *)&checkpointed + from,
+                  to - from) != 0;
+}
+
+void persist_update(timebase_us_t now) {
+    refresh(now);
+    if (retained.hits_accepted != last_hits) {
+        last_hits = retained.hits_accepted;
+        last_hit_at = now;
+    }
+
+    if (!timebase_reached(last_hit_at + TIMEBASE_MS(PERSIST_CHECKPOINT_QUIET_MS), now)) return;
+    // an erase stalls both cores for tens of ms, far too long for a kit that's only paused - a
+    // checkpoint that reaches the sector ahead before it's erased waits until we're not running
+    if (adapter_state != STATE_RUNNING && !ahead_erased) erase_ahead(true);
+
+    if (!timebase_reached(checkpointed_at + TIMEBASE_MS(PERSIST_CHECKPOINT_INTERVAL_MS), now)) {
+        return;
+    }
+    if (!changed_since_checkpoint()) return;
+
+    if (!checkpoint(&retained, true)) return;
+    checkpointed = retained;
+    checkpointed_at = now;
+}
+
+bool persist_get(uint32_t index, persist_record_t *record) {
+    if (index == 0) {
+        *record = retained;
+        return true;
+    }
+    if (newest_slot == LOG_SLOTS || index > LOG_SLOTS) return false;
+
+    // the log is written in order, so the index'th newest is that many slots back - unless it's
+    // wrapped into a sector that's been erased since
+    const persist_record_t *logged = log_slot((newest_slot + LOG_SLOTS - (index - 1)) % LOG_SLOTS);
+    if (!record_valid(logged) || sequence - logged->sequence != index - 1) return false;
+    *record = *logged;
+    return true;
+}
@@ -0,0 +1,140 @@
+#include "power_manager.h"
+
+#include <hardware/gpio.h>
+#include <hardware/structs/scb.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+#include <hardware/uart.h>
+#include <host/usbh.h>
+#include <pico/stdlib.h>
+
+#include "adapter.h"
+#include "events.h"
+#include "orb_debug.h"
+#include "pins_rp2040_usbh.h"
+#include "profiler.h"
+#include "timebase.h"
+#include "trace.h"
+#include "xbox_controller_driver.h"
+
+static volatile bool sleep_requested = false;
+static volatile bool wake_requested = false;
+static volatile bool sleeping = false;
+
+// handshake with core 1, core 0 sets gated and waits for core 1 to say it's out of tuh_task
+static volatile bool host_gated = false;
+static volatile bool host_parked = false;
+// false if core 1 never parked and the clock was left alone
+static bool clocked_down = false;
+// core 1 only, the host stack's been stopped for parking
+static bool host_stopped = false;
+
+void power_request_sleep() {
+    wake_requested = false;
+    sleep_requested = true;
+    events_post(TASK_POWER);
+}
+
+void power_request_wake() {
+    sleep_requested = false;
+    wake_requested = true;
+    events_post(TASK_POWER);
+}
+
+bool power_sleep_pending() { return sleep_requested; }
+
+bool power_wake_pending() { return wake_requested; }
+
+bool power_is_sleeping() { return sleeping; }
+
+bool power_host_parked() { return host_parked; }
+
+static void set_sys_clock(uint32_t khz) {
+    set_sys_clock_khz(khz, true);
+    // clk_peri follows clk_sys, so both uarts need their dividers recalculated
+    uart_set_baudrate(DEBUG_UART_ID, OPENRB_TRACE_ENABLED ? TRACE_UART_BAUD : DEBUG_UART_BAUD);
+    uart_set_baudrate(uart0, SERIAL_MIDI_BAUD);
+}
+
+void power_enter_sleep() {
+    sleep_requested = false;
+    if (sleeping) return;
+
+    OPENRB_DEBUG("entering low power\r\n");
+
+    host_parked = false;
+    host_gated = true;
+    __sev();
+    timebase_us_t give_up_at = timebase_now() + TIMEBASE_MS(HOST_PARK_TIMEOUT_MS);
+    while (!host_parked && !timebase_reached(give_up_at, timebase_now())) tight_loop_contents();
+
+    gpio_put(PIN_5V_EN, 0);
+    // a core 1 that's still in tuh_task is wedged, the supervisor restarts it - pio-usb is timed
+    // off clk_sys, so the clock stays where it is rather than changing under it
+    clocked_down = host_parked;
+    if (clocked_down) {
+        set_sys_clock(SLEEP_SYS_CLOCK_KHZ);
+    } else {
+        OPENRB_DEBUG("core 1 didn't park, staying at full clock\r\n");
+    }
+
+    sleeping = true;
+    OPENRB_TRACE(TRACE_POWER, 1, 0);
+}
+
+void power_exit_sleep() {
+    wake_requested = false;
+    if (!sleeping) return;
+
+    if (clocked_down) set_sys_clock(SYS_CLOCK_KHZ);
+    clocked_down = false;
+    gpio_put(PIN_5V_EN, 1);
+
+    host_parked = false;
+    host_gated = false;
+    __sev();
+
+    sleeping = false;
+    OPENRB_TRACE(TRACE_POWER, 0, 0);
+    OPENRB_DEBUG("exited low power\r\n");
+}
+
+void power_host_init() {
+    // same trick as events_wait, lets us time the wfe with interrupts masked
+    scb_hw->scr |= M0PLUS_SCR_SEVONPEND_BITS;
+    host_stopped = false;
+}
+
+void power_host_task() {
+    if (!host_gated) {
+        // back from parking, the controllers enumerate again now the port has power
+        if (host_stopped) {
+            power_host_start_cb();
+            host_stopped = false;
+        }
+
+        // pio-usb does all its work from the sof timer irq on this core and queues events for
+        // tuh_task, so there's nothing to do until an irq fires - the sof timer also means we
+        // come through here at least once a ms for xboxh_task's polling schedule
+        uint32_t save = save_and_disable_interrupts();
+        if (!tuh_task_event_ready()) {
+            uint32_t idle_start = time_us_32();
+            __wfe();
+            profiler_record_idle(time_us_32() - idle_start);
+        }
+        restore_interrupts(save);
+
+        OPENRB_PROFILE(PROFILE_TUH_TASK, tuh_task());
+        xboxh_task();
+        return;
+    }
+
+    // pio-usb does everything off its sof timer, with the stack stopped that's gone too and the
+    // only thing that wakes us is core 0's sev on the way out of sleep (or a flash lockout)
+    if (!host_stopped) {
+        power_host_stop_cb();
+        host_stopped = true;
+    }
+    host_parked = true;
+    __wfe();
+}
@@ -0,0 +1,186 @@
+#include "profiler.h"
+
+#include <hardware/timer.h>
+#include <pico/platform.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "adapter.h"
+#include "hot_path.h"
+
+
+// durations are bucketed with 2 bits of mantissa per power of two (~25% resolution), which is
+// plenty to tell a 40us task from a 60us one and covers up to ~1s in a few hundred bytes
+#define MANTISSA_BITS 2
+#define SUB_BUCKETS (1 << MANTISSA_BITS)
+#define N_BUCKETS (SUB_BUCKETS * 20)
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t budget_us;
+    uint32_t over_budget;
+    uint32_t buckets[N_BUCKETS];
+} profile_t;
+
+static profile_t profiles[N_PROFILES];
+
+// resets are requested from wherever and carried out by the core that owns the profile
+static volatile bool reset_requested[N_PROFILES];
+static volatile bool overrun[N_PROFILES];
+
+static const uint32_t default_budget_us[N_PROFILES] = {
+        [PROFILE_TUD_TASK] = 200,  [PROFILE_POWER_TASK] = 1000, [PROFILE_ANNOUNCE_TASK] = 100,
+        [PROFILE_SEND_TASK] = 100, [PROFILE_DRUM_TASK] = 200,   [PROFILE_CORE0_LOOP] = 500,
+        [PROFILE_TUH_TASK] = 500,
+        [PROFILE_HIT_LATENCY] = HIT_LATENCY_BUDGET_US(ADAPTER_IN_INTERVAL),
+        [PROFILE_IN_POLL] = IN_POLL_BUDGET_US(ADAPTER_IN_INTERVAL),
+};
+
+static uint32_t OPENRB_HOT_FUNC(bucket_for)(uint32_t us) {
+    if (us < SUB_BUCKETS) return us;
+
+    uint32_t exponent = 31 - __builtin_clz(us);
+    uint32_t mantissa = (us >> (exponent - MANTISSA_BITS)) & (SUB_BUCKETS - 1);
+    uint32_t bucket = (exponent - MANTISSA_BITS + 1) * SUB_BUCKETS + mantissa;
+    return bucket < N_BUCKETS ? bucket : N_BUCKETS - 1;
+}
+
+// largest duration that lands in a bucket
+static uint32_t bucket_upper_us(uint32_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+
+    uint32_t exponent = bucket / SUB_BUCKETS + MANTISSA_BITS - 1;
+    uint32_t mantissa = bucket % SUB_BUCKETS;
+    return ((SUB_BUCKETS + mantissa + 1) << (exponent - MANTISSA_BITS)) - 1;
+}
+
+static void clear_profile(profile_e profile) {
+    profile_t *p = &profiles[profile];
+    uint32_t budget_us = p->budget_us ? p->budget_us : default_budget_us[profile];
+    memset(p, 0, sizeof(*p));
+    p->min_us = UINT32_MAX;
+    p->budget_us = budget_us;
+}
+
+void OPENRB_HOT_FUNC(profiler_record)(profile_e profile, uint32_t elapsed_us) {
+    if (profile >= N_PROFILES) return;
+    profile_t *p = &profiles[profile];
+
+    if (reset_requested[profile] || !p->budget_us) {
+        reset_requested[profile] = false;
+        clear_profile(profile);
+    }
+
+    p->count++;
+    p->total_us += elapsed_us;
+    if (elapsed_us < p->min_us) p->min_us = elapsed_us;
+    if (elapsed_us > p->max_us) p->max_us = elapsed_us;
+    p->buckets[bucket_for(elapsed_us)]++;
+
+    if (elapsed_us > p->budget_us) {
+        p->over_budget++;
+        overrun[profile] = true;
+    }
+}
+
+static uint32_t percentile_us(const profile_t *p, uint32_t target, uint32_t max_us) {
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < N_BUCKETS; i++) {
+        seen += p->buckets[i];
+        if (seen >= target) {
+            uint32_t upper_us = bucket_upper_us(i);
+            return upper_us < max_us ? upper_us : max_us;
+        }
+    }
+    return max_us;
+}
+
+// the owning core may be mid-update, so a report can be off by the sample in flight
+void profiler_get(profile_e profile, profile_report_t *report) {
+    memset(report, 0, sizeof(*report));
+    if (profile >= N_PROFILES) return;
+    const profile_t *p = &profiles[profile];
+
+    report->budget_us = p->budget_us ? p->budget_us : default_budget_us[profile];
+    report->count = p->count;
+    if (!report->count) return;
+
+    report->min_us = p->min_us;
+    report->max_us = p->max_us;
+    report->avg_us = (uint32_t)(p->total_us / report->count);
+    report->over_budget = p->over_budget;
+
+    report->p50_us = percentile_us(p, (report->count + 1) / 2, report->max_us);
+    report->p99_us = percentile_us(p, report->count - report->count / 100, report->max_us);
+}
+
+void profiler_set_budget(profile_e profile, uint32_t budget_us) {
+    if (profile >= N_PROFILES || !budget_us) return;
+    profile_t *p = &profiles[profile];
+    // a zero budget is what tells profiler_record the profile was never cleared, so a budget set
+    // before the first record has to clear it here or min_us stays 0 for good
+    if (!p->budget_us) clear_profile(profile);
+    p->budget_us = budget_us;
+}
+
+void profiler_reset(profile_e profile) {
+    if (profile >= N_PROFILES) return;
+    reset_requested[profile] = true;
+}
+
+typedef struct {
+    volatile uint32_t idle_us;  // running total, only ever added to by the core it belongs to
+    // the rest belongs to profiler_update_utilization on core 0
+    timebase_us_t window_start;
+    uint32_t window_start_idle_us;
+    volatile uint16_t utilization_permille;
+} core_load_t;
+
+static core_load_t core_load[2];
+
+void profiler_record_idle(uint32_t idle_us) {
+    core_load[get_core_num()].idle_us += idle_us;
+}
+
+// a core that never gets as far as wfe records no idle at all and comes out at 100%, a sleep
+// that's still going when the window closes is counted in the next one - neither core sleeps
+// longer than a supervisor pass, so that's never more than a couple of percent
+void profiler_update_utilization(timebase_us_t now) {
+    for (uint8_t core = 0; core < 2; core++) {
+        core_load_t *load = &core_load[core];
+        uint32_t idle_total_us = load->idle_us;
+        if (!load->window_start) {
+            load->window_start = now;
+            load->window_start_idle_us = idle_total_us;
+            continue;
+        }
+
+        uint64_t elapsed_us = now - load->window_start;
+        if (elapsed_us < PROFILER_UTILIZATION_WINDOW_US) continue;
+
+        uint64_t idle = idle_total_us - load->window_start_idle_us;
+        if (idle > elapsed_us) idle = elapsed_us;
+        load->utilization_permille = 1000 - (uint16_t)((idle * 1000) / elapsed_us);
+        load->window_start = now;
+        load->window_start_idle_us = idle_total_us;
+    }
+}
+
+uint16_t profiler_utilization_permille(uint8_t core) {
+    return core < 2 ? core_load[core].utilization_permille : 0;
+}
+
+uint32_t profiler_take_overruns() {
+    uint32_t overruns = 0;
+    for (int i = FIRST_PROFILE; i < N_PROFILES; i++) {
+        if (!overrun[i]) continue;
+        overrun[i] = false;
+        overruns |= 1u << i;
+    }
+    return overruns;
+}
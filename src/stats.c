@@ -0,0 +1,91 @@
+#include "stats.h"
+
+#include <hardware/sync.h>
+#include <pico/platform.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "adapter.h"
+#include "boot_report.h"
+#include "hot_path.h"
+#include "loadgen.h"
+#include "profiler.h"
+#include "supervisor.h"
+#include "timebase.h"
+#include "usb_descriptors.h"
+
+extern volatile adapter_state_t adapter_state;
+
+// one set per core so neither core's read-modify-write can land on top of the other's, readers sum
+// them. masking interrupts keeps producers on the same core from losing counts
+static volatile uint32_t counters[2][N_STATS];
+static volatile uint8_t fifo_high_water[2];
+
+void OPENRB_HOT_FUNC(stats_inc)(stat_e stat) {
+    if (stat >= N_STATS) return;
+    uint32_t save = save_and_disable_interrupts();
+    counters[get_core_num()][stat]++;
+    restore_interrupts(save);
+}
+
+void OPENRB_HOT_FUNC(stats_fifo_level)(uint32_t count) {
+    volatile uint8_t *high_water = &fifo_high_water[get_core_num()];
+    if (count > *high_water) *high_water = count > UINT8_MAX ? UINT8_MAX : count;
+}
+
+uint32_t stats_get(stat_e stat) {
+    return stat < N_STATS ? counters[0][stat] + counters[1][stat] : 0;
+}
+
+uint8_t stats_fifo_high_water() {
+    return fifo_high_water[0] > fifo_high_water[1] ? fifo_high_water[0] : fifo_high_water[1];
+}
+
+void stats_snapshot(stats_block_t *block) {
+    memset(block, 0, sizeof(*block));
+    block->version = STATS_VERSION;
+    block->size = sizeof(*block);
+    block->later_counters_offset = offsetof(stats_block_t, later_counters);
+    block->uptime_ms = timebase_now() / 1000;
+    block->adapter_state = adapter_state;
+    block->fifo_high_water = stats_fifo_high_water();
+    for (int i = 0; i < N_STATS_V1; i++) block->counters[i] = stats_get(i);
+    for (int i = N_STATS_V1; i < N_STATS; i++) block->later_counters[i - N_STATS_V1] = stats_get(i);
+    for (int i = FIRST_BOOT_PHASE; i < N_BOOT_PHASES; i++) {
+        block->boot_phase_us[i] = boot_report_get(i);
+    }
+    block->core_utilization_permille[0] = profiler_utilization_permille(0);
+    block->core_utilization_permille[1] = profiler_utilization_permille(1);
+    block->loadgen_active = loadgen_active();
+    block->loadgen_generated = loadgen_generated();
+    block->loadgen_accepted = loadgen_accepted();
+    block->loadgen_reported = loadgen_reported();
+
+    profile_report_t latency;
+    profiler_get(PROFILE_HIT_LATENCY, &latency);
+    block->hit_latency_count = latency.count;
+    block->hit_latency_p50_us = latency.p50_us;
+    block->hit_latency_p99_us = latency.p99_us;
+    block->hit_latency_max_us = latency.max_us;
+    block->hit_latency_budget_us = latency.budget_us;
+    block->hit_latency_over_budget = latency.over_budget;
+
+    supervisor_resume_t resume;
+    if (supervisor_resumed(&resume)) {
+        block->resume_reason = resume.reason;
+        block->resume_state = resume.state;
+        block->supervised_reboots = resume.reboots;
+    }
+
+    profile_report_t poll;
+    profiler_get(PROFILE_IN_POLL, &poll);
+    block->poll_mode = usb_poll_mode();
+    block->poll_interval_ms = usb_poll_interval_ms();
+    block->in_poll_count = poll.count;
+    block->in_poll_min_us = poll.min_us;
+    block->in_poll_avg_us = poll.avg_us;
+    block->in_poll_max_us = poll.max_us;
+    block->in_poll_budget_us = poll.budget_us;
+    block->in_poll_over_budget = poll.over_budget;
+}
@@ -0,0 +1,157 @@
+#include "supervisor.h"
+
+#include <hardware/structs/watchdog.h>
+#include <hardware/watchdog.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adapter.h"
+#include "events.h"
+#include "hot_path.h"
+#include "instrument_manager.h"
+#include "orb_debug.h"
+#include "persist.h"
+#include "power_manager.h"
+#include "profiler.h"
+#include "stats.h"
+#include "timebase.h"
+#include "trace.h"
+#include "usb_descriptors.h"
+#include "xbox_device_driver.h"
+
+extern volatile adapter_state_t adapter_state;
+
+// scratch 0-3 are ours, the sdk's watchdog_reboot() uses 4-7
+#define RESUME_MAGIC 0x6f726273  // "orbs"
+#define RESUME_MAGIC_REG 0
+#define RESUME_RECORD_REG 1
+
+static volatile uint32_t core1_beats = 0;
+
+static bool loaded = false;
+static bool resumed = false;
+static supervisor_resume_t resume;
+
+static uint32_t last_beats = 0;
+static timebase_us_t last_beat_at = 0;
+
+static timebase_us_t window_start = 0;
+static uint8_t recoveries = 0;
+
+static void write_record(recovery_e reason) {
+    uint8_t instruments = 0;
+    for (int i = FIRST_INSTRUMENT; i < N_INSTRUMENTS; i++) {
+        if (instrument_is_connected(i)) instruments |= 1u << i;
+    }
+    uint8_t reboots = resume.reboots;
+    if (reason != RECOVERY_NONE && reboots < UINT8_MAX) reboots++;
+
+    watchdog_hw->scratch[RESUME_RECORD_REG] = reason | (adapter_state << 8) | (instruments << 16) |
+                                              ((uint32_t)reboots << 24);
+    watchdog_hw->scratch[RESUME_MAGIC_REG] = RESUME_MAGIC;
+}
+
+// persist_init asks for the record before supervisor_init runs, whichever comes first reads it
+static void load_record() {
+    if (loaded) return;
+    loaded = true;
+
+    if (watchdog_caused_reboot() && watchdog_hw->scratch[RESUME_MAGIC_REG] == RESUME_MAGIC) {
+        uint32_t record = watchdog_hw->scratch[RESUME_RECORD_REG];
+        resume.reason = record & 0xff;
+        resume.state = (record >> 8) & 0xff;
+        resume.instruments = (record >> 16) & 0xff;
+        resume.reboots = record >> 24;
+        resumed = true;
+        OPENRB_DEBUG("supervised reboot %d (reason %d, state %d)\r\n", resume.reboots,
+                     resume.reason, resume.state);
+    }
+    watchdog_hw->scratch[RESUME_MAGIC_REG] = 0;
+}
+
+void supervisor_init() {
+    load_record();
+
+    // pause_on_debug, so a breakpoint doesn't reset the chip out from under the debugger
+    watchdog_enable(WATCHDOG_TIMEOUT_MS, true);
+    last_beat_at = timebase_now();
+    events_post(TASK_SUPERVISOR);
+}
+
+bool supervisor_resumed(supervisor_resume_t *out) {
+    load_record();
+    if (resumed) *out = resume;
+    return resumed;
+}
+
+void OPENRB_HOT_FUNC(supervisor_core1_beat)() { core1_beats++; }
+
+static bool host_stalled(timebase_us_t now) {
+    uint32_t beats = core1_beats;
+    // parked for sleep, nothing comes round core 1's loop until power_exit_sleep wakes it
+    if (beats != last_beats || power_host_parked()) {
+        last_beats = beats;
+        last_beat_at = now;
+        return false;
+    }
+    return timebase_reached(last_beat_at + TIMEBASE_MS(HOST_STALL_MS), now);
+}
+
+static bool recovery_allowed(timebase_us_t now) {
+    if (timebase_reached(window_start + TIMEBASE_MS(RECOVERY_WINDOW_MS), now)) {
+        window_start = now;
+        recoveries = 0;
+    }
+    return recoveries++ < MAX_RECOVERIES;
+}
+
+static void reboot(recovery_e reason) {
+    OPENRB_DEBUG("recovery %d isn't sticking, rebooting\r\n", reason);
+    write_record(reason);
+    watchdog_reboot(0, 0, 0);
+    while (true) tight_loop_contents();
+}
+
+static void recover(recovery_e reason, timebase_us_t now) {
+    OPENRB_TRACE(TRACE_RECOVERY, reason, recoveries);
+    if (!recovery_allowed(now)) reboot(reason);
+
+    switch (reason) {
+        case RECOVERY_HOST_STALL:
+            OPENRB_DEBUG("core 1 stalled, restarting usb host\r\n");
+            stats_inc(STAT_HOST_RESTARTS);
+            supervisor_restart_host_cb();
+            // core 1 keeps the port powered off for a while before it starts beating again
+            last_beat_at = now + TIMEBASE_MS(HOST_POWER_OFF_MS);
+            break;
+        case RECOVERY_DEVICE_STALL:
+            OPENRB_DEBUG("console stopped collecting reports, re-arming endpoints\r\n");
+            stats_inc(STAT_DEVICE_RECOVERIES);
+            xboxd_recover();
+            // whatever the console missed, it gets told who's plugged in again
+            if (adapter_state == STATE_RUNNING) notify_xbox_of_all_instruments();
+            break;
+        default:
+            break;
+    }
+}
+
+void supervisor_task() {
+    timebase_us_t now = timebase_now();
+    timebase_us_t sent_at;
+    watchdog_update();
+
+    if (host_stalled(now)) {
+        recover(RECOVERY_HOST_STALL, now);
+    } else if (xboxd_in_flight_since(&sent_at) &&
+               timebase_reached(sent_at + TIMEBASE_MS(DEVICE_STALL_MS), now)) {
+        recover(RECOVERY_DEVICE_STALL, now);
+    }
+
+    // anything that resets us before the next pass finds this
+    write_record(RECOVERY_WATCHDOG);
+    usb_poll_check(now);
+    profiler_update_utilization(now);
+    persist_update(now);
+    events_post_at(TASK_SUPERVISOR, now + TIMEBASE_MS(SUPERVISOR_INTERVAL_MS));
+}
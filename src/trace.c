@@ -0,0 +1,165 @@
+#include "trace.h"
+
+#include <hardware/dma.h>
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+#include <hardware/uart.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adapter.h"
+#include "events.h"
+#include "hot_path.h"
+
+#if OPENRB_TRACE_ENABLED
+
+// per core, power of two so head/tail can free-run
+#define TRACE_RING_SIZE 256
+#define N_CORES 2
+
+typedef struct {
+    trace_record_t records[TRACE_RING_SIZE];
+    volatile uint32_t head;  // only written by the owning core
+    volatile uint32_t tail;  // only written by the drain on core 0
+    uint32_t dropped;
+    uint8_t sequence;
+} trace_ring_t;
+
+static trace_ring_t rings[N_CORES];
+
+static int dma_channel = -1;
+static volatile bool dma_busy = false;
+static uint8_t dma_core = 0;
+static uint32_t dma_count = 0;
+
+// start a transfer of the longest contiguous run in the next ring with data, call with irqs off
+static void start_dma() {
+    if (dma_busy) return;
+
+    for (int i = 0; i < N_CORES; i++) {
+        // round robin so a busy core can't starve the other one
+        uint8_t core = (dma_core + 1 + i) % N_CORES;
+        trace_ring_t *ring = &rings[core];
+
+        uint32_t head = ring->head;
+        __dmb();
+        uint32_t available = head - ring->tail;
+        if (!available) continue;
+
+        uint32_t start = ring->tail % TRACE_RING_SIZE;
+        uint32_t count = TRACE_RING_SIZE - start;
+        if (count > available) count = available;
+
+        dma_core = core;
+        dma_count = count;
+        dma_busy = true;
+        dma_channel_transfer_from_buffer_now(dma_channel, &ring->records[start],
+                                             count * sizeof(trace_record_t));
+        return;
+    }
+}
+
+static void on_dma_complete() {
+    if (!dma_channel_get_irq1_status(dma_channel)) return;
+    dma_channel_acknowledge_irq1(dma_channel);
+
+    rings[dma_core].tail += dma_count;
+    dma_busy = false;
+    start_dma();
+}
+
+void trace_init() {
+    uart_init(DEBUG_UART_ID, TRACE_UART_BAUD);
+    gpio_set_function(DEBUG_UART_TX_PIN, GPIO_FUNC_UART);
+
+    dma_channel = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, uart_get_dreq(DEBUG_UART_ID, true));
+    dma_channel_configure(dma_channel, &config, &uart_get_hw(DEBUG_UART_ID)->dr, NULL, 0, false);
+
+    dma_channel_set_irq1_enabled(dma_channel, true);
+    irq_add_shared_handler(DMA_IRQ_1, on_dma_complete,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+}
+
+void OPENRB_HOT_FUNC(trace_event)(trace_event_e event, uint32_t arg0, uint32_t arg1) {
+    uint8_t core = get_core_num();
+    trace_ring_t *ring = &rings[core];
+
+    // producers on a core can be interrupted by other producers on the same core, this is the
+    // only thing guarding the ring against them
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t head = ring->head;
+    if (head - ring->tail >= TRACE_RING_SIZE) {
+        ring->dropped++;
+        ring->sequence++;
+        restore_interrupts(save);
+        return;
+    }
+
+    trace_record_t *record = &ring->records[head % TRACE_RING_SIZE];
+    record->sync = TRACE_SYNC;
+    record->event = event;
+    record->core = core;
+    record->sequence = ring->sequence++;
+    record->time_us = time_us_32();
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+
+    __dmb();
+    ring->head = head + 1;
+    restore_interrupts(save);
+
+    // only need to wake the drain if it might be idle
+    if (!dma_busy) events_post(TASK_TRACE);
+}
+
+void trace_discard() {
+    if (dma_channel >= 0) return;
+    trace_ring_t *ring = &rings[get_core_num()];
+    ring->tail = ring->head;
+}
+
+void trace_core1_reset() {
+    trace_ring_t *ring = &rings[1];
+    uint32_t save = save_and_disable_interrupts();
+    // a transfer already reading the ring keeps its records, tail moves past them when it's done
+    uint32_t keep = ring->tail + (dma_busy && dma_core == 1 ? dma_count : 0);
+    ring->dropped += ring->head - keep;
+    ring->head = keep;
+    restore_interrupts(save);
+}
+
+void trace_drain() {
+    if (dma_channel < 0) return;
+
+    uint32_t save = save_and_disable_interrupts();
+    start_dma();
+    restore_interrupts(save);
+}
+
+uint32_t trace_dropped(uint8_t core) { return core < N_CORES ? rings[core].dropped : 0; }
+
+#else
+
+void trace_init() {}
+void OPENRB_HOT_FUNC(trace_event)(trace_event_e event, uint32_t arg0, uint32_t arg1) {
+    (void)event;
+    (void)arg0;
+    (void)arg1;
+}
+void trace_drain() {}
+void trace_core1_reset() {}
+void trace_discard() {}
+uint32_t trace_dropped(uint8_t core) {
+    (void)core;
+    return 0;
+}
+
+#endif
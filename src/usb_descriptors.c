@@ -1,8 +1,15 @@
+#include "usb_descriptors.h"
+
+#include <stddef.h>
+
 #include "bsp/board_api.h"
 // #include "bsp/board.h"
 #include "adapter.h"
 #include "common/tusb_types.h"
 #include "device/usbd.h"
+#include "hot_path.h"
+#include "orb_debug.h"
+#include "profiler.h"
 #include "tusb.h"
 #include "tusb_option.h"
 
@@ -247,9 +254,79 @@ const struct {
 
 };
 
+// ConfigurationDescriptor with interface 0's endpoints polled every ADAPTER_FAST_INTERVAL, patched
+// from the standard one the first time it's asked for
+static uint8_t fast_configuration[sizeof(ConfigurationDescriptor)];
+
+static poll_mode_e poll_mode = OPENRB_FAST_POLL_ENABLED ? POLL_FAST_PENDING : POLL_STANDARD;
+// when the console first read the fast configuration since it last mounted us, 0 until it has
+static timebase_us_t offered_at = 0;
+static timebase_us_t reconnect_at = 0;
+
+static const uint8_t *fast_configuration_descriptor() {
+    if (fast_configuration[0]) return fast_configuration;
+
+    memcpy(fast_configuration, &ConfigurationDescriptor, sizeof(fast_configuration));
+    fast_configuration[offsetof(__typeof__(ConfigurationDescriptor),
+                                I00ReportOUTEndpoint.PollingIntervalMS)] = ADAPTER_FAST_INTERVAL;
+    fast_configuration[offsetof(__typeof__(ConfigurationDescriptor),
+                                I00ReportINEndpoint.PollingIntervalMS)] = ADAPTER_FAST_INTERVAL;
+    return fast_configuration;
+}
+
 uint8_t const *tud_descriptor_configuration_cb(uint8_t index) {
     (void)index;  // for multiple configurations
-    return (uint8_t const *)&ConfigurationDescriptor;
+    if (poll_mode != POLL_FAST_PENDING && poll_mode != POLL_FAST) {
+        return (uint8_t const *)&ConfigurationDescriptor;
+    }
+
+    if (poll_mode == POLL_FAST_PENDING && !offered_at) offered_at = timebase_now();
+    return fast_configuration_descriptor();
+}
+
+poll_mode_e usb_poll_mode() { return poll_mode; }
+
+uint8_t OPENRB_HOT_FUNC(usb_poll_interval_ms)() {
+    return poll_mode == POLL_FAST ? ADAPTER_FAST_INTERVAL : ADAPTER_IN_INTERVAL;
+}
+
+void usb_poll_mounted() {
+    if (poll_mode != POLL_FAST_PENDING) return;
+
+    OPENRB_DEBUG("console took the %dms configuration\r\n", ADAPTER_FAST_INTERVAL);
+    poll_mode = POLL_FAST;
+    offered_at = 0;
+    profiler_set_budget(PROFILE_IN_POLL, IN_POLL_BUDGET_US(ADAPTER_FAST_INTERVAL));
+    profiler_set_budget(PROFILE_HIT_LATENCY, HIT_LATENCY_BUDGET_US(ADAPTER_FAST_INTERVAL));
+}
+
+void usb_poll_unmounted() {
+    // the next console to enumerate us gets the same chance to refuse it
+    if (poll_mode == POLL_FAST) poll_mode = POLL_FAST_PENDING;
+    offered_at = 0;
+}
+
+void usb_poll_check(timebase_us_t now) {
+    switch (poll_mode) {
+        case POLL_FAST_PENDING:
+            if (!offered_at) break;
+            if (!timebase_reached(offered_at + TIMEBASE_MS(FAST_POLL_MOUNT_TIMEOUT_MS), now)) break;
+
+            OPENRB_DEBUG("console never configured us, falling back to %dms polling\r\n",
+                         ADAPTER_IN_INTERVAL);
+            poll_mode = POLL_FALLING_BACK;
+            reconnect_at = now + TIMEBASE_MS(FAST_POLL_RECONNECT_MS);
+            tud_disconnect();
+            break;
+        case POLL_FALLING_BACK:
+            if (!timebase_reached(reconnect_at, now)) break;
+
+            poll_mode = POLL_FELL_BACK;
+            tud_connect();
+            break;
+        default:
+            break;
+    }
 }
 
 char const *string_desc_arr[] = {
@@ -4,6 +4,8 @@
 
 #include "host/usbh.h"
 #include "host/usbh_pvt.h"
+#include "hot_path.h"
+#include "timebase.h"
 #include "xbox_controller_driver.h"
 
 // Official controllers
@@ -20,9 +22,11 @@
 #define XBOX_ONE_OUTPUT_PIPE 1
 #define XBOX_ONE_INPUT_PIPE 2
 
-#define XBOX_MAX_CONTROLLERS 1
 #define XBOX_ONE_MAX_ENDPOINTS 2
 
+// hubs get addresses after the devices
+#define XBOX_MAX_DADDR (CFG_TUH_DEVICE_MAX + CFG_TUH_HUB)
+
 typedef struct {
     uint8_t daddr;
 
@@ -34,6 +38,11 @@ typedef struct {
     uint16_t epin_size;
     uint16_t epout_size;
 
+    // IN polling is scheduled from the endpoint's bInterval instead of re-arming straight away
+    uint8_t epin_interval;
+    bool epin_armed;
+    timebase_us_t epin_armed_at;
+
     uint16_t VID;
     uint16_t PID;
 
@@ -41,9 +50,18 @@ typedef struct {
     CFG_TUH_MEM_ALIGN xbox_packet_t epout_buf;
 } xbox_interface_t;
 
+// striped main sram rather than core 1's scratch bank - core 0 fills epout_buf and starts the
+// transfer itself when it forwards auth frames (xboxh_send in src/adapter.c)
 CFG_TUH_MEM_SECTION
 tu_static xbox_interface_t _xbox_itf[XBOX_MAX_CONTROLLERS];
 
+// controllers only ever have the one xbox interface, so the device address is enough to find them -
+// only core 1 ever looks
+static uint8_t OPENRB_CORE1_DATA _idx_by_daddr[XBOX_MAX_DADDR + 1];
+
+// set from core 0, 0 means use each endpoint's own bInterval
+static volatile uint8_t poll_interval_override = 0;
+
 static xbox_interface_t *find_new_itf(void) {
     for (uint8_t i = 0; i < XBOX_MAX_CONTROLLERS; i++) {
         if (_xbox_itf[i].daddr == 0)
@@ -59,25 +77,31 @@ TU_ATTR_ALWAYS_INLINE static inline xbox_interface_t *get_xbox_itf(uint8_t daddr
     return (p_hid->daddr == daddr) ? p_hid : NULL;
 }
 
-static uint8_t get_idx_by_epaddr(uint8_t daddr, uint8_t ep_addr) {
-    for (uint8_t idx = 0; idx < XBOX_MAX_CONTROLLERS; idx++) {
-        xbox_interface_t const *p_hid = &_xbox_itf[idx];
+static inline uint8_t get_idx_by_daddr(uint8_t daddr) {
+    if (daddr == 0 || daddr > XBOX_MAX_DADDR)
+        return TUSB_INDEX_INVALID_8;
+    return _idx_by_daddr[daddr];
+}
 
-        if (p_hid->daddr == daddr && (p_hid->ep_in == ep_addr || p_hid->ep_out == ep_addr)) {
-            return idx;
-        }
-    }
+static uint8_t OPENRB_HOT_FUNC(get_idx_by_epaddr)(uint8_t daddr, uint8_t ep_addr) {
+    uint8_t idx = get_idx_by_daddr(daddr);
+    if (idx >= XBOX_MAX_CONTROLLERS)
+        return TUSB_INDEX_INVALID_8;
+
+    xbox_interface_t const *p_hid = &_xbox_itf[idx];
+    if (p_hid->ep_in == ep_addr || p_hid->ep_out == ep_addr)
+        return idx;
 
     return TUSB_INDEX_INVALID_8;
 }
 
 uint8_t xbox_itf_get_index(uint8_t daddr, uint8_t itf_num) {
-    for (uint8_t idx = 0; idx < XBOX_MAX_CONTROLLERS; idx++) {
-        xbox_interface_t const *p_hid = &_xbox_itf[idx];
+    uint8_t idx = get_idx_by_daddr(daddr);
+    if (idx >= XBOX_MAX_CONTROLLERS)
+        return TUSB_INDEX_INVALID_8;
 
-        if (p_hid->daddr == daddr && p_hid->itf_num == itf_num)
-            return idx;
-    }
+    if (_xbox_itf[idx].itf_num == itf_num)
+        return idx;
 
     return TUSB_INDEX_INVALID_8;
 }
@@ -171,7 +195,7 @@ bool xboxh_send_report(uint8_t daddr, uint8_t idx, const void *report, uint16_t
     return true;
 }
 
-bool xboxh_receive_report(uint8_t daddr, uint8_t idx) {
+bool OPENRB_HOT_FUNC(xboxh_receive_report)(uint8_t daddr, uint8_t idx) {
     xbox_interface_t *p_controller = get_xbox_itf(daddr, idx);
     TU_VERIFY(p_controller);
 
@@ -184,11 +208,36 @@ bool xboxh_receive_report(uint8_t daddr, uint8_t idx) {
         return false;
     }
 
+    p_controller->epin_armed = true;
+    p_controller->epin_armed_at = timebase_now();
     return true;
 }
 
+static inline uint8_t poll_interval(xbox_interface_t const *p_controller) {
+    uint8_t interval = poll_interval_override;
+    return interval ? interval : p_controller->epin_interval;
+}
+
+static inline bool poll_due(xbox_interface_t const *p_controller) {
+    return timebase_reached(p_controller->epin_armed_at + TIMEBASE_MS(poll_interval(p_controller)),
+                            timebase_now());
+}
+
+void xboxh_set_poll_interval(uint8_t interval_ms) { poll_interval_override = interval_ms; }
+
+void OPENRB_HOT_FUNC(xboxh_task)(void) {
+    for (uint8_t idx = 0; idx < XBOX_MAX_CONTROLLERS; idx++) {
+        xbox_interface_t *p_controller = &_xbox_itf[idx];
+        if (!p_controller->daddr || !p_controller->ep_in || p_controller->epin_armed) continue;
+        if (!poll_due(p_controller)) continue;
+
+        xboxh_receive_report(p_controller->daddr, idx);
+    }
+}
+
 void xboxh_init(void) {
     tu_memclr(_xbox_itf, sizeof(_xbox_itf));
+    memset(_idx_by_daddr, TUSB_INDEX_INVALID_8, sizeof(_idx_by_daddr));
 }
 
 bool xboxh_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *desc_itf,
@@ -205,6 +254,7 @@ bool xboxh_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *d
     tuh_vid_pid_get(dev_addr, &vid, &pid);
 
     TU_VERIFY(xbox_valid_controller(vid, pid));
+    TU_VERIFY(dev_addr <= XBOX_MAX_DADDR);
 
 #if CFG_TUSB_DEBUG
     print_interface(desc_itf, dev_addr);
@@ -222,8 +272,9 @@ bool xboxh_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *d
         if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
             uint16_t pkt_size = tu_edpt_packet_size(desc_ep);
             TU_ASSERT(pkt_size == XBOX_ONE_EP_MAXPKTSIZE);
-            p_controller->ep_in     = desc_ep->bEndpointAddress;
-            p_controller->epin_size = pkt_size;
+            p_controller->ep_in         = desc_ep->bEndpointAddress;
+            p_controller->epin_size     = pkt_size;
+            p_controller->epin_interval = tu_max8(desc_ep->bInterval, 1);
         } else {
             uint16_t pkt_size = tu_edpt_packet_size(desc_ep);
             TU_ASSERT(pkt_size == XBOX_ONE_EP_MAXPKTSIZE);
@@ -236,6 +287,8 @@ bool xboxh_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *d
     }
     p_controller->itf_num = desc_itf->bInterfaceNumber;
     p_controller->daddr   = dev_addr;
+
+    _idx_by_daddr[dev_addr] = (uint8_t)(p_controller - _xbox_itf);
     p_controller->PID     = pid;
     p_controller->VID     = vid;
     return true;
@@ -253,10 +306,10 @@ static const power_report_t power = {.data = {.frame = {.command  = CMD_POWER_MO
 bool xboxh_set_config(uint8_t daddr, uint8_t itf_num) {
     TU_LOG_USBH("XBOX Set Config addr: %02x interface: %d", daddr, itf_num);
 
-    xbox_interface_t *p_hid = get_xbox_itf(daddr, itf_num);
+    uint8_t idx = xbox_itf_get_index(daddr, itf_num);
+    xbox_interface_t *p_hid = get_xbox_itf(daddr, idx);
     TU_VERIFY(p_hid);
 
-    uint8_t idx = xbox_itf_get_index(daddr, itf_num);
     TU_ASSERT(xboxh_send_report(daddr, idx, power.buffer, sizeof(power)));
 
     wait_for_tx_complete(daddr, p_hid->ep_out);
@@ -273,7 +326,8 @@ bool xboxh_set_config(uint8_t daddr, uint8_t itf_num) {
     return true;
 }
 
-bool xboxh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+bool OPENRB_HOT_FUNC(xboxh_xfer_cb)(uint8_t daddr, uint8_t ep_addr, xfer_result_t result,
+                                    uint32_t xferred_bytes) {
     (void)result;
 
     uint8_t const dir = tu_edpt_dir(ep_addr);
@@ -284,14 +338,17 @@ bool xboxh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_
 
     if (dir == TUSB_DIR_IN) {
         TU_LOG_USBH("  Get Report callback (%u, %u)\r\n", daddr, idx);
+        p_controller->epin_armed = false;
         p_controller->epin_buf.length = xferred_bytes;
-        p_controller->epin_buf.triggered_time = 0;
+        p_controller->epin_buf.triggered_at = 0;
         p_controller->epin_buf.handled = 0;
+        p_controller->epin_buf.hit_time_us = 0;
         if (xboxh_packet_received_cb)
             xboxh_packet_received_cb(idx, &p_controller->epin_buf, xferred_bytes);
 
-        // xbox interface requires active polling
-        TU_ASSERT(xboxh_receive_report(daddr, idx));
+        // xbox interface requires active polling - re-arm now if the interval has already gone
+        // by (a controller that's been NAKing), otherwise leave it to xboxh_task
+        if (poll_due(p_controller)) TU_ASSERT(xboxh_receive_report(daddr, idx));
     } else {
         p_controller->epout_buf.length = xferred_bytes;
         if (xboxh_packet_sent_cb)
@@ -301,14 +358,18 @@ bool xboxh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_
 }
 
 void xboxh_close(uint8_t daddr) {
-    for (uint8_t i = 0; i < XBOX_MAX_CONTROLLERS; i++) {
-        xbox_interface_t *p_controller = &_xbox_itf[i];
-        if (!p_controller)
-            continue;
-        if (p_controller->daddr == daddr) {
-            p_controller->daddr = 0;
-            if (xboxh_umount_cb)
-                xboxh_umount_cb(daddr, i);
-        }
-    }
+    uint8_t idx = get_idx_by_daddr(daddr);
+    if (idx >= XBOX_MAX_CONTROLLERS)
+        return;
+
+    _idx_by_daddr[daddr] = TUSB_INDEX_INVALID_8;
+
+    xbox_interface_t *p_controller = &_xbox_itf[idx];
+    if (p_controller->daddr != daddr)
+        return;
+
+    p_controller->daddr      = 0;
+    p_controller->epin_armed = false;
+    if (xboxh_umount_cb)
+        xboxh_umount_cb(daddr, idx);
 }
@@ -1,6 +1,8 @@
 #include "adapter.h"
-#include "bsp/board_api.h"
+#include "events.h"
+#include "hot_path.h"
 #include "orb_debug.h"
+#include "trace.h"
 #include "tusb_option.h"
 #include "xbox_one_protocol.h"
 
@@ -11,7 +13,12 @@
 #include "common/tusb_types.h"
 #include "device/usbd.h"
 #include "device/usbd_pvt.h"
+#include "loadgen.h"
 #include "packet_queue.h"
+#include "persist.h"
+#include "profiler.h"
+#include "stats.h"
+#include "timebase.h"
 #include "xbox_device_driver.h"
 
 // only need a fifo for sent packets
@@ -23,11 +30,19 @@ typedef struct {
     uint8_t ep_in;
     uint8_t ep_out;
 
-    CFG_TUSB_MEM_ALIGN xbox_packet_t epin_buf;
+    // ping-pong IN buffers, the next report is staged in epin_buf[in_flight ^ 1] while
+    // epin_buf[in_flight] is on the wire - handled means a buffer is free
+    uint8_t in_flight;
+    timebase_us_t in_flight_since;  // when epin_buf[in_flight] went to the endpoint
+    // the last IN completion, and whether the next report went out straight from it - if it did,
+    // the next completion is the console's very next poll
+    uint32_t completed_us;
+    bool chained;
+    CFG_TUSB_MEM_ALIGN xbox_packet_t epin_buf[2];
     CFG_TUSB_MEM_ALIGN xbox_packet_t epout_buf;
 } xinputd_interface_t;
 
-CFG_TUSB_MEM_SECTION static xinputd_interface_t _xinputd_itf[CFG_TUD_XINPUT];
+CFG_TUSB_MEM_SECTION static xinputd_interface_t OPENRB_CORE0_DATA _xinputd_itf[CFG_TUD_XINPUT];
 
 void xboxd_reset(uint8_t rhport);
 
@@ -47,12 +62,12 @@ static inline uint8_t get_index_by_itfnum(uint8_t itf_num) {
     return TUSB_INDEX_INVALID_8;
 }
 
-bool tud_xinput_n_ready(uint8_t itf) {
+bool OPENRB_HOT_FUNC(tud_xinput_n_ready)(uint8_t itf) {
     uint8_t const ep_in = _xinputd_itf[itf].ep_in;
     return tud_ready() && (ep_in != 0) && !usbd_edpt_busy(TUD_OPT_RHPORT, ep_in);
 }
 
-static bool _xboxd_send(uint8_t itf, uint8_t *report, uint8_t len) {
+static bool OPENRB_HOT_FUNC(_xboxd_send)(uint8_t itf, uint8_t *report, uint8_t len) {
     xinputd_interface_t *p_xinput = &_xinputd_itf[itf];
 
     len = tu_min8(len, CFG_TUD_XINPUT_TX_BUFSIZE);
@@ -60,29 +75,89 @@ static bool _xboxd_send(uint8_t itf, uint8_t *report, uint8_t len) {
     return usbd_edpt_xfer(TUD_OPT_RHPORT, p_xinput->ep_in, report, len);
 }
 
-bool xboxd_send(xbox_packet_t *packet) {
+bool OPENRB_HOT_FUNC(xboxd_send)(xbox_packet_t *packet) {
     if (!_xinputd_itf[0].ep_in) return false;
 
     return _xboxd_send(0, packet->buffer, packet->length);
 }
 
-bool xboxd_send_task() {
-    xbox_packet_t *pkt = &_xinputd_itf[0].epin_buf;
-    if (pkt->handled) {
-        TU_VERIFY(xbox_fifo_read(pkt));
-    }
+static inline xbox_packet_t *staged_packet(xinputd_interface_t *p_xinput) {
+    return &p_xinput->epin_buf[p_xinput->in_flight ^ 1];
+}
+
+static void OPENRB_HOT_FUNC(stage_next)(xinputd_interface_t *p_xinput) {
+    xbox_packet_t *pkt = staged_packet(p_xinput);
+    if (pkt->handled) xbox_fifo_read(pkt);
+}
 
-    TU_VERIFY((board_millis() - pkt->triggered_time) > ON_DELAY_MS);
+// hand the staged report to the endpoint, a busy endpoint gets us posted again from xboxd_xfer_cb
+static bool OPENRB_HOT_FUNC(send_staged)(xinputd_interface_t *p_xinput) {
+    xbox_packet_t *pkt = staged_packet(p_xinput);
+    if (pkt->handled) return false;
 
-    TU_VERIFY(usbd_edpt_claim(0, _xinputd_itf[0].ep_in));
+    timebase_us_t send_at = pkt->triggered_at + TIMEBASE_MS(ON_DELAY_MS);
+    if (!timebase_reached(send_at, timebase_now())) {
+        events_post_at(TASK_SEND, send_at);
+        return false;
+    }
+
+    TU_VERIFY(usbd_edpt_claim(TUD_OPT_RHPORT, p_xinput->ep_in));
 
     OPENRB_DEBUG("sending %s size: %d\n", get_command_name(pkt->frame.command), pkt->length);
+    OPENRB_TRACE(TRACE_XBOXD_TX_START, pkt->frame.command, pkt->length);
+
+    if (!xboxd_send(pkt)) {
+        usbd_edpt_release(TUD_OPT_RHPORT, p_xinput->ep_in);
+        events_post_at(TASK_SEND, timebase_now() + TIMEBASE_MS(1));
+        return false;
+    }
+
+    p_xinput->in_flight ^= 1;
+    p_xinput->in_flight_since = timebase_now();
+    return true;
+}
+
+bool OPENRB_HOT_FUNC(xboxd_send_task)() {
+    xinputd_interface_t *p_xinput = &_xinputd_itf[0];
+
+    stage_next(p_xinput);
+    TU_VERIFY(send_staged(p_xinput));
+
+    // the endpoint was idle, so the buffer we just swapped out is free - fill it now so it's
+    // ready to go the moment this transfer completes
+    stage_next(p_xinput);
+    return true;
+}
 
-    if (!xboxd_send(pkt)) usbd_edpt_release(0, _xinputd_itf[0].ep_in);
+bool xboxd_in_flight_since(timebase_us_t *sent_at) {
+    xinputd_interface_t const *p_xinput = &_xinputd_itf[0];
+    // nothing gets collected while the console's asleep or hasn't configured us
+    if (!tud_ready() || tud_suspended()) return false;
+    if (!p_xinput->ep_in || p_xinput->epin_buf[p_xinput->in_flight].handled) return false;
 
+    *sent_at = p_xinput->in_flight_since;
     return true;
 }
 
+void xboxd_recover() {
+    xinputd_interface_t *p_xinput = &_xinputd_itf[0];
+    if (!p_xinput->ep_in) return;
+
+    // tinyusb has no way to abort a transfer, but stalling clears the pending buffer and clearing
+    // the stall marks the endpoint idle again - the report on the wire is lost either way
+    usbd_edpt_stall(TUD_OPT_RHPORT, p_xinput->ep_in);
+    usbd_edpt_clear_stall(TUD_OPT_RHPORT, p_xinput->ep_in);
+    usbd_edpt_release(TUD_OPT_RHPORT, p_xinput->ep_in);
+    p_xinput->epin_buf[p_xinput->in_flight].handled = 1;
+    p_xinput->chained = false;
+
+    if (!usbd_edpt_busy(TUD_OPT_RHPORT, p_xinput->ep_out)) {
+        usbd_edpt_xfer(TUD_OPT_RHPORT, p_xinput->ep_out, p_xinput->epout_buf.buffer,
+                       sizeof(p_xinput->epout_buf.buffer));
+    }
+    events_post(TASK_SEND);
+}
+
 //--------------------------------------------------------------------+
 // USBD-CLASS API
 //--------------------------------------------------------------------+
@@ -91,7 +166,8 @@ void xboxd_init(void) { xboxd_reset(TUD_OPT_RHPORT); }
 void xboxd_reset(uint8_t rhport) {
     (void)rhport;
     tu_memclr(_xinputd_itf, sizeof(_xinputd_itf));
-    _xinputd_itf[0].epin_buf.handled = 1;
+    _xinputd_itf[0].epin_buf[0].handled = 1;
+    _xinputd_itf[0].epin_buf[1].handled = 1;
 }
 
 uint16_t xboxd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_t max_len) {
@@ -176,9 +252,29 @@ static uint8_t request0x90_index_0x04[] = {
         0x00, 0x00, 0x00, 0x01, 0x58, 0x47, 0x49, 0x50, 0x31, 0x30, 0x00, 0x00, 0x00, 0x00,
         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
+static bool is_loadgen_request(tusb_control_request_t const *request) {
+    return request->bmRequestType_bit.type == TUSB_REQ_TYPE_VENDOR &&
+           request->bmRequestType_bit.direction == TUSB_DIR_OUT &&
+           request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_DEVICE &&
+           request->bRequest == LOADGEN_VENDOR_REQUEST;
+}
+
 bool xboxd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const *request) {
+    // has to outlive the data stage, a short request leaves the trailing fields zeroed
+    static loadgen_config_t loadgen_config;
+
+    if (stage == CONTROL_STAGE_DATA && is_loadgen_request(request)) {
+        loadgen_configure(&loadgen_config);
+        return true;
+    }
     if (stage != CONTROL_STAGE_SETUP) return true;
 
+    if (is_loadgen_request(request)) {
+        if (request->wLength == 0 || request->wLength > sizeof(loadgen_config)) return false;
+        memset(&loadgen_config, 0, sizeof(loadgen_config));
+        return tud_control_xfer(rhport, request, &loadgen_config, request->wLength);
+    }
+
     if (request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE) {
         if (request->bmRequestType_bit.direction == TUSB_DIR_IN) {
             if (request->bRequest == TUSB_REQ_GET_INTERFACE) {
@@ -196,6 +292,21 @@ bool xboxd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
 
     if (request->bmRequestType_bit.type == TUSB_REQ_TYPE_VENDOR) {
         if (request->bmRequestType_bit.direction == TUSB_DIR_IN) {
+            if (request->bRequest == STATS_VENDOR_REQUEST &&
+                request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_DEVICE) {
+                // has to outlive the data stage
+                static stats_block_t stats;
+                stats_snapshot(&stats);
+                return tud_control_xfer(rhport, request, &stats,
+                                        tu_min16(request->wLength, sizeof(stats)));
+            }
+            if (request->bRequest == PERSIST_VENDOR_REQUEST &&
+                request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_DEVICE) {
+                static persist_record_t record;
+                if (!persist_get(request->wIndex, &record)) return false;
+                return tud_control_xfer(rhport, request, &record,
+                                        tu_min16(request->wLength, sizeof(record)));
+            }
             if (request->bRequest == 0x90) {
                 if (request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_DEVICE) {
                     if (request->wIndex == 0x0004) {
@@ -221,7 +332,8 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
     return xboxd_control_xfer_cb(rhport, stage, request);
 }
 
-bool xboxd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+bool OPENRB_HOT_FUNC(xboxd_xfer_cb)(uint8_t rhport, uint8_t ep_addr, xfer_result_t result,
+                                    uint32_t xferred_bytes) {
     (void)result;
     (void)xferred_bytes;
     uint8_t itf = 0;
@@ -237,6 +349,7 @@ bool xboxd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32
         OPENRB_DEBUG("IN (%s): ", get_command_name(p_xinput->epout_buf.frame.command));
         OPENRB_DEBUG_BUF(p_xinput->epout_buf.buffer, xferred_bytes);
         OPENRB_DEBUG("\n");
+        OPENRB_TRACE(TRACE_XBOXD_RX, p_xinput->epout_buf.frame.command, xferred_bytes);
 
         p_xinput->epout_buf.length = xferred_bytes;
         if (xboxd_packet_received_cb)
@@ -245,10 +358,28 @@ bool xboxd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32
                                  sizeof(p_xinput->epout_buf.buffer)));
 
     } else if (ep_addr == p_xinput->ep_in) {
-        OPENRB_DEBUG("OUT (%s): ", get_command_name(p_xinput->epin_buf.frame.command));
-        OPENRB_DEBUG_BUF(p_xinput->epin_buf.buffer, xferred_bytes);
+        xbox_packet_t *sent = &p_xinput->epin_buf[p_xinput->in_flight];
+        OPENRB_DEBUG("OUT (%s): ", get_command_name(sent->frame.command));
+        OPENRB_DEBUG_BUF(sent->buffer, xferred_bytes);
         OPENRB_DEBUG("\n");
-        p_xinput->epin_buf.handled = 1;
+        OPENRB_TRACE(TRACE_XBOXD_TX_DONE, sent->frame.command, xferred_bytes);
+        sent->handled = 1;
+        stats_inc(STAT_REPORTS_SENT);
+        if (sent->hit_time_us) {
+            profiler_record(PROFILE_HIT_LATENCY, time_us_32() - sent->hit_time_us);
+        }
+        if (sent->generated_hits) loadgen_hits_reported(sent->generated_hits);
+
+        uint32_t completed_us = time_us_32();
+        if (p_xinput->chained) {
+            profiler_record(PROFILE_IN_POLL, completed_us - p_xinput->completed_us);
+        }
+        p_xinput->completed_us = completed_us;
+
+        // back to back reports go out straight from here rather than on the next loop pass, the
+        // send task refills whichever buffer is free
+        p_xinput->chained = send_staged(p_xinput);
+        events_post(TASK_SEND);
     }
     return true;
 }
@@ -3,30 +3,37 @@
 
 #include <string.h>
 
+#include "bench.h"
+#include "hot_path.h"
+#include "instrument_manager.h"
 #include "orb_debug.h"
 
 static uint8_t sequence = 0;
 
-uint8_t get_sequence() { return sequence++; }
+uint8_t OPENRB_HOT_FUNC(get_sequence)() { return sequence++; }
 
-uint8_t xboxp_get_size(const xbox_packet_t *packet) {
+uint8_t OPENRB_HOT_FUNC(xboxp_get_size)(const xbox_packet_t *packet) {
     if (!packet) return 0;
     return packet->length;
 }
 
-void init_packet(xbox_packet_t *pkt, uint32_t time, uint8_t length) {
+void OPENRB_HOT_FUNC(init_packet)(xbox_packet_t *pkt, timebase_us_t triggered_at, uint8_t length) {
     pkt->frame.sequence = get_sequence();
-    pkt->triggered_time = time;
+    pkt->triggered_at = triggered_at;
     pkt->handled = 0;
+    pkt->hit_time_us = 0;
+    pkt->generated_hits = 0;
     pkt->length = length;
 }
 
-void fill_drum_input_from_controller(const xbox_packet_t *controller_input,
-                                     xbox_packet_t *wla_output, uint8_t player_id) {
+void OPENRB_HOT_FUNC(fill_drum_input_from_controller)(const xbox_packet_t *controller_input,
+                                                      xbox_packet_t *wla_output,
+                                                      uint8_t player_id) {
     memset(wla_output->buffer, 0, sizeof(wla_output->buffer));
 
     wla_output->handled = 0;
-    wla_output->triggered_time = 0;
+    wla_output->triggered_at = 0;
+    wla_output->hit_time_us = 0;
 
     wla_output->length = sizeof(xb_one_drum_input_pkt_t);
     wla_output->frame.command = controller_input->frame.command;
@@ -92,3 +99,30 @@ const char *get_command_name(int cmd) {
     return "Unknown CMD";
 }
 #endif
+
+#if OPENRB_BENCH_ENABLED
+void xbox_one_protocol_bench() {
+    static xbox_packet_t controller_input;
+    static xbox_packet_t wla_output;
+    bench_t bench;
+
+    memset(&controller_input, 0, sizeof(controller_input));
+    controller_input.frame.command = CMD_INPUT;
+    bench_begin(&bench, "fill_drum_input_from_controller");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        controller_input.controller_input.buttons.coloredButtonState = i & 0x0f;
+        uint32_t start = bench_start(&bench);
+        fill_drum_input_from_controller(&controller_input, &wla_output, DRUMS);
+        bench_sample(&bench, start);
+    }
+    bench_end(&bench);
+
+    bench_begin(&bench, "init_packet");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t start = bench_start(&bench);
+        init_packet(&wla_output, i, sizeof(xb_one_drum_input_pkt_t));
+        bench_sample(&bench, start);
+    }
+    bench_end(&bench);
+}
+#endif
@@ -0,0 +1,28 @@
+#include <stdio.h>
+
+#include "bench.h"
+#include "sim.h"
+
+// the hot path benches the OPENRB_BENCH image runs on the chip (inc/bench.h), run natively against
+// the host build. prints the same json lines, marked "native", so two runs compare with
+//
+//     build-host/bench > before.jsonl
+//     tools/bench_compare.py before.jsonl after.jsonl
+//
+// host nanoseconds say nothing about cycles on the rp2040, the xip cache or the other core - what
+// they're good for is catching a change that makes one of these paths do more work, before it's
+// on a board. there's one pass, warm, and nothing here fails on the numbers
+
+int main() {
+    sim_init();
+
+    printf("{\"bench_start\":true,\"native\":true,\"overhead_cycles\":%lu}\n",
+           (unsigned long)sim_bench_calibrate());
+    drums_bench();
+    serial_midi_bench();
+    midi_parser_bench();
+    xbox_one_protocol_bench();
+    packet_queue_bench();
+    printf("{\"bench_done\":true}\n");
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef OPENRB_TEST_CHECK_H_
+#define OPENRB_TEST_CHECK_H_
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// one line per check, "ok" or "FAIL", a test's exit status is whether any failed
+static int failures = 0;
+
+static void check(bool ok, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    printf("%s ", ok ? "ok  " : "FAIL");
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
+    if (!ok) failures++;
+}
+
+#endif
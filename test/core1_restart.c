@@ -0,0 +1,91 @@
+#include <stdint.h>
+
+#include "adapter.h"
+#include "check.h"
+#include "control_queue.h"
+#include "events.h"
+#include "packet_queue.h"
+#include "sim.h"
+
+// core 1 reset at the worst moments, the way supervisor_restart_host_cb in src/main.c resets it to
+// restart the usb host. whatever it was holding when it went, adapter_core1_reset has to leave
+// core 0 able to carry on and the core 1 launched after it able to start over
+
+static xbox_packet_t packet;
+static uint32_t tasks_run = 0;
+
+static void on_pass(uint32_t tasks, uint64_t host_ns) {
+    (void)host_ns;
+    tasks_run |= tasks;
+}
+
+static void post_control(uintptr_t arg) {
+    (void)arg;
+    events_post(TASK_CONTROL);
+}
+
+static void write_packet(uintptr_t arg) {
+    (void)arg;
+    xbox_fifo_write(&packet);
+}
+
+static void post_mounted(uintptr_t idx) { control_post(CONTROL_CONTROLLER_MOUNTED, idx, 1); }
+
+// src/events.c's remote_lock, taken by every post core 1 makes
+static void remote_lock() {
+    sim_core1_reset_on_next_lock();
+    check(!sim_core1_run(post_control, 0), "core 1 reset inside events_post, holding remote_lock");
+    uint32_t deadlocks = sim_deadlocks();
+    sim_core1_run(post_control, 0);
+    check(sim_deadlocks() == deadlocks + 1, "a post before the reset would spin forever");
+
+    adapter_core1_reset();
+    deadlocks = sim_deadlocks();
+    tasks_run = 0;
+    check(sim_core1_run(post_control, 0) && sim_deadlocks() == deadlocks,
+          "core 1 posts again after the reset");
+    sim_run_until(sim_now + TIMEBASE_MS(1));
+    check(tasks_run & TASK_BIT(TASK_CONTROL), "core 0 runs the task it posted");
+}
+
+// the xbox fifo's write mutex, held by core 1 while it queues a controller's input
+static void fifo_write_mutex() {
+    xbox_fifo_clear();
+    init_packet(&packet, 0, sizeof(xb_one_drum_input_pkt_t));
+    sim_core1_reset_on_next_lock();
+    check(!sim_core1_run(write_packet, 0),
+          "core 1 reset inside xbox_fifo_write, holding its write mutex");
+    uint32_t deadlocks = sim_deadlocks();
+    check(!xbox_fifo_write(&packet) && sim_deadlocks() == deadlocks + 1,
+          "core 0's next write before the reset would wait forever");
+
+    adapter_core1_reset();
+    deadlocks = sim_deadlocks();
+    check(xbox_fifo_write(&packet) && sim_core1_run(write_packet, 0) &&
+                  sim_deadlocks() == deadlocks && xbox_fifo_count() == 2,
+          "both cores write the fifo again after the reset");
+    xbox_fifo_clear();
+}
+
+// core 1's control queue, with a mount it posted that core 0 hasn't taken yet
+static void control_queue() {
+    sim_core1_run(post_mounted, 0);
+    adapter_core1_reset();
+    control_event_t event;
+    check(!control_read(&event), "nothing core 1 posted is left after the reset");
+    check(sim_core1_run(post_mounted, 1), "core 1 posts controller events again after the reset");
+    control_task();
+    adapter_core1_reset();
+}
+
+int main() {
+    sim_init();
+    sim_set_pass_hook(on_pass);
+    sim_run_until(TIMEBASE_MS(10));
+
+    remote_lock();
+    fifo_write_mutex();
+    control_queue();
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "drums.h"
+#include "instrument_manager.h"
+#include "sim.h"
+#include "xbox_one_protocol.h"
+
+// plays a list of hits into the host build of src/drums.c and says what became of each one, the
+// engine tools/chart_replay.py scores charts against. the hits go in as a kit would send them,
+// over usb midi or the serial port, the adapter runs as it would with a console polling it, and
+// every hit is followed through the engine's own trace events to the report the console collected
+//
+//     drum_replay [--transport usb|serial] [--poll-phase US] [HITS]
+//
+// hits are text, from HITS or stdin, one per line in the order they're played, `#` starts a
+// comment:
+//
+//     <time_us> <note> <velocity> [outcome]
+//
+// times are from the start of the chart. out comes a config line with the constants this was built
+// with, then one line per hit - `hit <n> <outcome> <latency_us>|-` - where the outcome is one of:
+//
+//     delivered      the console saw a new press on the hit's lane, latency is from the hit being
+//                    played to the poll that collected it
+//     merged_hold    dropped by the engine, the lane was still held from an earlier hit
+//     merged_report  accepted, but the console never saw the lane go up again - the release and
+//                    the re-trigger landed between the same two reports
+//     crosstalk      masked as bleed from a louder hit on a neighbouring pad
+//     threshold      at or below VELOCITY_THRESH
+//     unmapped       not in the midi map
+//
+// a hit that names an outcome has to get that one, or this exits 1 - that's how the fixtures under
+// test/fixtures/drum_replay pin down what drums.c does with a hit
+//
+// --poll-phase moves the chart against the console's polls, taken modulo the poll interval
+
+#define MAX_HIT_LINE 128
+// accepted hits waiting on one report, a lane can't take another until it's released
+#define MAX_CARRIED 64
+// for whatever the last hit set off, the hold and a few polls either side of the report
+#define SETTLE_US TIMEBASE_MS(TRIGGER_HOLD_MS + ON_DELAY_MS + 100)
+
+typedef enum {
+    OUTCOME_NONE,
+    OUTCOME_DELIVERED,
+    OUTCOME_MERGED_HOLD,
+    OUTCOME_MERGED_REPORT,
+    OUTCOME_CROSSTALK,
+    OUTCOME_THRESHOLD,
+    OUTCOME_UNMAPPED,
+    N_OUTCOMES,
+} outcome_e;
+
+static const char *outcome_names[N_OUTCOMES] = {
+        "-", "delivered", "merged_hold", "merged_report", "crosstalk", "threshold", "unmapped",
+};
+
+typedef struct {
+    uint32_t time_us;
+    uint8_t note;
+    uint8_t velocity;
+    outcome_e expect;  // OUTCOME_NONE if the line didn't name one
+    outcome_e outcome;
+    timebase_us_t at;
+    uint32_t latency_us;
+} hit_t;
+
+typedef struct {
+    uint32_t hit;
+    output_e out;
+} carried_t;
+
+typedef struct {
+    carried_t hits[MAX_CARRIED];
+    uint32_t n;
+} carried_list_t;
+
+static hit_t *hits = NULL;
+static size_t n_hits = 0;
+
+// the next hit the engine hasn't said anything about yet, it takes them in the order they're played
+static size_t next_hit = 0;
+// accepted since the last report was written, and what each report in the fifo carries
+static carried_list_t pending;
+static carried_list_t in_fifo[256];
+static uint16_t lanes_seen = 0;
+static uint32_t reports = 0;
+
+//--------------------------------------------------------------------+
+// hits files
+//--------------------------------------------------------------------+
+
+static outcome_e parse_outcome(const char *name) {
+    for (int i = OUTCOME_DELIVERED; i < N_OUTCOMES; i++) {
+        if (!strcmp(name, outcome_names[i])) return i;
+    }
+    return OUTCOME_NONE;
+}
+
+static bool load_hits(const char *path) {
+    FILE *f = path ? fopen(path, "r") : stdin;
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    size_t cap = 0;
+    char line[MAX_HIT_LINE];
+    for (int n = 1; fgets(line, sizeof(line), f); n++) {
+        line[strcspn(line, "#\r\n")] = '\0';
+        unsigned long time_us;
+        unsigned note, velocity;
+        char expect[32] = "";
+        int fields = sscanf(line, "%lu %u %u %31s", &time_us, &note, &velocity, expect);
+        if (fields <= 0) continue;
+        if (fields < 3 || note > 127 || velocity > 127 || (fields == 4 && !parse_outcome(expect)) ||
+            (n_hits && time_us < hits[n_hits - 1].time_us)) {
+            fprintf(stderr, "%s:%d: bad hit\n", path ? path : "stdin", n);
+            return false;
+        }
+
+        if (n_hits == cap) {
+            cap = cap ? cap * 2 : 1024;
+            hits = realloc(hits, cap * sizeof(*hits));
+            if (!hits) abort();
+        }
+        hits[n_hits++] = (hit_t){
+                .time_us = (uint32_t)time_us,
+                .note = (uint8_t)note,
+                .velocity = (uint8_t)velocity,
+                .expect = fields == 4 ? parse_outcome(expect) : OUTCOME_NONE,
+        };
+    }
+    if (path) fclose(f);
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// the engine's side, from its trace events
+//--------------------------------------------------------------------+
+
+static void carry(carried_list_t *list, uint32_t hit, output_e out) {
+    if (list->n == MAX_CARRIED) {
+        fprintf(stderr, "more than %d hits waiting on one report\n", MAX_CARRIED);
+        exit(2);
+    }
+    list->hits[list->n++] = (carried_t){hit, out};
+}
+
+static hit_t *take_hit(uint32_t note) {
+    if (next_hit == n_hits || hits[next_hit].note != note) {
+        fprintf(stderr, "the engine handled note %u, hit %zu was next\n", (unsigned)note, next_hit);
+        exit(2);
+    }
+    return &hits[next_hit++];
+}
+
+static void on_trace(trace_event_e event, uint32_t arg0, uint32_t arg1) {
+    switch (event) {
+        case TRACE_NOTE_ON:
+            carry(&pending, (uint32_t)(take_hit(arg0) - hits), (output_e)(arg1 >> 8));
+            break;
+        case TRACE_CROSSTALK:
+            take_hit(arg0)->outcome = OUTCOME_CROSSTALK;
+            break;
+        case TRACE_HIT_DROPPED:
+            take_hit(arg0)->outcome = arg1 == HIT_DROP_HOLD        ? OUTCOME_MERGED_HOLD
+                                      : arg1 == HIT_DROP_THRESHOLD ? OUTCOME_THRESHOLD
+                                                                   : OUTCOME_UNMAPPED;
+            break;
+        case TRACE_DRUM_REPORT:
+            // a report that didn't fit in the fifo leaves its hits for the next one
+            in_fifo[arg0 & 0xff] = pending;
+            pending.n = 0;
+            reports++;
+            break;
+        default:
+            break;
+    }
+}
+
+//--------------------------------------------------------------------+
+// the console end
+//--------------------------------------------------------------------+
+
+static uint16_t lanes_in(const xb_one_drum_input_pkt_t *drums) {
+    return drums->kick << OUT_KICK | drums->doublekick << OUT_DOUBLE_KICK |
+           drums->pad_red << OUT_PAD_RED | drums->pad_yellow << OUT_PAD_YELLOW |
+           drums->pad_blue << OUT_PAD_BLUE | drums->pad_green << OUT_PAD_GREEN |
+           drums->cymbal_yellow << OUT_CYM_YELLOW | drums->cymbal_blue << OUT_CYM_BLUE |
+           drums->cymbal_green << OUT_CYM_GREEN;
+}
+
+static void on_console_frame(const sim_frame_t *frame) {
+    xbox_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    memcpy(packet.buffer, frame->data, frame->len);
+    if (packet.frame.command != CMD_INPUT || packet.wla_header.playerId != DRUMS) return;
+
+    uint16_t lanes = lanes_in(&packet.drum_input);
+    uint16_t rising = lanes & ~lanes_seen;
+    lanes_seen = lanes;
+
+    carried_list_t *carried = &in_fifo[packet.frame.sequence];
+    for (uint32_t i = 0; i < carried->n; i++) {
+        hit_t *hit = &hits[carried->hits[i].hit];
+        uint16_t lane = 1u << carried->hits[i].out;
+        if (rising & lane) {
+            hit->outcome = OUTCOME_DELIVERED;
+            hit->latency_us = (uint32_t)(frame->at - hit->at);
+            rising &= ~lane;
+        } else {
+            hit->outcome = OUTCOME_MERGED_REPORT;
+        }
+    }
+    carried->n = 0;
+}
+
+//--------------------------------------------------------------------+
+// the kit
+//--------------------------------------------------------------------+
+
+static void send_usb(const hit_t *hit) {
+    const uint8_t packet[4] = {0x09, 0x99, hit->note, hit->velocity};
+    sim_kit_usb_send(hit->at, packet);
+}
+
+// a kit keeps running status while it's sending back to back, returns when the wire's free again
+static timebase_us_t send_serial(const hit_t *hit, timebase_us_t wire_free, bool first) {
+    const uint8_t bytes[3] = {0x99, hit->note, hit->velocity};
+    uint8_t skip = !first && hit->at <= wire_free ? 1 : 0;
+    sim_kit_serial_send(hit->at, bytes + skip, sizeof(bytes) - skip);
+    timebase_us_t start = hit->at > wire_free ? hit->at : wire_free;
+    return start + (sizeof(bytes) - skip) * SIM_SERIAL_BYTE_US;
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    bool usb = false;
+    uint32_t phase_us = 0;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; i++) {
+        if (!strcmp(argv[i], "--transport") && i + 1 < argc) {
+            usb = !strcmp(argv[++i], "usb");
+            usage = !usb && strcmp(argv[i], "serial");
+        } else if (!strcmp(argv[i], "--poll-phase") && i + 1 < argc) {
+            phase_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage) {
+        fprintf(stderr, "usage: %s [--transport usb|serial] [--poll-phase US] [HITS]\n", argv[0]);
+        return 2;
+    }
+    if (!load_hits(path)) return 2;
+
+    sim_init();
+    sim_console_set_hook(on_console_frame);
+    sim_console_connect(0);
+    if (usb) sim_kit_usb_plug();
+    sim_run_until(TIMEBASE_MS(100));
+    if (!sim_console_authenticate(TIMEBASE_MS(100))) {
+        fprintf(stderr, "the console never authenticated\n");
+        return 2;
+    }
+    uint32_t poll_us = TIMEBASE_MS(sim_console_poll_interval_ms());
+    phase_us %= poll_us;
+    sim_run_until(sim_now + TIMEBASE_MS(50));
+    sim_set_trace_hook(on_trace);
+
+    timebase_us_t start = sim_now + TIMEBASE_MS(10) + phase_us;
+    timebase_us_t end = start;
+    for (size_t i = 0; i < n_hits; i++) {
+        hits[i].at = start + hits[i].time_us;
+        if (usb) {
+            send_usb(&hits[i]);
+            end = hits[i].at;
+        } else {
+            end = send_serial(&hits[i], end, i == 0);
+        }
+    }
+    sim_run_until(end + SETTLE_US);
+
+    // whatever's still waiting on a report never got one the console saw
+    for (uint32_t i = 0; i < pending.n; i++) {
+        hits[pending.hits[i].hit].outcome = OUTCOME_MERGED_REPORT;
+    }
+    for (int seq = 0; seq < 256; seq++) {
+        for (uint32_t i = 0; i < in_fifo[seq].n; i++) {
+            hits[in_fifo[seq].hits[i].hit].outcome = OUTCOME_MERGED_REPORT;
+        }
+    }
+
+    printf("config velocity_thresh %d hold_ms %d on_delay_ms %d poll_ms %u poll_phase_us %u "
+           "reports %u\n",
+           VELOCITY_THRESH, TRIGGER_HOLD_MS, ON_DELAY_MS, (unsigned)(poll_us / 1000),
+           (unsigned)phase_us, (unsigned)reports);
+
+    int unexpected = 0;
+    for (size_t i = 0; i < n_hits; i++) {
+        const hit_t *hit = &hits[i];
+        if (hit->outcome == OUTCOME_DELIVERED)
+            printf("hit %zu %s %u\n", i, outcome_names[hit->outcome], (unsigned)hit->latency_us);
+        else
+            printf("hit %zu %s -\n", i, outcome_names[hit->outcome]);
+
+        if (hit->outcome == OUTCOME_NONE) {
+            fprintf(stderr, "hit %zu (note %u at %uus) never reached the engine\n", i, hit->note,
+                    (unsigned)hit->time_us);
+            return 2;
+        }
+        if (hit->expect != OUTCOME_NONE && hit->expect != hit->outcome) {
+            fprintf(stderr, "hit %zu (note %u at %uus): want %s, got %s\n", i, hit->note,
+                    (unsigned)hit->time_us, outcome_names[hit->expect],
+                    outcome_names[hit->outcome]);
+            unexpected++;
+        }
+    }
+    return unexpected ? 1 : 0;
+}
@@ -0,0 +1,256 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "midi_parser.h"
+
+// src/midi_parser.c against whatever bytes come in. with clang and -DOPENRB_LIBFUZZER=ON this is
+// a libFuzzer target:
+//
+//     CC=clang cmake -S test -B build-fuzz -DOPENRB_LIBFUZZER=ON && cmake --build build-fuzz
+//     build-fuzz/fuzz_midi_parser test/fuzz/corpus/midi_parser
+//
+// otherwise it's built with a main that runs the seed corpus, every prefix of each seed and a fixed
+// set of mutations of it through the same checks, which is what ctest runs. a crash or a failed
+// invariant aborts either way
+//
+// the invariants, for any input:
+//  - one midi_parse() call, a byte at a time, and chunks of any size with a small max_events all
+//    give the same events, and consumed never runs past the input
+//  - every event has a known type, a channel under 16 and 7 bit data, and a NoteOn always has a
+//    velocity - 0 comes out as NoteOff
+//  - realtime bytes don't change anything else: the stream with them taken out gives the same
+//    events, less the realtime ones
+
+#define MAX_FUZZ_INPUT 4096
+
+static void fail(const char *what, const uint8_t *data, size_t size) {
+    fprintf(stderr, "midi_parser: %s, input (%zu bytes):", what, size);
+    for (size_t i = 0; i < size && i < 64; i++) fprintf(stderr, " %02x", data[i]);
+    fprintf(stderr, size > 64 ? " ...\n" : "\n");
+    abort();
+}
+
+static bool is_realtime(uint8_t byte) { return byte >= Clock; }
+
+static bool same_event(const midi_event_t *a, const midi_event_t *b) {
+    return a->type == b->type && a->channel == b->channel && a->data1 == b->data1 &&
+           a->data2 == b->data2;
+}
+
+static size_t parse_batch(const uint8_t *data, size_t size, midi_event_t *events) {
+    midi_parser_t parser;
+    uint32_t consumed;
+    midi_parser_init(&parser);
+    // every byte produces at most one event, so this always gets through the lot
+    uint8_t max = size < UINT8_MAX ? (uint8_t)size : UINT8_MAX;
+    size_t n = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        n += midi_parse(&parser, data + offset, size - offset, events + n, max, &consumed);
+        if (consumed > size - offset) fail("consumed past the end", data, size);
+        if (!consumed) fail("nothing consumed", data, size);
+        offset += consumed;
+    }
+    return n;
+}
+
+static size_t parse_bytes(const uint8_t *data, size_t size, midi_event_t *events) {
+    midi_parser_t parser;
+    midi_parser_init(&parser);
+    size_t n = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (midi_parse_byte(&parser, data[i], &events[n])) n++;
+    }
+    return n;
+}
+
+// how drum_task drives it, a read at a time with a small event buffer
+static size_t parse_chunks(const uint8_t *data, size_t size, size_t chunk, uint8_t max_events,
+                           midi_event_t *events) {
+    midi_parser_t parser;
+    midi_parser_init(&parser);
+    size_t n = 0;
+    for (size_t start = 0; start < size; start += chunk) {
+        size_t len = size - start < chunk ? size - start : chunk;
+        size_t offset = 0;
+        while (offset < len) {
+            uint32_t consumed;
+            uint8_t got = midi_parse(&parser, data + start + offset, len - offset, events + n,
+                                     max_events, &consumed);
+            if (got > max_events) fail("more events than max_events", data, size);
+            if (consumed > len - offset) fail("consumed past the end of a chunk", data, size);
+            if (got < max_events && consumed != len - offset)
+                fail("stopped short with room for more events", data, size);
+            n += got;
+            offset += consumed;
+        }
+    }
+    return n;
+}
+
+static void check_event(const midi_event_t *event, const uint8_t *data, size_t size) {
+    if (event->type == InvalidType) fail("invalid event type", data, size);
+    if (event->channel > 15) fail("channel out of range", data, size);
+    if ((event->data1 | event->data2) & 0x80) fail("data byte with the top bit set", data, size);
+    if (event->type == NoteOn && !event->data2) fail("NoteOn with velocity 0", data, size);
+    if (event->type >= SystemExclusive && event->channel)
+        fail("system message with a channel", data, size);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size > MAX_FUZZ_INPUT) return 0;
+
+    static midi_event_t batch[MAX_FUZZ_INPUT];
+    static midi_event_t bytes[MAX_FUZZ_INPUT];
+    static midi_event_t chunks[MAX_FUZZ_INPUT];
+    static midi_event_t stripped[MAX_FUZZ_INPUT];
+    static uint8_t without_realtime[MAX_FUZZ_INPUT];
+
+    size_t n = parse_batch(data, size, batch);
+    if (parse_bytes(data, size, bytes) != n) fail("batch and bytewise disagree", data, size);
+
+    // chunk size and event buffer from the first byte, so the fuzzer gets to pick them too
+    size_t chunk = size ? (data[0] & 0x3f) + 1 : 1;
+    uint8_t max_events = size ? ((data[0] >> 6) & 0x03) + 1 : 1;
+    if (parse_chunks(data, size, chunk, max_events, chunks) != n)
+        fail("batch and chunked disagree", data, size);
+
+    for (size_t i = 0; i < n; i++) {
+        if (!same_event(&batch[i], &bytes[i]) || !same_event(&batch[i], &chunks[i]))
+            fail("batch, bytewise and chunked events differ", data, size);
+        check_event(&batch[i], data, size);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (!is_realtime(data[i])) without_realtime[kept++] = data[i];
+    }
+    size_t m = parse_bytes(without_realtime, kept, stripped);
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (batch[i].type >= Clock) continue;
+        if (j == m || !same_event(&batch[i], &stripped[j++]))
+            fail("realtime bytes changed the other events", data, size);
+    }
+    if (j != m) fail("realtime bytes hid events", data, size);
+    return 0;
+}
+
+#ifndef OPENRB_LIBFUZZER
+
+// the same mutations every run - a failure here fails every time until it's fixed
+#define MUTATIONS_PER_SEED 2000
+
+static uint32_t next_random() {
+    static uint32_t state = 0x6d2b79f5;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// bytes worth more than their share of mutations, the ones that change what the parser's doing
+static const uint8_t interesting[] = {0x80, 0x90, 0x99, 0xb0, 0xc0, 0xe0, 0xf0, 0xf1, 0xf2,
+                                      0xf3, 0xf4, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfd, 0xfe,
+                                      0xff, 0x00, 0x7f};
+
+static size_t mutate(const uint8_t *seed, size_t size, uint8_t *out) {
+    memcpy(out, seed, size);
+    int edits = 1 + next_random() % 4;
+    for (int e = 0; e < edits; e++) {
+        uint32_t r = next_random();
+        uint8_t byte = r & 1 ? interesting[(r >> 1) % sizeof(interesting)] : (uint8_t)(r >> 8);
+        size_t at = size ? (r >> 16) % size : 0;
+        switch ((r >> 28) % 3) {
+            case 0:  // overwrite
+                if (size) out[at] = byte;
+                break;
+            case 1:  // insert
+                if (size < MAX_FUZZ_INPUT) {
+                    memmove(out + at + 1, out + at, size - at);
+                    out[at] = byte;
+                    size++;
+                }
+                break;
+            case 2:  // delete
+                if (size) {
+                    memmove(out + at, out + at + 1, size - at - 1);
+                    size--;
+                }
+                break;
+        }
+    }
+    return size;
+}
+
+static size_t run_seed(const char *path) {
+    static uint8_t seed[MAX_FUZZ_INPUT];
+    static uint8_t mutated[MAX_FUZZ_INPUT];
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        exit(2);
+    }
+    size_t size = fread(seed, 1, sizeof(seed), f);
+    fclose(f);
+
+    size_t runs = 0;
+    for (size_t len = 0; len <= size; len++, runs++) LLVMFuzzerTestOneInput(seed, len);
+    for (int i = 0; i < MUTATIONS_PER_SEED; i++, runs++) {
+        size_t len = mutate(seed, size, mutated);
+        LLVMFuzzerTestOneInput(mutated, len);
+    }
+    return runs;
+}
+
+static int by_name(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// seeds from each file named, or every file in each directory named, in name order
+int main(int argc, char **argv) {
+    size_t seeds = 0;
+    size_t runs = 0;
+    for (int i = 1; i < argc; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) || !S_ISDIR(st.st_mode)) {
+            runs += run_seed(argv[i]);
+            seeds++;
+            continue;
+        }
+
+        DIR *dir = opendir(argv[i]);
+        if (!dir) {
+            perror(argv[i]);
+            return 2;
+        }
+        char *names[256];
+        size_t n = 0;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) && n < 256) {
+            if (entry->d_name[0] != '.') names[n++] = strdup(entry->d_name);
+        }
+        closedir(dir);
+        qsort(names, n, sizeof(*names), by_name);
+
+        for (size_t j = 0; j < n; j++) {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/%s", argv[i], names[j]);
+            runs += run_seed(path);
+            seeds++;
+            free(names[j]);
+        }
+    }
+    if (!seeds) {
+        fprintf(stderr, "usage: %s SEED_FILE_OR_DIR...\n", argv[0]);
+        return 2;
+    }
+    printf("%zu seeds, %zu inputs, all invariants held\n", seeds, runs);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "adapter.h"
+#include "boot_report.h"
+#include "check.h"
+#include "instrument_manager.h"
+#include "sim.h"
+#include "usb_descriptors.h"
+#include "xbox_one_protocol.h"
+
+// plays the console through STATE_INIT -> STATE_IDENTIFYING -> STATE_AUTHENTICATING ->
+// STATE_RUNNING the way tools/console_emu.py does against a real adapter, with a controller on the
+// host port answering the auth frames and a kit to report. every round trip has a budget, a change
+// that adds a poll to any phase of the handshake fails here
+
+// the console's first poll comes this long after it configures us
+#define POLL_PHASE_US 250
+// the controller model takes this long to answer an auth frame
+#define CONTROLLER_REPLY_US 3000
+#define AUTH_FRAMES 8
+// what src/wla_identifiers.c sends
+#define IDENTIFY_CHUNKS 7
+
+// whatever interval the console took from the descriptors, set once it's configured us
+static uint32_t poll_us = 0;
+
+// the console answers as soon as it's collected our last frame, so its frame goes out on that same
+// poll and our reply on the next one
+#define ROUND_TRIP_BUDGET_US (poll_us)
+// the same with the controller in the middle, its reply goes on the first poll after it lands
+#define AUTH_ROUND_TRIP_BUDGET_US ((CONTROLLER_REPLY_US / poll_us + 1) * poll_us)
+// the controller mounting to the announce being collected
+#define ANNOUNCE_BUDGET_US (poll_us)
+// the announce to the first instrument report - each identify chunk plus the one that shows the
+// sequence starting over, each auth frame, then the authenticated frame
+#define TIME_TO_RUNNING_BUDGET_US                                                            \
+    ((IDENTIFY_CHUNKS + 1) * ROUND_TRIP_BUDGET_US + AUTH_FRAMES * AUTH_ROUND_TRIP_BUDGET_US + \
+     ROUND_TRIP_BUDGET_US)
+
+extern volatile adapter_state_t adapter_state;
+
+static uint8_t console_sequence = 0;
+
+static timebase_us_t console_send(uint8_t command, uint8_t type, const uint8_t *payload,
+                                  uint8_t len) {
+    uint8_t frame[64] = {command, type, ++console_sequence, len};
+    memcpy(frame + 4, payload, len);
+    sim_console_send(frame, 4 + len);
+    return sim_now;
+}
+
+static bool console_wait_for(uint8_t command, uint32_t timeout_us, sim_frame_t *frame) {
+    return sim_console_wait_for(&command, 1, timeout_us, frame);
+}
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+} round_trips_t;
+
+static void round_trip(round_trips_t *trips, timebase_us_t sent_at, timebase_us_t at) {
+    uint32_t us = (uint32_t)(at - sent_at);
+    trips->count++;
+    trips->total_us += us;
+    if (us > trips->max_us) trips->max_us = us;
+}
+
+static void report(const char *name, const round_trips_t *trips, uint32_t budget_us) {
+    check(trips->count && trips->max_us <= budget_us,
+          "%-10s %2u round trips, mean %5.2fms max %5.2fms (budget %5.2fms)", name,
+          (unsigned)trips->count,
+          trips->count ? trips->total_us / 1000.0 / trips->count : 0.0, trips->max_us / 1000.0,
+          budget_us / 1000.0);
+}
+
+//--------------------------------------------------------------------+
+// the controller - answers every auth frame forwarded to it, after CONTROLLER_REPLY_US
+//--------------------------------------------------------------------+
+
+static uint32_t controller_frames = 0;
+static uint8_t last_controller = 0;
+
+static void controller_auth_reply(uintptr_t idx) {
+    static uint8_t sequence = 0;
+    uint8_t reply[20] = {CMD_AUTHENTICATE, 0xf0, ++sequence, sizeof(reply) - 4};
+    for (uint8_t i = 4; i < sizeof(reply); i++) reply[i] = i * 7;
+    sim_controller_send((uint8_t)idx, reply, sizeof(reply));
+}
+
+static void on_controller_frame(uint8_t idx, const sim_frame_t *frame) {
+    controller_frames++;
+    last_controller = idx;
+    if (frame->data[0] != CMD_AUTHENTICATE) return;
+    // the console's "authenticated" frame isn't answered
+    if (frame->data[3] == 2 && frame->data[4] == 1 && frame->data[5] == 0) return;
+    sim_at(sim_now + CONTROLLER_REPLY_US, controller_auth_reply, idx);
+}
+
+//--------------------------------------------------------------------+
+// the console
+//--------------------------------------------------------------------+
+
+static timebase_us_t announce(timebase_us_t controller_at) {
+    sim_frame_t frame;
+    bool announced = console_wait_for(CMD_ANNOUNCE, TIMEBASE_MS(5000), &frame);
+    check(announced, "announce");
+    if (!announced) return 0;
+    check(frame.at - controller_at <= ANNOUNCE_BUDGET_US,
+          "announce   %5.2fms after the controller mounted (budget %5.2fms)",
+          (frame.at - controller_at) / 1000.0, ANNOUNCE_BUDGET_US / 1000.0);
+    return frame.at;
+}
+
+// CMD_IDENTIFY, then an ack for each chunk until the sequence starts over
+static void identify() {
+    round_trips_t trips = {0};
+    uint8_t first[64];
+    uint8_t first_len = 0;
+    sim_frame_t frame;
+
+    timebase_us_t sent_at = console_send(CMD_IDENTIFY, 0x20, NULL, 0);
+    for (int chunk = 0; chunk < 32; chunk++) {
+        if (!console_wait_for(CMD_IDENTIFY, TIMEBASE_MS(1000), &frame)) {
+            check(false, "identify chunk %d", chunk);
+            return;
+        }
+        round_trip(&trips, sent_at, frame.at);
+
+        // the sequence byte aside, the first chunk coming round again means we've had them all
+        frame.data[2] = 0;
+        if (!first_len) {
+            memcpy(first, frame.data, frame.len);
+            first_len = frame.len;
+        } else if (frame.len == first_len && !memcmp(first, frame.data, frame.len)) {
+            break;
+        }
+
+        uint8_t ack[] = {0x00, frame.data[0], frame.data[1], frame.data[3], 0, 0, 0, 0, 0};
+        sent_at = console_send(CMD_ACKNOWLEDGE, 0x20, ack, sizeof(ack));
+    }
+    check(adapter_state == STATE_IDENTIFYING, "identifying after the identify sequence");
+    report("identify", &trips, ROUND_TRIP_BUDGET_US);
+}
+
+static void authenticate() {
+    round_trips_t trips = {0};
+    sim_frame_t frame;
+
+    for (int i = 0; i < AUTH_FRAMES; i++) {
+        uint8_t payload[40];
+        for (uint8_t b = 0; b < sizeof(payload); b++) payload[b] = (uint8_t)(i + b);
+        timebase_us_t sent_at = console_send(CMD_AUTHENTICATE, 0xf0, payload, sizeof(payload));
+        if (!console_wait_for(CMD_AUTHENTICATE, TIMEBASE_MS(200), &frame)) {
+            check(false, "auth reply %d", i);
+            return;
+        }
+        round_trip(&trips, sent_at, frame.at);
+    }
+    check(adapter_state == STATE_AUTHENTICATING, "authenticating after the auth frames");
+    check(controller_frames >= AUTH_FRAMES, "controller saw %u of %d auth frames",
+          (unsigned)controller_frames, AUTH_FRAMES);
+    report("auth", &trips, AUTH_ROUND_TRIP_BUDGET_US);
+}
+
+// counts the ADD_PLAYERs that come in within timeout_us, by player
+static uint8_t collect_players(uint32_t timeout_us, bool players[N_INSTRUMENTS],
+                               timebase_us_t *first_at) {
+    sim_frame_t frame;
+    uint8_t n = 0;
+    timebase_us_t deadline = sim_now + timeout_us;
+    while (sim_now < deadline && console_wait_for(CMD_ADD_PLAYER, deadline - sim_now, &frame)) {
+        if (!n && first_at) *first_at = frame.at;
+        if (frame.data[4] < N_INSTRUMENTS) players[frame.data[4]] = true;
+        n++;
+    }
+    return n;
+}
+
+int main() {
+    sim_init();
+    sim_controller_set_hook(on_controller_frame);
+
+    sim_console_connect(POLL_PHASE_US);
+    sim_kit_usb_plug();
+    sim_run_until(TIMEBASE_MS(100));
+
+    // the fast poll build gets its 1ms configuration taken, the standard one polls at 4ms
+    uint8_t interval_ms = sim_console_poll_interval_ms();
+    check(interval_ms == usb_poll_interval_ms() &&
+                  interval_ms == (OPENRB_FAST_POLL_ENABLED ? ADAPTER_FAST_INTERVAL
+                                                           : ADAPTER_IN_INTERVAL),
+          "console polls every %ums", interval_ms);
+    poll_us = TIMEBASE_MS(interval_ms);
+
+    timebase_us_t controller_at = sim_now;
+    sim_controller_plug(0);
+    timebase_us_t announced_at = announce(controller_at);
+    if (!announced_at) return 1;
+
+    identify();
+    authenticate();
+
+    // handle_auth moves to running on this exact frame, the console asks for the instruments
+    // straight after it
+    static const uint8_t auth_done[] = {0x01, 0x00};
+    timebase_us_t done_at = console_send(CMD_AUTHENTICATE, 0x00, auth_done, sizeof(auth_done));
+    console_send(CMD_LIST_CONNECTED_INSTRUMENTS, 0x20, NULL, 0);
+
+    bool players[N_INSTRUMENTS] = {false};
+    timebase_us_t running_at = 0;
+    uint8_t reports = collect_players(TIMEBASE_MS(50), players, &running_at);
+    check(adapter_state == STATE_RUNNING, "running after the authenticated frame");
+    check(reports == 2 && players[DRUMS],
+          "drums reported on entering running and again for the list request (%u reports)",
+          (unsigned)reports);
+    check(running_at - done_at <= ROUND_TRIP_BUDGET_US,
+          "auth done to instruments %5.2fms (budget %5.2fms)", (running_at - done_at) / 1000.0,
+          ROUND_TRIP_BUDGET_US / 1000.0);
+    check(running_at - announced_at <= TIME_TO_RUNNING_BUDGET_US,
+          "time to running %6.2fms (budget %6.2fms)", (running_at - announced_at) / 1000.0,
+          TIME_TO_RUNNING_BUDGET_US / 1000.0);
+    check(sim_controller_poll_interval_ms() == XBOX_RUNNING_POLL_INTERVAL_MS,
+          "controller polled every %ums once running", sim_controller_poll_interval_ms());
+
+    // a second controller takes a guitar slot and is reported straight away
+    memset(players, 0, sizeof(players));
+    timebase_us_t guitar_at = sim_now;
+    timebase_us_t reported_at = 0;
+    sim_controller_plug(1);
+    reports = collect_players(TIMEBASE_MS(50), players, &reported_at);
+    check(reports == 1 && players[GUITAR_ONE] && reported_at - guitar_at <= poll_us,
+          "guitar controller reported %5.2fms after it mounted",
+          (reported_at - guitar_at) / 1000.0);
+
+    // controller -> console: its input goes out as the guitar player's
+    static const uint8_t input[] = {CMD_INPUT, 0x20, 0x01, 0x0e, 0x10, 0x00, 0, 0, 0, 0,
+                                    0,         0,    0,    0,    0,    0,    0, 0};
+    timebase_us_t input_at = sim_now;
+    sim_controller_send(1, input, sizeof(input));
+    sim_frame_t frame;
+    bool forwarded = console_wait_for(CMD_INPUT, TIMEBASE_MS(50), &frame);
+    check(forwarded && frame.data[6] == GUITAR_ONE && frame.at - input_at <= poll_us,
+          "controller input forwarded as GUITAR_ONE in %5.2fms (budget %5.2fms)",
+          forwarded ? (frame.at - input_at) / 1000.0 : 0.0, poll_us / 1000.0);
+
+    // console -> controller: acks are passed on once running
+    uint32_t before = controller_frames;
+    static const uint8_t ack[] = {0x00, CMD_INPUT, 0x20, 0x0e, 0, 0, 0, 0, 0};
+    console_send(CMD_ACKNOWLEDGE, 0x20, ack, sizeof(ack));
+    sim_run_until(sim_now + ROUND_TRIP_BUDGET_US);
+    check(controller_frames == before + 1, "console ack passed on to the controller");
+
+    // the auth controller goes, the guitar controller takes over its duties on core 0 and the
+    // console's acks follow it there
+    sim_controller_unplug(0);
+    sim_run_until(sim_now + ROUND_TRIP_BUDGET_US);
+    before = controller_frames;
+    console_send(CMD_ACKNOWLEDGE, 0x20, ack, sizeof(ack));
+    sim_run_until(sim_now + ROUND_TRIP_BUDGET_US);
+    check(controller_frames == before + 1 && last_controller == 1,
+          "console ack handed over to controller 1 once controller 0 unmounted");
+
+    printf("boot phases (ms):");
+    static const char *phase_names[N_BOOT_PHASES] = {"clocks",   "tud_init", "host_enumerated",
+                                                     "announce", "identify", "auth",
+                                                     "running"};
+    for (int i = FIRST_BOOT_PHASE; i < N_BOOT_PHASES; i++) {
+        printf(" %s=%.2f", phase_names[i], boot_report_get(i) / 1000.0);
+    }
+    printf("\n");
+
+    return failures ? 1 : 0;
+}
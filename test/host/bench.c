@@ -0,0 +1,58 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hot_path.h"
+#include "sim.h"
+
+// what src/bench.c does on the chip, for the benches the modules build against the host. a sample
+// is host nanoseconds rather than core cycles, so it's only good for comparing against another
+// native run on the same machine - test/bench.c runs them
+
+static uint32_t overhead_cycles = 0;
+
+uint32_t bench_now() { return (uint32_t)sim_host_ns(); }
+
+void bench_begin(bench_t *bench, const char *name) {
+    memset(bench, 0, sizeof(*bench));
+    bench->name = name;
+    bench->min_cycles = UINT32_MAX;
+}
+
+void bench_sample(bench_t *bench, uint32_t start) {
+    uint32_t cycles = bench_now() - start;
+    cycles = cycles > overhead_cycles ? cycles - overhead_cycles : 0;
+
+    bench->count++;
+    bench->total_cycles += cycles;
+    if (cycles < bench->min_cycles) bench->min_cycles = cycles;
+    if (cycles > bench->max_cycles) bench->max_cycles = cycles;
+}
+
+// the same line the bench image prints, with a 1000MHz clock so mean_ns is the mean, and no xip
+// counters
+void bench_end(bench_t *bench) {
+    if (!bench->count) return;
+    uint32_t mean = bench->total_cycles / bench->count;
+    printf("{\"bench\":\"%s\",\"cold\":false,\"contended\":false,\"native\":true,"
+           "\"ram_hot_path\":%s,\"scratch_banks\":%s,\"count\":%lu,\"min_cycles\":%lu,"
+           "\"mean_cycles\":%lu,\"max_cycles\":%lu,\"jitter_cycles\":%lu,\"mean_ns\":%lu,"
+           "\"clock_mhz\":1000}\n",
+           bench->name, OPENRB_RAM_HOT_PATH_ENABLED ? "true" : "false",
+           OPENRB_SCRATCH_BANKS_ENABLED ? "true" : "false", (unsigned long)bench->count,
+           (unsigned long)bench->min_cycles, (unsigned long)mean, (unsigned long)bench->max_cycles,
+           (unsigned long)(bench->max_cycles - bench->min_cycles), (unsigned long)mean);
+}
+
+uint32_t sim_bench_calibrate() {
+    bench_t bench;
+    overhead_cycles = 0;
+    bench_begin(&bench, "overhead");
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t start = bench_now();
+        bench_sample(&bench, start);
+    }
+    overhead_cycles = bench.min_cycles;
+    return overhead_cycles;
+}
@@ -0,0 +1,4 @@
+#ifndef OPENRB_HOST_BSP_BOARD_API_H_
+#define OPENRB_HOST_BSP_BOARD_API_H_
+
+#endif
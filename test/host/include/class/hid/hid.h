@@ -0,0 +1,4 @@
+#ifndef OPENRB_HOST_CLASS_HID_HID_H_
+#define OPENRB_HOST_CLASS_HID_HID_H_
+
+#endif
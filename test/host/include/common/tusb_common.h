@@ -0,0 +1,29 @@
+#ifndef OPENRB_HOST_COMMON_TUSB_COMMON_H_
+#define OPENRB_HOST_COMMON_TUSB_COMMON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TU_ATTR_WEAK __attribute__((weak))
+#define TU_ATTR_ALIGNED(bytes) __attribute__((aligned(bytes)))
+#define TU_ATTR_PACKED __attribute__((packed))
+
+#define TU_ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
+#define TU_BIT(n) (1UL << (n))
+#define TUSB_INDEX_INVALID_8 0xFFu
+
+#define TU_LOG_USBD(...)
+
+static inline void tu_memclr(void *buffer, size_t size) { memset(buffer, 0, size); }
+
+static inline uint8_t tu_min8(uint8_t x, uint8_t y) { return (x < y) ? x : y; }
+static inline uint16_t tu_min16(uint16_t x, uint16_t y) { return (x < y) ? x : y; }
+static inline uint32_t tu_min32(uint32_t x, uint32_t y) { return (x < y) ? x : y; }
+
+#include "common/tusb_types.h"
+#include "common/tusb_verify.h"
+#include "tusb_option.h"
+
+#endif
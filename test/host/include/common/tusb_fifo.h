@@ -0,0 +1,37 @@
+#ifndef OPENRB_HOST_COMMON_TUSB_FIFO_H_
+#define OPENRB_HOST_COMMON_TUSB_FIFO_H_
+
+#include <osal/osal.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// same behaviour as tinyusb's fifo for whole items, see test/host/tusb_fifo.c
+typedef struct {
+    uint8_t *buffer;
+    uint16_t depth;
+    uint16_t item_size;
+    bool overwritable;
+    uint32_t wr_idx;
+    uint32_t rd_idx;
+    osal_mutex_t mutex_wr;
+    osal_mutex_t mutex_rd;
+} tu_fifo_t;
+
+bool tu_fifo_config(tu_fifo_t *f, void *buffer, uint16_t depth, uint16_t item_size,
+                    bool overwritable);
+static inline void tu_fifo_config_mutex(tu_fifo_t *f, osal_mutex_t wr_mutex,
+                                        osal_mutex_t rd_mutex) {
+    f->mutex_wr = wr_mutex;
+    f->mutex_rd = rd_mutex;
+}
+
+bool tu_fifo_write(tu_fifo_t *f, const void *data);
+bool tu_fifo_read(tu_fifo_t *f, void *buffer);
+bool tu_fifo_peek(tu_fifo_t *f, void *p_buffer);
+void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n);
+uint16_t tu_fifo_count(tu_fifo_t *f);
+bool tu_fifo_empty(tu_fifo_t *f);
+bool tu_fifo_full(tu_fifo_t *f);
+bool tu_fifo_clear(tu_fifo_t *f);
+
+#endif
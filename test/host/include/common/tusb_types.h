@@ -0,0 +1,147 @@
+#ifndef OPENRB_HOST_COMMON_TUSB_TYPES_H_
+#define OPENRB_HOST_COMMON_TUSB_TYPES_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    TUSB_XFER_CONTROL = 0,
+    TUSB_XFER_ISOCHRONOUS,
+    TUSB_XFER_BULK,
+    TUSB_XFER_INTERRUPT,
+} tusb_xfer_type_t;
+
+typedef enum {
+    TUSB_DIR_OUT = 0,
+    TUSB_DIR_IN = 1,
+    TUSB_DIR_IN_MASK = 0x80,
+} tusb_dir_t;
+
+typedef enum {
+    TUSB_ISO_EP_ATT_NO_SYNC = 0x00,
+    TUSB_ISO_EP_ATT_DATA = 0x00,
+} tusb_iso_ep_attribute_t;
+
+typedef enum {
+    TUSB_DESC_DEVICE = 0x01,
+    TUSB_DESC_CONFIGURATION = 0x02,
+    TUSB_DESC_STRING = 0x03,
+    TUSB_DESC_INTERFACE = 0x04,
+    TUSB_DESC_ENDPOINT = 0x05,
+} tusb_desc_type_t;
+
+typedef enum {
+    TUSB_REQ_GET_INTERFACE = 0x0A,
+    TUSB_REQ_SET_INTERFACE = 0x0B,
+} tusb_request_code_t;
+
+typedef enum {
+    TUSB_REQ_TYPE_STANDARD = 0,
+    TUSB_REQ_TYPE_CLASS,
+    TUSB_REQ_TYPE_VENDOR,
+} tusb_request_type_t;
+
+typedef enum {
+    TUSB_REQ_RCPT_DEVICE = 0,
+    TUSB_REQ_RCPT_INTERFACE,
+    TUSB_REQ_RCPT_ENDPOINT,
+    TUSB_REQ_RCPT_OTHER,
+} tusb_request_recipient_t;
+
+enum { TUSB_CLASS_VENDOR_SPECIFIC = 0xFF };
+
+enum { TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP = 0x20 };
+
+typedef enum {
+    XFER_RESULT_SUCCESS = 0,
+    XFER_RESULT_FAILED,
+    XFER_RESULT_STALLED,
+} xfer_result_t;
+
+enum {
+    CONTROL_STAGE_IDLE,
+    CONTROL_STAGE_SETUP,
+    CONTROL_STAGE_DATA,
+    CONTROL_STAGE_ACK,
+};
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bMaxPacketSize0;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t iManufacturer;
+    uint8_t iProduct;
+    uint8_t iSerialNumber;
+    uint8_t bNumConfigurations;
+} tusb_desc_device_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t wTotalLength;
+    uint8_t bNumInterfaces;
+    uint8_t bConfigurationValue;
+    uint8_t iConfiguration;
+    uint8_t bmAttributes;
+    uint8_t bMaxPower;
+} tusb_desc_configuration_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bInterfaceNumber;
+    uint8_t bAlternateSetting;
+    uint8_t bNumEndpoints;
+    uint8_t bInterfaceClass;
+    uint8_t bInterfaceSubClass;
+    uint8_t bInterfaceProtocol;
+    uint8_t iInterface;
+} tusb_desc_interface_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bEndpointAddress;
+    uint8_t bmAttributes;
+    uint16_t wMaxPacketSize;
+    uint8_t bInterval;
+} tusb_desc_endpoint_t;
+
+typedef struct __attribute__((packed)) {
+    union {
+        struct __attribute__((packed)) {
+            uint8_t recipient : 5;
+            uint8_t type : 2;
+            uint8_t direction : 1;
+        } bmRequestType_bit;
+        uint8_t bmRequestType;
+    };
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} tusb_control_request_t;
+
+static inline uint8_t const *tu_desc_next(void const *desc) {
+    uint8_t const *desc8 = (uint8_t const *)desc;
+    return desc8 + desc8[0];
+}
+
+static inline uint8_t tu_desc_type(void const *desc) { return ((uint8_t const *)desc)[1]; }
+
+static inline tusb_dir_t tu_edpt_dir(uint8_t addr) {
+    return (addr & TUSB_DIR_IN_MASK) ? TUSB_DIR_IN : TUSB_DIR_OUT;
+}
+
+static inline uint16_t tu_edpt_packet_size(tusb_desc_endpoint_t const *desc_ep) {
+    return desc_ep->wMaxPacketSize & 0x7FF;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef OPENRB_HOST_COMMON_TUSB_VERIFY_H_
+#define OPENRB_HOST_COMMON_TUSB_VERIFY_H_
+
+#include <stdio.h>
+
+// TU_VERIFY(cond) returns false when cond doesn't hold, TU_VERIFY(cond, ret) returns ret -
+// TU_ASSERT does the same but says so, an assert firing in the simulation is a bug in the test
+#define TU_GET_3RD_ARG(arg1, arg2, arg3, ...) arg3
+
+#define TU_VERIFY_1ARGS(cond)      \
+    do {                           \
+        if (!(cond)) return false; \
+    } while (0)
+#define TU_VERIFY_2ARGS(cond, ret) \
+    do {                           \
+        if (!(cond)) return ret;   \
+    } while (0)
+#define TU_VERIFY(...) TU_GET_3RD_ARG(__VA_ARGS__, TU_VERIFY_2ARGS, TU_VERIFY_1ARGS, _)(__VA_ARGS__)
+
+#define TU_ASSERT_1ARGS(cond)                                                            \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            fprintf(stderr, "%s:%d: TU_ASSERT(%s) failed\n", __FILE__, __LINE__, #cond); \
+            return false;                                                                \
+        }                                                                                \
+    } while (0)
+#define TU_ASSERT_2ARGS(cond, ret)                                                       \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            fprintf(stderr, "%s:%d: TU_ASSERT(%s) failed\n", __FILE__, __LINE__, #cond); \
+            return ret;                                                                  \
+        }                                                                                \
+    } while (0)
+#define TU_ASSERT(...) TU_GET_3RD_ARG(__VA_ARGS__, TU_ASSERT_2ARGS, TU_ASSERT_1ARGS, _)(__VA_ARGS__)
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef OPENRB_HOST_DEVICE_USBD_H_
+#define OPENRB_HOST_DEVICE_USBD_H_
+
+#include "common/tusb_common.h"
+
+// the console side of test/host/sim_device.c - tud_task hands the driver whatever the console did
+// since the last pass
+bool tud_init(uint8_t rhport);
+void tud_task();
+bool tud_task_event_ready();
+
+bool tud_mounted();
+bool tud_suspended();
+static inline bool tud_ready() { return tud_mounted() && !tud_suspended(); }
+
+bool tud_connect();
+bool tud_disconnect();
+
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const *request, void *buffer,
+                      uint16_t len);
+bool tud_control_status(uint8_t rhport, tusb_control_request_t const *request);
+
+uint8_t const *tud_descriptor_device_cb(void);
+uint8_t const *tud_descriptor_configuration_cb(uint8_t index);
+uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid);
+
+TU_ATTR_WEAK void tud_mount_cb(void);
+TU_ATTR_WEAK void tud_umount_cb(void);
+TU_ATTR_WEAK void tud_suspend_cb(bool remote_wakeup_en);
+TU_ATTR_WEAK void tud_resume_cb(void);
+TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
+                                             tusb_control_request_t const *request);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef OPENRB_HOST_HARDWARE_GPIO_H_
+#define OPENRB_HOST_HARDWARE_GPIO_H_
+
+#include <pico/platform.h>
+#include <stdbool.h>
+
+enum gpio_function { GPIO_FUNC_UART = 2 };
+
+static inline void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)gpio;
+    (void)fn;
+}
+static inline void gpio_put(uint gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef OPENRB_HOST_HARDWARE_IRQ_H_
+#define OPENRB_HOST_HARDWARE_IRQ_H_
+
+#include <pico/platform.h>
+#include <stdbool.h>
+
+enum { UART0_IRQ = 20, UART1_IRQ = 21, N_IRQS = 32 };
+
+typedef void (*irq_handler_t)(void);
+
+// the simulation calls the handler itself, see sim_irq()
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+static inline void irq_set_enabled(uint num, bool enabled) {
+    (void)num;
+    (void)enabled;
+}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef OPENRB_HOST_HARDWARE_SYNC_H_
+#define OPENRB_HOST_HARDWARE_SYNC_H_
+
+#include <stdint.h>
+
+// the simulation runs one context at a time, nothing can interrupt it
+static inline uint32_t save_and_disable_interrupts() { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+static inline void __dmb() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __sev() {}
+static inline void __wfe() {}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef OPENRB_HOST_HARDWARE_TIMER_H_
+#define OPENRB_HOST_HARDWARE_TIMER_H_
+
+#include <pico/platform.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// the simulated clock, see test/host/sim.h - it only moves between events, never while firmware
+// code is running
+extern uint64_t sim_now;
+
+static inline uint64_t time_us_64() { return sim_now; }
+static inline uint32_t time_us_32() { return (uint32_t)sim_now; }
+
+typedef uint64_t absolute_time_t;
+
+static inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return sim_now + (uint64_t)ms * 1000;
+}
+
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
+
+int hardware_alarm_claim_unused(bool required);
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback);
+// true if target has already gone by, the alarm isn't armed then
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t target);
+void hardware_alarm_cancel(uint alarm_num);
+
+#endif
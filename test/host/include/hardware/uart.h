@@ -0,0 +1,36 @@
+#ifndef OPENRB_HOST_HARDWARE_UART_H_
+#define OPENRB_HOST_HARDWARE_UART_H_
+
+#include <pico/platform.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// rx only, bytes are put on the wire by sim_serial_send()
+typedef struct uart_inst {
+    uint8_t rx[256];
+    uint8_t head;
+    uint8_t tail;
+} uart_inst_t;
+
+extern uart_inst_t sim_uart0;
+extern uart_inst_t sim_uart1;
+#define uart0 (&sim_uart0)
+#define uart1 (&sim_uart1)
+
+static inline uint uart_init(uart_inst_t *uart, uint baudrate) {
+    uart->head = uart->tail = 0;
+    return baudrate;
+}
+static inline void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled) {
+    (void)uart;
+    (void)enabled;
+}
+static inline void uart_set_irq_enables(uart_inst_t *uart, bool rx, bool tx) {
+    (void)uart;
+    (void)rx;
+    (void)tx;
+}
+static inline bool uart_is_readable(uart_inst_t *uart) { return uart->head != uart->tail; }
+static inline char uart_getc(uart_inst_t *uart) { return (char)uart->rx[uart->tail++]; }
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef OPENRB_HOST_HOST_USBH_PVT_H_
+#define OPENRB_HOST_HOST_USBH_PVT_H_
+
+#include "common/tusb_common.h"
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef OPENRB_HOST_OSAL_OSAL_H_
+#define OPENRB_HOST_OSAL_OSAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define OSAL_TIMEOUT_WAIT_FOREVER UINT32_MAX
+
+// nothing runs concurrently in the simulation, a mutex only remembers that it's held so a core
+// that's reset while holding one leaves it that way - see sim_core1_run in test/host/sim.h
+typedef struct {
+    bool held;
+} osal_mutex_def_t;
+typedef osal_mutex_def_t *osal_mutex_t;
+
+static inline osal_mutex_t osal_mutex_create(osal_mutex_def_t *mdef) {
+    mdef->held = false;
+    return mdef;
+}
+
+// false where the chip would wait forever, it's already held
+bool osal_mutex_lock(osal_mutex_t mutex, uint32_t msec);
+bool osal_mutex_unlock(osal_mutex_t mutex);
+
+#endif
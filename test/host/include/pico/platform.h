@@ -0,0 +1,23 @@
+#ifndef OPENRB_HOST_PICO_PLATFORM_H_
+#define OPENRB_HOST_PICO_PLATFORM_H_
+
+// just enough of the pico-sdk for the firmware sources test/ builds to compile on a host, section
+// placement means nothing here and the "core" is whichever side the simulation is playing
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(name) name
+#define __in_flash(...)
+#define __scratch_x(group)
+#define __scratch_y(group)
+
+extern uint8_t sim_core;
+static inline uint get_core_num() { return sim_core; }
+
+static inline void tight_loop_contents() {}
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef OPENRB_HOST_PICO_STDLIB_H_
+#define OPENRB_HOST_PICO_STDLIB_H_
+
+#include <hardware/gpio.h>
+#include <hardware/timer.h>
+#include <pico/platform.h>
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef OPENRB_HOST_PICO_TIME_H_
+#define OPENRB_HOST_PICO_TIME_H_
+
+#include <hardware/timer.h>
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef OPENRB_HOST_TUSB_H_
+#define OPENRB_HOST_TUSB_H_
+
+#include "common/tusb_common.h"
+#include "device/usbd.h"
+#include "host/usbh.h"
+#include "tusb_option.h"
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef OPENRB_HOST_TUSB_OPTION_H_
+#define OPENRB_HOST_TUSB_OPTION_H_
+
+// the values custom_config.h picks between, none of them mean anything to the simulation
+#define OPT_MCU_RP2040 1900
+#define OPT_OS_PICO 4
+#define OPT_MODE_DEVICE 0x0001
+#define OPT_MODE_HOST 0x0002
+#define OPT_MODE_DEFAULT_SPEED 0x0000
+
+#include "custom_config.h"
+
+#ifndef CFG_TUSB_DEBUG
+#define CFG_TUSB_DEBUG 0
+#endif
+
+#ifndef CFG_TUD_ENDPOINT0_SIZE
+#define CFG_TUD_ENDPOINT0_SIZE 64
+#endif
+
+#define TUD_OPT_RHPORT 0
+
+#endif
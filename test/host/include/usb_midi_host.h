@@ -0,0 +1,15 @@
+#ifndef OPENRB_HOST_USB_MIDI_HOST_H_
+#define OPENRB_HOST_USB_MIDI_HOST_H_
+
+#include <stdint.h>
+
+// the kit side of test/host/sim_host.c, the callbacks are drums.c's
+uint32_t tuh_midi_stream_read(uint8_t dev_addr, uint8_t *p_cable_num, uint8_t *p_buffer,
+                              uint16_t bufsize);
+
+void tuh_midi_mount_cb(uint8_t dev_addr, uint8_t in_ep, uint8_t out_ep, uint8_t num_cables_rx,
+                       uint16_t num_cables_tx);
+void tuh_midi_umount_cb(uint8_t dev_addr, uint8_t instance);
+void tuh_midi_rx_cb(uint8_t dev_addr, uint32_t num_packets);
+
+#endif
@@ -0,0 +1,416 @@
+#include "sim.h"
+
+#include <device/usbd.h>
+#include <hardware/irq.h>
+#include <hardware/timer.h>
+#include <hardware/uart.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "adapter.h"
+#include "boot_report.h"
+#include "events.h"
+#include "midi.h"
+#include "packet_queue.h"
+#include "persist.h"
+#include "power_manager.h"
+#include "profiler.h"
+#include "supervisor.h"
+#include "usb_descriptors.h"
+
+uint64_t sim_now = 0;
+uint8_t sim_core = 0;
+
+uart_inst_t sim_uart0;
+uart_inst_t sim_uart1;
+
+// a core 0 loop that keeps finding work without the clock moving has a task reposting itself
+#define MAX_PASSES_PER_TICK 100000
+
+//--------------------------------------------------------------------+
+// scheduler
+//--------------------------------------------------------------------+
+
+typedef struct {
+    timebase_us_t at;
+    uint64_t order;
+    sim_fn_t fn;
+    uintptr_t arg;
+} sim_event_t;
+
+// binary min-heap on (at, order)
+static sim_event_t *heap = NULL;
+static size_t heap_len = 0;
+static size_t heap_cap = 0;
+static uint64_t next_order = 0;
+
+static bool event_before(const sim_event_t *a, const sim_event_t *b) {
+    return a->at != b->at ? a->at < b->at : a->order < b->order;
+}
+
+static void heap_swap(size_t a, size_t b) {
+    sim_event_t tmp = heap[a];
+    heap[a] = heap[b];
+    heap[b] = tmp;
+}
+
+void sim_at(timebase_us_t at, sim_fn_t fn, uintptr_t arg) {
+    if (heap_len == heap_cap) {
+        heap_cap = heap_cap ? heap_cap * 2 : 64;
+        heap = realloc(heap, heap_cap * sizeof(*heap));
+        if (!heap) abort();
+    }
+    size_t i = heap_len++;
+    heap[i] = (sim_event_t){at < sim_now ? sim_now : at, next_order++, fn, arg};
+    while (i && event_before(&heap[i], &heap[(i - 1) / 2])) {
+        heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static sim_event_t heap_pop() {
+    sim_event_t top = heap[0];
+    heap[0] = heap[--heap_len];
+    size_t i = 0;
+    while (true) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < heap_len && event_before(&heap[left], &heap[smallest])) smallest = left;
+        if (right < heap_len && event_before(&heap[right], &heap[smallest])) smallest = right;
+        if (smallest == i) break;
+        heap_swap(i, smallest);
+        i = smallest;
+    }
+    return top;
+}
+
+//--------------------------------------------------------------------+
+// locks - the osal mutexes and the spin locks the simulation stands in for
+//--------------------------------------------------------------------+
+
+static uint32_t deadlocks = 0;
+static bool core1_running = false;
+static bool core1_reset_armed = false;
+static jmp_buf core1_reset;
+
+static bool lock_take(osal_mutex_def_t *lock) {
+    if (lock->held) {
+        // nothing else runs to give it back, on the chip this waits forever
+        deadlocks++;
+        return false;
+    }
+    lock->held = true;
+    if (sim_core == 1 && core1_running && core1_reset_armed) {
+        core1_reset_armed = false;
+        longjmp(core1_reset, 1);
+    }
+    return true;
+}
+
+static void lock_give(osal_mutex_def_t *lock) { lock->held = false; }
+
+bool osal_mutex_lock(osal_mutex_t mutex, uint32_t msec) {
+    (void)msec;
+    return lock_take(mutex);
+}
+
+bool osal_mutex_unlock(osal_mutex_t mutex) {
+    lock_give(mutex);
+    return true;
+}
+
+uint32_t sim_deadlocks() { return deadlocks; }
+
+void sim_core1_reset_on_next_lock() { core1_reset_armed = true; }
+
+bool sim_core1_run(sim_fn_t fn, uintptr_t arg) {
+    uint8_t core = sim_core;
+    core1_running = true;
+    bool finished = !setjmp(core1_reset);
+    if (finished) {
+        sim_core = 1;
+        fn(arg);
+    }
+    core1_running = false;
+    core1_reset_armed = false;
+    sim_core = core;
+    return finished;
+}
+
+//--------------------------------------------------------------------+
+// events.h - the same ready bits and deadlines as src/events.c, without the doorbell
+//--------------------------------------------------------------------+
+
+static uint32_t ready = 0;
+static timebase_us_t deadlines[N_TASKS];
+static uint32_t pending_deadlines = 0;
+
+// core 1's posts take it in src/events.c, here it's only there to be held
+static osal_mutex_def_t remote_lock;
+
+void events_init() {
+    ready = 0;
+    pending_deadlines = 0;
+    lock_give(&remote_lock);
+}
+
+void events_post_mask(uint32_t tasks) {
+    if (sim_core == 0) {
+        ready |= tasks;
+        return;
+    }
+    if (!lock_take(&remote_lock)) return;
+    ready |= tasks;
+    lock_give(&remote_lock);
+}
+
+void events_core1_reset() { lock_give(&remote_lock); }
+
+void events_post(task_e task) { events_post_mask(TASK_BIT(task)); }
+
+void events_post_at(task_e task, timebase_us_t deadline) {
+    if (task >= N_TASKS) return;
+    if ((pending_deadlines & TASK_BIT(task)) && deadline >= deadlines[task]) return;
+
+    deadlines[task] = deadline;
+    pending_deadlines |= TASK_BIT(task);
+}
+
+static uint32_t take_ready() {
+    for (int task = FIRST_TASK; task < N_TASKS; task++) {
+        if (!(pending_deadlines & TASK_BIT(task))) continue;
+        if (!timebase_reached(deadlines[task], sim_now)) continue;
+        pending_deadlines &= ~TASK_BIT(task);
+        ready |= TASK_BIT(task);
+    }
+    if (tud_task_event_ready()) ready |= TASK_BIT(TASK_USB_DEVICE);
+
+    uint32_t tasks = ready;
+    ready = 0;
+    return tasks;
+}
+
+static timebase_us_t next_deadline() {
+    timebase_us_t next = UINT64_MAX;
+    for (int task = FIRST_TASK; task < N_TASKS; task++) {
+        if (pending_deadlines & TASK_BIT(task)) next = timebase_earlier(next, deadlines[task]);
+    }
+    return next;
+}
+
+//--------------------------------------------------------------------+
+// run loop
+//--------------------------------------------------------------------+
+
+static sim_pass_hook_t pass_hook = NULL;
+
+void sim_set_pass_hook(sim_pass_hook_t hook) { pass_hook = hook; }
+
+uint64_t sim_host_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// irqs first, they'd preempt the loop on the chip, then core 0 comes round until it's idle
+static void run_due() {
+    uint32_t passes = 0;
+    while (true) {
+        if (heap_len && heap[0].at <= sim_now) {
+            sim_event_t event = heap_pop();
+            sim_core = 0;
+            event.fn(event.arg);
+            continue;
+        }
+
+        uint32_t tasks = take_ready();
+        if (!tasks) break;
+        if (++passes > MAX_PASSES_PER_TICK) {
+            fprintf(stderr, "core 0 never went idle at %llu us, tasks 0x%x\n",
+                    (unsigned long long)sim_now, (unsigned)tasks);
+            abort();
+        }
+        sim_core = 0;
+        if (!pass_hook) {
+            adapter_run_tasks(tasks);
+            continue;
+        }
+        uint64_t start = sim_host_ns();
+        adapter_run_tasks(tasks);
+        pass_hook(tasks, sim_host_ns() - start);
+    }
+}
+
+bool sim_step(timebase_us_t until) {
+    run_due();
+
+    timebase_us_t next = next_deadline();
+    if (heap_len) next = timebase_earlier(next, heap[0].at);
+    if (next > until) {
+        if (until > sim_now) sim_now = until;
+        return false;
+    }
+
+    if (next > sim_now) sim_now = next;
+    run_due();
+    return true;
+}
+
+void sim_run_until(timebase_us_t until) {
+    while (sim_step(until)) {
+    }
+}
+
+//--------------------------------------------------------------------+
+// hardware/timer.h and hardware/irq.h
+//--------------------------------------------------------------------+
+
+#define SIM_ALARMS 4
+
+static struct {
+    bool claimed;
+    bool armed;
+    uint32_t generation;  // bumped on every set/cancel, stale firings are ignored
+    hardware_alarm_callback_t callback;
+} alarms[SIM_ALARMS];
+
+int hardware_alarm_claim_unused(bool required) {
+    for (int i = 0; i < SIM_ALARMS; i++) {
+        if (alarms[i].claimed) continue;
+        alarms[i].claimed = true;
+        return i;
+    }
+    if (required) abort();
+    return -1;
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback) {
+    alarms[alarm_num].callback = callback;
+}
+
+static void fire_alarm(uintptr_t arg) {
+    uint alarm_num = arg & 0xff;
+    if (!alarms[alarm_num].armed || alarms[alarm_num].generation != (uint32_t)(arg >> 8)) return;
+    alarms[alarm_num].armed = false;
+    if (alarms[alarm_num].callback) alarms[alarm_num].callback(alarm_num);
+}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t target) {
+    alarms[alarm_num].generation++;
+    alarms[alarm_num].armed = false;
+    if (target <= sim_now) return true;
+
+    alarms[alarm_num].armed = true;
+    sim_at(target, fire_alarm, alarm_num | ((uintptr_t)alarms[alarm_num].generation << 8));
+    return false;
+}
+
+void hardware_alarm_cancel(uint alarm_num) {
+    alarms[alarm_num].generation++;
+    alarms[alarm_num].armed = false;
+}
+
+static irq_handler_t irq_handlers[N_IRQS];
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) { irq_handlers[num] = handler; }
+
+void sim_irq(uint num) {
+    sim_core = 0;
+    if (irq_handlers[num]) irq_handlers[num]();
+}
+
+//--------------------------------------------------------------------+
+// what main.c would have linked in from the modules test/ doesn't build
+//--------------------------------------------------------------------+
+
+static sim_trace_hook_t trace_hook = NULL;
+
+void sim_set_trace_hook(sim_trace_hook_t hook) { trace_hook = hook; }
+
+void trace_init() {}
+
+void trace_event(trace_event_e event, uint32_t arg0, uint32_t arg1) {
+    if (trace_hook) trace_hook(event, arg0, arg1);
+}
+
+void trace_drain() {}
+
+uint32_t trace_dropped(uint8_t core) {
+    (void)core;
+    return 0;
+}
+
+void trace_core1_reset() {}
+
+void trace_discard() {}
+
+// same requests as src/power_manager.c, there's no clock or host port power to gate
+static bool sleep_requested = false;
+static bool wake_requested = false;
+static bool sleeping = false;
+
+void power_request_sleep() {
+    wake_requested = false;
+    sleep_requested = true;
+    events_post(TASK_POWER);
+}
+
+void power_request_wake() {
+    sleep_requested = false;
+    wake_requested = true;
+    events_post(TASK_POWER);
+}
+
+bool power_sleep_pending() { return sleep_requested; }
+bool power_wake_pending() { return wake_requested; }
+bool power_is_sleeping() { return sleeping; }
+
+void power_enter_sleep() {
+    sleep_requested = false;
+    if (sleeping) return;
+    sleeping = true;
+    trace_event(TRACE_POWER, 1, 0);
+}
+
+void power_exit_sleep() {
+    wake_requested = false;
+    if (!sleeping) return;
+    sleeping = false;
+    trace_event(TRACE_POWER, 0, 0);
+}
+
+// no watchdog to feed or cores to restart, just the housekeeping that changes what the adapter does
+void supervisor_task() {
+    timebase_us_t now = timebase_now();
+    usb_poll_check(now);
+    profiler_update_utilization(now);
+    events_post_at(TASK_SUPERVISOR, now + TIMEBASE_MS(SUPERVISOR_INTERVAL_MS));
+}
+
+bool supervisor_resumed(supervisor_resume_t *resume) {
+    (void)resume;
+    return false;
+}
+
+void supervisor_core1_beat() {}
+
+bool persist_get(uint32_t index, persist_record_t *record) {
+    (void)index;
+    (void)record;
+    return false;
+}
+
+void sim_init() {
+    sim_now = TIMEBASE_MS(1);
+    boot_report_mark(BOOT_PHASE_CLOCKS);
+    xbox_fifo_init();
+    events_init();
+    events_post(TASK_SUPERVISOR);
+    tud_init(TUD_OPT_RHPORT);
+    boot_report_mark(BOOT_PHASE_TUD_INIT);
+    serial_midi_init();
+    adapter_start();
+}
@@ -0,0 +1,136 @@
+#ifndef OPENRB_SIM_H_
+#define OPENRB_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adapter.h"
+#include "timebase.h"
+#include "trace.h"
+
+// runs the core 0 firmware (src/adapter.c and everything it calls) on a host against a simulated
+// console, controllers and kit. time is simulated too: it only moves between events, so firmware
+// code costs nothing and a run is the same every time - what it measures is scheduling, pacing and
+// polling, not cycles, those are for the bench image (inc/bench.h)
+
+// the simulated clock and which core the firmware is running on
+extern uint64_t sim_now;
+extern uint8_t sim_core;
+
+// what init() in src/main.c does for core 0, the clock starts at 1ms
+void sim_init();
+
+typedef void (*sim_fn_t)(uintptr_t arg);
+
+// runs fn at `at` (or now, if that's gone by) as core 0, one standing in for core 1 sets sim_core
+// itself - events due at the same time run in the order they were scheduled
+void sim_at(timebase_us_t at, sim_fn_t fn, uintptr_t arg);
+
+// runs everything due up to and including `until`, with core 0's loop getting a pass whenever a
+// task is ready - ends with sim_now at until
+void sim_run_until(timebase_us_t until);
+
+// runs to the next thing that happens at or before until, false once there's nothing left
+bool sim_step(timebase_us_t until);
+
+// runs an irq handler the firmware installed, as core 0
+void sim_irq(uint num);
+
+// runs fn as core 1 now, false if core 1 was reset part way through it
+bool sim_core1_run(sim_fn_t fn, uintptr_t arg);
+
+// core 1 is reset the moment it takes its next lock inside sim_core1_run, leaving it held - what
+// supervisor_restart_host_cb in src/main.c has to clean up after
+void sim_core1_reset_on_next_lock();
+
+// how many times a lock was already held when something went for it, the chip would wait forever
+uint32_t sim_deadlocks();
+
+// every trace_event() the firmware makes, at the time it made it
+typedef void (*sim_trace_hook_t)(trace_event_e event, uint32_t arg0, uint32_t arg1);
+void sim_set_trace_hook(sim_trace_hook_t hook);
+
+// after every pass core 0's loop makes, with the tasks it ran and the host time they took
+typedef void (*sim_pass_hook_t)(uint32_t tasks, uint64_t host_ns);
+void sim_set_pass_hook(sim_pass_hook_t hook);
+
+// the host's monotonic clock, for measuring what firmware code costs on the machine running it
+uint64_t sim_host_ns();
+
+// inc/bench.h's bench_begin/sample/end, timed with sim_host_ns() - measures what an empty sample
+// costs, takes it off every one after and returns it
+uint32_t sim_bench_calibrate();
+
+//--------------------------------------------------------------------+
+// device port - test/host/sim_device.c
+//--------------------------------------------------------------------+
+
+typedef struct {
+    timebase_us_t at;
+    uint8_t len;
+    uint8_t data[64];
+} sim_frame_t;
+
+// enumerates and configures the adapter, interface 0's endpoints are then polled every bInterval
+// from the configuration it read, starting poll_phase_us after now
+void sim_console_connect(uint32_t poll_phase_us);
+void sim_console_disconnect();
+void sim_console_suspend();
+void sim_console_resume();
+
+// the bInterval the console is polling the IN endpoint at, 0 before it's configured us
+uint8_t sim_console_poll_interval_ms();
+
+// goes out on the first OUT poll the adapter has a buffer armed for
+void sim_console_send(const uint8_t *frame, uint8_t len);
+
+// frames the adapter sent, oldest first, stamped with the poll that collected them
+bool sim_console_receive(sim_frame_t *frame);
+
+// runs until the adapter sends a frame whose command is one of commands, anything else that comes
+// in first is dropped - false at timeout_us
+bool sim_console_wait_for(const uint8_t *commands, uint8_t n_commands, uint32_t timeout_us,
+                          sim_frame_t *frame);
+
+// called as each frame is collected, before it's queued for sim_console_receive
+typedef void (*sim_console_hook_t)(const sim_frame_t *frame);
+void sim_console_set_hook(sim_console_hook_t hook);
+
+// the shortest way from a configured console to STATE_RUNNING - one identify, one auth frame and
+// the authenticated frame - for tests that only care what happens once it's there
+bool sim_console_authenticate(uint32_t timeout_us);
+
+//--------------------------------------------------------------------+
+// host port - test/host/sim_host.c
+//--------------------------------------------------------------------+
+
+// a controller in host driver slot idx, the adapter sees it mount on core 1
+void sim_controller_plug(uint8_t idx);
+void sim_controller_unplug(uint8_t idx);
+
+// an IN report from the controller in slot idx, handled on core 1 now
+void sim_controller_send(uint8_t idx, const uint8_t *frame, uint8_t len);
+
+// called (on core 0, from whatever sent it) for every report the adapter sends a controller
+typedef void (*sim_controller_hook_t)(uint8_t idx, const sim_frame_t *frame);
+void sim_controller_set_hook(sim_controller_hook_t hook);
+
+// the controller poll interval the adapter last asked for, 0 for each controller's own bInterval
+uint8_t sim_controller_poll_interval_ms();
+
+// a usb midi kit on the host port
+void sim_kit_usb_plug();
+void sim_kit_usb_unplug();
+
+// one usb midi event packet (cable/cin, then up to 3 midi bytes), the host collects it on the
+// first 1ms frame at or after at
+void sim_kit_usb_send(timebase_us_t at, const uint8_t packet[4]);
+
+// midi bytes onto the serial port's wire at 31250 baud, starting at at or once the bytes already
+// on it are through - the uart irq runs as each one lands
+void sim_kit_serial_send(timebase_us_t at, const uint8_t *bytes, uint8_t n);
+
+// how long a byte takes on the serial midi wire, start and stop bits included
+#define SIM_SERIAL_BYTE_US (10 * 1000000 / SERIAL_MIDI_BAUD)
+
+#endif
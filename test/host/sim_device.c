@@ -0,0 +1,447 @@
+#include <device/usbd.h>
+#include <device/usbd_pvt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "xbox_one_protocol.h"
+
+// the console end of the adapter's device port, and the slice of tinyusb's usbd between it and the
+// driver: endpoints complete on the console's polls, the driver hears about it from tud_task
+
+typedef enum {
+    DEVICE_MOUNT,
+    DEVICE_UNMOUNT,
+    DEVICE_SUSPEND,
+    DEVICE_RESUME,
+    DEVICE_XFER,
+} device_event_e;
+
+typedef struct {
+    device_event_e type;
+    uint8_t ep_addr;
+    uint16_t len;
+} device_event_t;
+
+#define DEVICE_EVENTS 64
+
+static device_event_t device_events[DEVICE_EVENTS];
+static uint32_t device_events_head = 0;
+static uint32_t device_events_tail = 0;
+
+typedef struct {
+    bool open;
+    bool busy;
+    bool claimed;
+    bool waiting;        // IN, went by a poll while the bus was suspended
+    uint32_t generation;  // bumped whenever a transfer is dropped, its completion is ignored
+    uint8_t *buffer;
+    uint16_t len;
+    uint8_t interval_ms;
+    timebase_us_t last_slot;  // OUT, the last poll a frame went out on
+} endpoint_t;
+
+// [number][direction]
+static endpoint_t endpoints[16][2];
+
+static usbd_class_driver_t const *driver = NULL;
+
+static bool attached = false;  // the console's plugged in
+static bool connected = true;  // our pull-up, tud_disconnect takes it away
+static bool mounted = false;
+static bool suspended = false;
+static uint32_t poll_phase_us = 0;
+static timebase_us_t poll_origin = 0;
+
+static uint8_t in_ep = 0;
+static uint8_t out_ep = 0;
+
+// frames from the console waiting on an OUT poll
+#define CONSOLE_OUT_FRAMES 64
+static sim_frame_t console_out[CONSOLE_OUT_FRAMES];
+static uint32_t console_out_head = 0;
+static uint32_t console_out_tail = 0;
+static bool out_scheduled = false;
+
+// frames the console collected
+static sim_frame_t *received = NULL;
+static size_t received_len = 0;
+static size_t received_cap = 0;
+static size_t received_read = 0;
+
+static sim_console_hook_t console_hook = NULL;
+
+static endpoint_t *endpoint(uint8_t ep_addr) {
+    return &endpoints[ep_addr & 0x0f][tu_edpt_dir(ep_addr)];
+}
+
+static void queue_device_event(device_event_e type, uint8_t ep_addr, uint16_t len) {
+    if (device_events_head - device_events_tail >= DEVICE_EVENTS) {
+        fprintf(stderr, "device event queue overflowed\n");
+        abort();
+    }
+    device_events[device_events_head++ % DEVICE_EVENTS] = (device_event_t){type, ep_addr, len};
+}
+
+// the first poll on the endpoint's schedule at or (strictly) after `after`
+static timebase_us_t next_poll(timebase_us_t after, uint8_t interval_ms, bool strictly) {
+    timebase_us_t period = TIMEBASE_MS(interval_ms ? interval_ms : 1);
+    if (after < poll_origin) return poll_origin;
+
+    timebase_us_t slot = poll_origin + (after - poll_origin) / period * period;
+    if (slot < after || (strictly && slot == after)) slot += period;
+    return slot;
+}
+
+//--------------------------------------------------------------------+
+// console polls
+//--------------------------------------------------------------------+
+
+static void schedule_in_poll(uint8_t ep_addr);
+
+static void in_poll(uintptr_t arg) {
+    uint8_t ep_addr = arg & 0xff;
+    endpoint_t *ep = endpoint(ep_addr);
+    if (!ep->busy || ep->generation != (uint32_t)(arg >> 8)) return;
+
+    // nothing gets collected while the console's asleep, the transfer goes on the first poll after
+    if (suspended || !mounted) {
+        ep->waiting = true;
+        return;
+    }
+
+    sim_frame_t frame = {.at = sim_now, .len = (uint8_t)tu_min16(ep->len, sizeof(frame.data))};
+    memcpy(frame.data, ep->buffer, frame.len);
+    if (console_hook) console_hook(&frame);
+    if (received_len == received_cap) {
+        received_cap = received_cap ? received_cap * 2 : 256;
+        received = realloc(received, received_cap * sizeof(*received));
+        if (!received) abort();
+    }
+    received[received_len++] = frame;
+
+    queue_device_event(DEVICE_XFER, ep_addr, frame.len);
+}
+
+static void schedule_in_poll(uint8_t ep_addr) {
+    endpoint_t *ep = endpoint(ep_addr);
+    ep->waiting = false;
+    sim_at(next_poll(sim_now, ep->interval_ms, true), in_poll,
+           ep_addr | ((uintptr_t)ep->generation << 8));
+}
+
+static void schedule_out_poll();
+
+static void out_poll(uintptr_t arg) {
+    (void)arg;
+    out_scheduled = false;
+    endpoint_t *ep = endpoint(out_ep);
+    if (!mounted || suspended || !ep->busy || ep->len == UINT16_MAX) return;
+    if (console_out_tail == console_out_head) return;
+
+    const sim_frame_t *frame = &console_out[console_out_tail++ % CONSOLE_OUT_FRAMES];
+    uint16_t len = tu_min16(frame->len, ep->len);
+    memcpy(ep->buffer, frame->data, len);
+    ep->last_slot = sim_now;
+    // done as far as the console's concerned, the endpoint stays busy until tud_task gets to it
+    ep->len = UINT16_MAX;
+    queue_device_event(DEVICE_XFER, out_ep, len);
+}
+
+static void schedule_out_poll() {
+    if (out_scheduled || !out_ep || console_out_tail == console_out_head) return;
+    endpoint_t *ep = endpoint(out_ep);
+    if (!ep->busy || ep->len == UINT16_MAX) return;
+
+    // one frame per poll, a re-arm in the same poll waits for the next one
+    timebase_us_t at = next_poll(sim_now, ep->interval_ms, false);
+    if (ep->last_slot && at <= ep->last_slot) at = ep->last_slot + TIMEBASE_MS(ep->interval_ms);
+    out_scheduled = true;
+    sim_at(at, out_poll, 0);
+}
+
+void sim_console_send(const uint8_t *frame, uint8_t len) {
+    if (console_out_head - console_out_tail >= CONSOLE_OUT_FRAMES) {
+        fprintf(stderr, "console has too many frames queued\n");
+        abort();
+    }
+    sim_frame_t *queued = &console_out[console_out_head++ % CONSOLE_OUT_FRAMES];
+    queued->at = sim_now;
+    queued->len = tu_min8(len, sizeof(queued->data));
+    memcpy(queued->data, frame, queued->len);
+    schedule_out_poll();
+}
+
+bool sim_console_receive(sim_frame_t *frame) {
+    if (received_read == received_len) return false;
+    *frame = received[received_read++];
+    return true;
+}
+
+bool sim_console_wait_for(const uint8_t *commands, uint8_t n_commands, uint32_t timeout_us,
+                          sim_frame_t *frame) {
+    timebase_us_t deadline = sim_now + timeout_us;
+    while (true) {
+        while (sim_console_receive(frame)) {
+            for (uint8_t i = 0; i < n_commands; i++) {
+                if (frame->data[0] == commands[i]) return true;
+            }
+        }
+        if (!sim_step(deadline)) return false;
+    }
+}
+
+void sim_console_set_hook(sim_console_hook_t hook) { console_hook = hook; }
+
+extern volatile adapter_state_t adapter_state;
+
+bool sim_console_authenticate(uint32_t timeout_us) {
+    // identify moves us out of init, any auth frame on to authenticating, the last one to running
+    static const uint8_t frames[][6] = {
+            {CMD_IDENTIFY, 0x20, 0x01, 0x00},
+            {CMD_AUTHENTICATE, 0xf0, 0x02, 0x02, 0x00, 0x00},
+            {CMD_AUTHENTICATE, 0x00, 0x03, 0x02, 0x01, 0x00},
+    };
+    for (size_t i = 0; i < TU_ARRAY_SIZE(frames); i++) {
+        sim_console_send(frames[i], 4 + frames[i][3]);
+    }
+
+    timebase_us_t deadline = sim_now + timeout_us;
+    while (adapter_state != STATE_RUNNING) {
+        if (!sim_step(deadline)) return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// enumeration
+//--------------------------------------------------------------------+
+
+static void close_endpoints() {
+    for (int i = 0; i < 16; i++) {
+        for (int dir = 0; dir < 2; dir++) {
+            endpoints[i][dir].generation++;
+            endpoints[i][dir].open = false;
+            endpoints[i][dir].busy = false;
+            endpoints[i][dir].claimed = false;
+            endpoints[i][dir].waiting = false;
+        }
+    }
+    in_ep = out_ep = 0;
+}
+
+// reads the configuration like a console would and hands each interface to the driver, the way
+// usbd does on SET_CONFIGURATION
+static void enumerate(uintptr_t arg) {
+    (void)arg;
+    if (!attached || !connected || mounted) return;
+
+    (void)tud_descriptor_device_cb();
+    uint8_t const *config = tud_descriptor_configuration_cb(0);
+    uint16_t total = ((tusb_desc_configuration_t const *)config)->wTotalLength;
+    uint8_t const *end = config + total;
+
+    close_endpoints();
+    driver->reset(TUD_OPT_RHPORT);
+
+    uint8_t const *p_desc = tu_desc_next(config);
+    while (p_desc < end) {
+        if (tu_desc_type(p_desc) != TUSB_DESC_INTERFACE) {
+            p_desc = tu_desc_next(p_desc);
+            continue;
+        }
+        tusb_desc_interface_t const *itf = (tusb_desc_interface_t const *)p_desc;
+        uint16_t drv_len = driver->open(TUD_OPT_RHPORT, itf, (uint16_t)(end - p_desc));
+        if (!drv_len) {
+            fprintf(stderr, "driver refused interface %d\n", itf->bInterfaceNumber);
+            abort();
+        }
+        p_desc += drv_len;
+    }
+
+    poll_origin = sim_now + poll_phase_us;
+    mounted = true;
+    suspended = false;
+    queue_device_event(DEVICE_MOUNT, 0, 0);
+    schedule_out_poll();
+}
+
+void sim_console_connect(uint32_t phase_us) {
+    attached = true;
+    poll_phase_us = phase_us;
+    enumerate(0);
+}
+
+static void unmount() {
+    if (!mounted) return;
+    mounted = false;
+    suspended = false;
+    close_endpoints();
+    queue_device_event(DEVICE_UNMOUNT, 0, 0);
+}
+
+void sim_console_disconnect() {
+    attached = false;
+    unmount();
+}
+
+void sim_console_suspend() {
+    if (!mounted || suspended) return;
+    suspended = true;
+    queue_device_event(DEVICE_SUSPEND, 0, 0);
+}
+
+void sim_console_resume() {
+    if (!mounted || !suspended) return;
+    suspended = false;
+    queue_device_event(DEVICE_RESUME, 0, 0);
+    if (in_ep && endpoint(in_ep)->waiting) schedule_in_poll(in_ep);
+    schedule_out_poll();
+}
+
+uint8_t sim_console_poll_interval_ms() {
+    return mounted && in_ep ? endpoint(in_ep)->interval_ms : 0;
+}
+
+//--------------------------------------------------------------------+
+// device/usbd.h
+//--------------------------------------------------------------------+
+
+bool tud_init(uint8_t rhport) {
+    (void)rhport;
+    uint8_t count;
+    driver = usbd_app_driver_get_cb(&count);
+    driver->init();
+    return true;
+}
+
+void tud_task() {
+    while (device_events_tail != device_events_head) {
+        device_event_t event = device_events[device_events_tail++ % DEVICE_EVENTS];
+        switch (event.type) {
+            case DEVICE_MOUNT:
+                if (tud_mount_cb) tud_mount_cb();
+                break;
+            case DEVICE_UNMOUNT:
+                driver->reset(TUD_OPT_RHPORT);
+                if (tud_umount_cb) tud_umount_cb();
+                break;
+            case DEVICE_SUSPEND:
+                if (tud_suspend_cb) tud_suspend_cb(false);
+                break;
+            case DEVICE_RESUME:
+                if (tud_resume_cb) tud_resume_cb();
+                break;
+            case DEVICE_XFER: {
+                endpoint_t *ep = endpoint(event.ep_addr);
+                if (!ep->open || !ep->busy) break;
+                ep->busy = false;
+                ep->claimed = false;
+                driver->xfer_cb(TUD_OPT_RHPORT, event.ep_addr, XFER_RESULT_SUCCESS, event.len);
+                break;
+            }
+        }
+    }
+}
+
+bool tud_task_event_ready() { return device_events_tail != device_events_head; }
+
+bool tud_mounted() { return mounted; }
+
+bool tud_suspended() { return suspended; }
+
+bool tud_connect() {
+    connected = true;
+    // the console enumerates us again a little after it sees us come back
+    if (attached) sim_at(sim_now + TIMEBASE_MS(50), enumerate, 0);
+    return true;
+}
+
+bool tud_disconnect() {
+    connected = false;
+    unmount();
+    return true;
+}
+
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const *request, void *buffer,
+                      uint16_t len) {
+    (void)rhport;
+    (void)request;
+    (void)buffer;
+    (void)len;
+    return true;
+}
+
+bool tud_control_status(uint8_t rhport, tusb_control_request_t const *request) {
+    (void)rhport;
+    (void)request;
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// device/usbd_pvt.h
+//--------------------------------------------------------------------+
+
+bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const *desc_ep) {
+    (void)rhport;
+    endpoint_t *ep = endpoint(desc_ep->bEndpointAddress);
+    ep->open = true;
+    ep->busy = false;
+    ep->claimed = false;
+    ep->interval_ms = desc_ep->bInterval;
+    ep->last_slot = 0;
+    if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+        in_ep = desc_ep->bEndpointAddress;
+    } else {
+        out_ep = desc_ep->bEndpointAddress;
+    }
+    return true;
+}
+
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes) {
+    (void)rhport;
+    endpoint_t *ep = endpoint(ep_addr);
+    TU_VERIFY(ep->open && !ep->busy);
+
+    ep->busy = true;
+    ep->buffer = buffer;
+    ep->len = total_bytes;
+    if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) {
+        schedule_in_poll(ep_addr);
+    } else {
+        schedule_out_poll();
+    }
+    return true;
+}
+
+bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr) {
+    (void)rhport;
+    return endpoint(ep_addr)->busy;
+}
+
+bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr) {
+    (void)rhport;
+    endpoint_t *ep = endpoint(ep_addr);
+    if (ep->busy || ep->claimed) return false;
+    ep->claimed = true;
+    return true;
+}
+
+bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr) {
+    (void)rhport;
+    endpoint(ep_addr)->claimed = false;
+    return true;
+}
+
+void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
+    (void)rhport;
+    endpoint_t *ep = endpoint(ep_addr);
+    ep->generation++;
+    ep->waiting = false;
+}
+
+void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
+    (void)rhport;
+    endpoint(ep_addr)->busy = false;
+}
@@ -0,0 +1,152 @@
+#include <hardware/irq.h>
+#include <hardware/uart.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "usb_midi_host.h"
+#include "xbox_controller_driver.h"
+
+// everything on the adapter's host port and the serial midi jack. controllers and the usb kit are
+// seen through the callbacks xbox_controller_driver.c and usb_midi_host would make on core 1
+
+#define KIT_USB_ADDR (XBOX_MAX_CONTROLLERS + 1)
+
+static bool controller_plugged[XBOX_MAX_CONTROLLERS];
+static sim_controller_hook_t controller_hook = NULL;
+static uint8_t controller_poll_interval_ms = 0;
+
+static uint8_t controller_addr(uint8_t idx) { return idx + 1; }
+
+void sim_controller_plug(uint8_t idx) {
+    if (idx >= XBOX_MAX_CONTROLLERS || controller_plugged[idx]) return;
+    controller_plugged[idx] = true;
+    sim_core = 1;
+    xboxh_mount_cb(controller_addr(idx), idx);
+    sim_core = 0;
+}
+
+void sim_controller_unplug(uint8_t idx) {
+    if (idx >= XBOX_MAX_CONTROLLERS || !controller_plugged[idx]) return;
+    controller_plugged[idx] = false;
+    sim_core = 1;
+    xboxh_umount_cb(controller_addr(idx), idx);
+    sim_core = 0;
+}
+
+void sim_controller_send(uint8_t idx, const uint8_t *frame, uint8_t len) {
+    if (idx >= XBOX_MAX_CONTROLLERS || !controller_plugged[idx]) return;
+
+    xbox_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    len = len < sizeof(packet.buffer) ? len : sizeof(packet.buffer);
+    memcpy(packet.buffer, frame, len);
+    packet.length = len;
+
+    sim_core = 1;
+    xboxh_packet_received_cb(idx, &packet, len);
+    sim_core = 0;
+}
+
+void sim_controller_set_hook(sim_controller_hook_t hook) { controller_hook = hook; }
+
+uint8_t sim_controller_poll_interval_ms() { return controller_poll_interval_ms; }
+
+bool xboxh_send_report(uint8_t daddr, uint8_t idx, const void *report, uint16_t len) {
+    if (idx >= XBOX_MAX_CONTROLLERS || !controller_plugged[idx]) return false;
+    if (daddr != controller_addr(idx)) return false;
+
+    sim_frame_t frame = {.at = sim_now, .len = (uint8_t)(len < 64 ? len : 64)};
+    memcpy(frame.data, report, frame.len);
+    if (controller_hook) controller_hook(idx, &frame);
+    return true;
+}
+
+void xboxh_set_poll_interval(uint8_t interval_ms) { controller_poll_interval_ms = interval_ms; }
+
+//--------------------------------------------------------------------+
+// usb midi kit
+//--------------------------------------------------------------------+
+
+#define KIT_USB_PACKETS 256
+
+static bool kit_usb_plugged = false;
+static uint8_t kit_usb_packets[KIT_USB_PACKETS][4];
+static uint32_t kit_usb_head = 0;
+static uint32_t kit_usb_tail = 0;
+
+void sim_kit_usb_plug() {
+    if (kit_usb_plugged) return;
+    kit_usb_plugged = true;
+    kit_usb_head = kit_usb_tail = 0;
+    sim_core = 1;
+    tuh_midi_mount_cb(KIT_USB_ADDR, 0x81, 0x02, 1, 1);
+    sim_core = 0;
+}
+
+void sim_kit_usb_unplug() {
+    if (!kit_usb_plugged) return;
+    kit_usb_plugged = false;
+    sim_core = 1;
+    tuh_midi_umount_cb(KIT_USB_ADDR, 0);
+    sim_core = 0;
+}
+
+static void kit_usb_arrive(uintptr_t arg) {
+    if (!kit_usb_plugged || kit_usb_head - kit_usb_tail >= KIT_USB_PACKETS) return;
+    memcpy(kit_usb_packets[kit_usb_head++ % KIT_USB_PACKETS], &arg, 4);
+    sim_core = 1;
+    tuh_midi_rx_cb(KIT_USB_ADDR, 1);
+    sim_core = 0;
+}
+
+void sim_kit_usb_send(timebase_us_t at, const uint8_t packet[4]) {
+    // the host only collects on frame boundaries
+    timebase_us_t frame = (at + TIMEBASE_MS(1) - 1) / TIMEBASE_MS(1) * TIMEBASE_MS(1);
+    uintptr_t arg = 0;
+    memcpy(&arg, packet, 4);
+    sim_at(frame, kit_usb_arrive, arg);
+}
+
+// midi bytes each usb midi code index number carries
+static uint8_t cin_length(uint8_t cin) {
+    static const uint8_t lengths[16] = {0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1};
+    return lengths[cin & 0x0f];
+}
+
+// whole packets only, like usb_midi_host's stream read
+uint32_t tuh_midi_stream_read(uint8_t dev_addr, uint8_t *p_cable_num, uint8_t *p_buffer,
+                              uint16_t bufsize) {
+    if (!kit_usb_plugged || dev_addr != KIT_USB_ADDR) return 0;
+
+    uint32_t n = 0;
+    while (kit_usb_tail != kit_usb_head) {
+        const uint8_t *packet = kit_usb_packets[kit_usb_tail % KIT_USB_PACKETS];
+        uint8_t len = cin_length(packet[0]);
+        if (n + len > bufsize) break;
+        *p_cable_num = packet[0] >> 4;
+        memcpy(p_buffer + n, packet + 1, len);
+        n += len;
+        kit_usb_tail++;
+    }
+    return n;
+}
+
+//--------------------------------------------------------------------+
+// serial midi
+//--------------------------------------------------------------------+
+
+static timebase_us_t serial_wire_free_at = 0;
+
+static void serial_byte_arrive(uintptr_t arg) {
+    sim_uart0.rx[sim_uart0.head++] = (uint8_t)arg;
+    sim_irq(UART0_IRQ);
+}
+
+void sim_kit_serial_send(timebase_us_t at, const uint8_t *bytes, uint8_t n) {
+    timebase_us_t start = at > serial_wire_free_at ? at : serial_wire_free_at;
+    for (uint8_t i = 0; i < n; i++) {
+        sim_at(start + (timebase_us_t)(i + 1) * SIM_SERIAL_BYTE_US, serial_byte_arrive, bytes[i]);
+    }
+    serial_wire_free_at = start + (timebase_us_t)n * SIM_SERIAL_BYTE_US;
+}
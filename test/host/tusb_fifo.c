@@ -0,0 +1,61 @@
+#include <common/tusb_fifo.h>
+#include <string.h>
+
+bool tu_fifo_config(tu_fifo_t *f, void *buffer, uint16_t depth, uint16_t item_size,
+                    bool overwritable) {
+    f->buffer = buffer;
+    f->depth = depth;
+    f->item_size = item_size;
+    f->overwritable = overwritable;
+    f->wr_idx = f->rd_idx = 0;
+    return true;
+}
+
+uint16_t tu_fifo_count(tu_fifo_t *f) { return (uint16_t)(f->wr_idx - f->rd_idx); }
+bool tu_fifo_empty(tu_fifo_t *f) { return f->wr_idx == f->rd_idx; }
+bool tu_fifo_full(tu_fifo_t *f) { return tu_fifo_count(f) >= f->depth; }
+
+static bool lock(osal_mutex_t mutex) {
+    return !mutex || osal_mutex_lock(mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+}
+
+static void unlock(osal_mutex_t mutex) {
+    if (mutex) osal_mutex_unlock(mutex);
+}
+
+bool tu_fifo_write(tu_fifo_t *f, const void *data) {
+    // where the chip would never get the mutex, the write never happens
+    if (!lock(f->mutex_wr)) return false;
+    bool written = !tu_fifo_full(f) || f->overwritable;
+    if (written) {
+        if (tu_fifo_full(f)) f->rd_idx++;
+        memcpy(f->buffer + (f->wr_idx % f->depth) * f->item_size, data, f->item_size);
+        f->wr_idx++;
+    }
+    unlock(f->mutex_wr);
+    return written;
+}
+
+bool tu_fifo_peek(tu_fifo_t *f, void *p_buffer) {
+    if (tu_fifo_empty(f)) return false;
+    memcpy(p_buffer, f->buffer + (f->rd_idx % f->depth) * f->item_size, f->item_size);
+    return true;
+}
+
+bool tu_fifo_read(tu_fifo_t *f, void *buffer) {
+    if (!lock(f->mutex_rd)) return false;
+    bool read = tu_fifo_peek(f, buffer);
+    if (read) f->rd_idx++;
+    unlock(f->mutex_rd);
+    return read;
+}
+
+void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n) {
+    uint16_t count = tu_fifo_count(f);
+    f->rd_idx += n < count ? n : count;
+}
+
+bool tu_fifo_clear(tu_fifo_t *f) {
+    f->rd_idx = f->wr_idx = 0;
+    return true;
+}
@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adapter.h"
+#include "check.h"
+#include "instrument_manager.h"
+#include "loadgen.h"
+#include "profiler.h"
+#include "sim.h"
+#include "stats.h"
+#include "usb_descriptors.h"
+#include "xbox_one_protocol.h"
+
+// hit to report latency and dropped hits, the same gate tools/latency_check.py is on a rig. grooves
+// and dense bursts go in over usb and serial midi, every rising edge in the drum reports the
+// console collects is matched to the hit that caused it, and the load generator's own counters and
+// PROFILE_HIT_LATENCY are checked the way the rig script reads them from the stats block
+//
+// the sim's clock only moves between events, so what's measured here is the adapter's scheduling -
+// ON_DELAY_MS, report coalescing, fifo pacing and where polls land - not how long the code takes to
+// run, which the bench image (inc/bench.h) covers. that's also what makes it reproducible enough
+// to fail a build on: a change that adds a poll anywhere on the hit path shows up here
+
+// one midi note per output, in the default map - the same pads get the same notes every time so a
+// rising edge can only have come from one hit
+typedef enum {
+    PAD_KICK,
+    PAD_RED,
+    PAD_YELLOW,
+    PAD_BLUE,
+    PAD_GREEN,
+    PAD_CYM_YELLOW,
+    PAD_CYM_BLUE,
+    PAD_CYM_GREEN,
+    N_PADS,
+} pad_e;
+
+static const uint8_t pad_notes[N_PADS] = {36, 38, 48, 45, 43, 42, 51, 49};
+static const char *pad_names[N_PADS] = {"kick",  "red",        "yellow",   "blue",
+                                        "green", "cym_yellow", "cym_blue", "cym_green"};
+
+// every hit at the same velocity, so crosstalk never masks one - that's drums.c's business and
+// tested with the replay, here every hit sent has to come out
+#define VELOCITY 100
+// hits on one pad are further apart than the hold, plus a poll either side for the release to be
+// reported on its own - anything closer is merged by design
+#define MIN_PAD_SPACING_US TIMEBASE_MS(TRIGGER_HOLD_MS + 20)
+
+// every hit a workload sends is queued up front, and waits here until a report carries it
+#define PENDING_HITS 512
+#define MAX_SAMPLES 4096
+
+typedef struct {
+    const char *name;
+    timebase_us_t pending[N_PADS][PENDING_HITS];
+    uint32_t pending_head[N_PADS];
+    uint32_t pending_tail[N_PADS];
+    uint32_t sent;
+    uint32_t phantom;  // rising edges nothing was sent for
+    uint32_t samples_us[MAX_SAMPLES];
+    uint32_t n_samples;
+} run_t;
+
+static run_t *run = NULL;
+static uint8_t last_pads = 0;
+
+static uint32_t poll_us = 0;
+
+//--------------------------------------------------------------------+
+// the kit
+//--------------------------------------------------------------------+
+
+static void sent(pad_e pad, timebase_us_t at) {
+    if (run->pending_head[pad] - run->pending_tail[pad] >= PENDING_HITS) abort();
+    run->pending[pad][run->pending_head[pad]++ % PENDING_HITS] = at;
+    run->sent++;
+}
+
+static void usb_hit(pad_e pad, timebase_us_t at) {
+    const uint8_t packet[4] = {0x09, 0x99, pad_notes[pad], VELOCITY};
+    sim_kit_usb_send(at, packet);
+    sent(pad, at);
+}
+
+static void serial_hit(pad_e pad, timebase_us_t at) {
+    const uint8_t bytes[3] = {0x99, pad_notes[pad], VELOCITY};
+    sim_kit_serial_send(at, bytes, sizeof(bytes));
+    sent(pad, at);
+}
+
+typedef void (*hit_fn_t)(pad_e pad, timebase_us_t at);
+
+// the same pseudo random sequence every run, so is every result
+static uint32_t jitter_us(uint32_t range) {
+    static uint32_t state = 0x2545f491;
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) % range;
+}
+
+//--------------------------------------------------------------------+
+// the console end
+//--------------------------------------------------------------------+
+
+static uint8_t pads_in(const xbox_packet_t *packet) {
+    const xb_one_drum_input_pkt_t *drums = &packet->drum_input;
+    // the game reads both pedals as the kick lane
+    return (drums->kick || drums->doublekick) << PAD_KICK | drums->pad_red << PAD_RED |
+           drums->pad_yellow << PAD_YELLOW | drums->pad_blue << PAD_BLUE |
+           drums->pad_green << PAD_GREEN | drums->cymbal_yellow << PAD_CYM_YELLOW |
+           drums->cymbal_blue << PAD_CYM_BLUE | drums->cymbal_green << PAD_CYM_GREEN;
+}
+
+static void on_console_frame(const sim_frame_t *frame) {
+    xbox_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    memcpy(packet.buffer, frame->data, frame->len);
+    if (packet.frame.command != CMD_INPUT || packet.wla_header.playerId != DRUMS) return;
+
+    uint8_t pads = pads_in(&packet);
+    uint8_t rising = pads & ~last_pads;
+    last_pads = pads;
+    if (!run) return;
+
+    for (int pad = 0; pad < N_PADS; pad++) {
+        if (!(rising & (1u << pad))) continue;
+        if (run->pending_tail[pad] == run->pending_head[pad]) {
+            run->phantom++;
+            continue;
+        }
+        timebase_us_t at = run->pending[pad][run->pending_tail[pad]++ % PENDING_HITS];
+        if (run->n_samples < MAX_SAMPLES) run->samples_us[run->n_samples++] = frame->at - at;
+    }
+}
+
+//--------------------------------------------------------------------+
+// results
+//--------------------------------------------------------------------+
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t percent) {
+    return n ? sorted[(n - 1) * percent / 100] : 0;
+}
+
+// wire to console, for one workload
+static void check_run(uint32_t p50_budget_us, uint32_t max_budget_us) {
+    qsort(run->samples_us, run->n_samples, sizeof(uint32_t), compare_u32);
+    uint32_t p50 = percentile(run->samples_us, run->n_samples, 50);
+    uint32_t p99 = percentile(run->samples_us, run->n_samples, 99);
+    uint32_t max = run->n_samples ? run->samples_us[run->n_samples - 1] : 0;
+
+    uint32_t dropped = 0;
+    for (int pad = 0; pad < N_PADS; pad++) {
+        uint32_t left = run->pending_head[pad] - run->pending_tail[pad];
+        if (left) printf("     %s: %u hits never reported\n", pad_names[pad], (unsigned)left);
+        dropped += left;
+    }
+
+    check(run->sent && !dropped && !run->phantom, "%-14s %4u hits, %u dropped, %u phantom",
+          run->name, (unsigned)run->sent, (unsigned)dropped, (unsigned)run->phantom);
+    check(p50 <= p50_budget_us && max <= max_budget_us,
+          "%-14s wire to console p50 %5.2fms p99 %5.2fms max %5.2fms (budget %5.2f / %5.2fms)",
+          run->name, p50 / 1000.0, p99 / 1000.0, max / 1000.0, p50_budget_us / 1000.0,
+          max_budget_us / 1000.0);
+}
+
+// what the stats block would show latency_check.py, first hit in a report to it being collected
+static void check_profile(const char *name) {
+    profile_report_t latency;
+    profiler_get(PROFILE_HIT_LATENCY, &latency);
+    check(latency.count && latency.max_us <= latency.budget_us && !latency.over_budget &&
+                  latency.budget_us == HIT_LATENCY_BUDGET_US(usb_poll_interval_ms()),
+          "%-14s PROFILE_HIT_LATENCY %u reports, p50 %uus p99 %uus max %uus (budget %uus, %u "
+          "over)",
+          name, (unsigned)latency.count, (unsigned)latency.p50_us, (unsigned)latency.p99_us,
+          (unsigned)latency.max_us, (unsigned)latency.budget_us, (unsigned)latency.over_budget);
+}
+
+static void begin(run_t *next, const char *name) {
+    memset(next, 0, sizeof(*next));
+    next->name = name;
+    run = next;
+}
+
+// lets the last hits go out and the pads release before the next workload starts
+static void settle() {
+    sim_run_until(sim_now + MIN_PAD_SPACING_US + TIMEBASE_MS(ON_DELAY_MS) + 2 * poll_us);
+}
+
+//--------------------------------------------------------------------+
+// workloads
+//--------------------------------------------------------------------+
+
+// kick on 1 and 3, snare on 2 and 4, hats on every eighth, a tom fill at the end of each bar -
+// hits land anywhere inside a usb frame or a poll
+static void groove(hit_fn_t hit, uint32_t bars) {
+    const timebase_us_t eighth = TIMEBASE_MS(125);
+    timebase_us_t start = sim_now + TIMEBASE_MS(10);
+    for (uint32_t step = 0; step < bars * 8; step++) {
+        timebase_us_t at = start + step * eighth + jitter_us(2000);
+        hit(PAD_CYM_YELLOW, at);
+        if (step % 4 == 0) hit(PAD_KICK, at);
+        if (step % 4 == 2) hit(PAD_RED, at);
+        if (step % 8 == 7) {
+            hit(PAD_YELLOW, at + eighth / 3);
+            hit(PAD_BLUE, at + 2 * eighth / 3);
+        }
+    }
+    sim_run_until(start + bars * 8 * eighth);
+}
+
+// four pad chords as fast as the hold lets a pad come back, with flams between them - the fifo
+// and the coalescing window under the most a kit can throw at them
+static void bursts(hit_fn_t hit, uint32_t chords) {
+    timebase_us_t start = sim_now + TIMEBASE_MS(10);
+    for (uint32_t i = 0; i < chords; i++) {
+        timebase_us_t at = start + i * MIN_PAD_SPACING_US;
+        hit(PAD_KICK, at);
+        hit(PAD_RED, at);
+        hit(PAD_CYM_YELLOW, at);
+        hit(PAD_CYM_GREEN, at + jitter_us(500));
+        // a flam across two toms, the second stroke a few ms behind
+        hit(PAD_BLUE, at + TIMEBASE_MS(20));
+        hit(PAD_GREEN, at + TIMEBASE_MS(20) + 2000 + jitter_us(3000));
+    }
+    sim_run_until(start + chords * MIN_PAD_SPACING_US);
+}
+
+static void usb_and_serial(pad_e pad, timebase_us_t at) {
+    // the kit's pads on usb, its cymbals on a second module over serial
+    if (pad >= PAD_CYM_YELLOW)
+        serial_hit(pad, at);
+    else
+        usb_hit(pad, at);
+}
+
+//--------------------------------------------------------------------+
+
+static void loadgen(uint32_t seconds) {
+    // tools/latency_check.py's default pattern - kick, snare and a cymbal
+    loadgen_config_t config = {
+            .mode = LOADGEN_PATTERN,
+            .velocity = VELOCITY,
+            .pad_interval_ms = {120, 90, 60},
+            .notes = {36, 38, 42},
+    };
+    loadgen_configure(&config);
+    sim_run_until(sim_now + TIMEBASE_MS(1000) * seconds);
+    config.mode = LOADGEN_OFF;
+    loadgen_configure(&config);
+    settle();
+
+    uint32_t generated = loadgen_generated();
+    uint32_t reported = loadgen_reported();
+    check(generated && loadgen_accepted() == generated && reported == generated,
+          "loadgen        %4u hits generated, %u accepted, %u reported", (unsigned)generated,
+          (unsigned)loadgen_accepted(), (unsigned)reported);
+}
+
+int main() {
+    sim_init();
+    sim_console_set_hook(on_console_frame);
+    sim_console_connect(250);
+    sim_kit_usb_plug();
+    sim_run_until(TIMEBASE_MS(100));
+    if (!sim_console_authenticate(TIMEBASE_MS(100))) {
+        check(false, "console authenticated");
+        return 1;
+    }
+    poll_us = TIMEBASE_MS(sim_console_poll_interval_ms());
+    sim_run_until(sim_now + TIMEBASE_MS(50));
+    profiler_reset(PROFILE_HIT_LATENCY);
+
+    // a hit waits out ON_DELAY_MS, up to a poll for the report before it to be collected, then a
+    // poll for its own - usb adds up to a frame before the host sees it, serial the bytes ahead of
+    // it on the wire
+    const uint32_t adapter_us = TIMEBASE_MS(ON_DELAY_MS) + 2 * poll_us;
+    const uint32_t usb_us = TIMEBASE_MS(1);
+    const uint32_t serial_note_us = 3 * SIM_SERIAL_BYTE_US;
+
+    static run_t runs[5];
+    begin(&runs[0], "usb groove");
+    groove(usb_hit, 32);
+    settle();
+    check_run(TIMEBASE_MS(ON_DELAY_MS) + poll_us + usb_us, adapter_us + usb_us);
+
+    begin(&runs[1], "serial groove");
+    groove(serial_hit, 32);
+    settle();
+    check_run(TIMEBASE_MS(ON_DELAY_MS) + poll_us + serial_note_us,
+              adapter_us + 3 * serial_note_us);
+
+    begin(&runs[2], "usb bursts");
+    bursts(usb_hit, 100);
+    settle();
+    check_run(TIMEBASE_MS(ON_DELAY_MS) + poll_us + usb_us, adapter_us + usb_us);
+
+    begin(&runs[3], "serial bursts");
+    bursts(serial_hit, 100);
+    settle();
+    check_run(TIMEBASE_MS(ON_DELAY_MS) + poll_us + serial_note_us,
+              adapter_us + 4 * serial_note_us);
+
+    begin(&runs[4], "mixed bursts");
+    bursts(usb_and_serial, 100);
+    settle();
+    check_run(TIMEBASE_MS(ON_DELAY_MS) + poll_us + usb_us, adapter_us + 2 * serial_note_us);
+    run = NULL;
+    check_profile("kit");
+
+    // starting the load generator resets the profile, it's read again for just that run
+    loadgen(10);
+    check_profile("loadgen");
+
+    check(!stats_get(STAT_FIFO_WRITE_FAILURES) && !stats_get(STAT_HITS_DROPPED_HOLD) &&
+                  !stats_get(STAT_HITS_DROPPED_CROSSTALK),
+          "no fifo failures (%u), hold drops (%u) or crosstalk drops (%u)",
+          (unsigned)stats_get(STAT_FIFO_WRITE_FAILURES),
+          (unsigned)stats_get(STAT_HITS_DROPPED_HOLD),
+          (unsigned)stats_get(STAT_HITS_DROPPED_CROSSTALK));
+
+    return failures ? 1 : 0;
+}
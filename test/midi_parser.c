@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "midi_parser.h"
+
+// src/midi_parser.c byte streams with the exact events each has to produce - every case goes
+// through in one midi_parse() call and again a byte at a time, which have to agree.
+// test/fuzz/midi_parser.c throws everything else at it
+
+#define MAX_EVENTS 32
+
+static const char *type_name(midi_type_e type) {
+    switch (type) {
+        case NoteOff:
+            return "off";
+        case NoteOn:
+            return "on";
+        case ControlChange:
+            return "cc";
+        case ProgramChange:
+            return "pc";
+        case PitchBend:
+            return "bend";
+        case SongPosition:
+            return "songpos";
+        case SongSelect:
+            return "song";
+        case TuneRequest:
+            return "tune";
+        case Clock:
+            return "clock";
+        case Start:
+            return "start";
+        case ActiveSensing:
+            return "sensing";
+        default:
+            return "?";
+    }
+}
+
+// "on 9 36 100, clock 0 0 0, ..." - data bytes a message doesn't have are 0
+static void describe(const midi_event_t *events, uint8_t n, char *out, size_t size) {
+    size_t len = 0;
+    out[0] = '\0';
+    for (uint8_t i = 0; i < n && len < size; i++) {
+        len += snprintf(out + len, size - len, "%s%s %u %u %u", i ? ", " : "",
+                        type_name(events[i].type), events[i].channel, events[i].data1,
+                        events[i].data2);
+    }
+}
+
+static void expect(const char *name, const uint8_t *bytes, uint32_t len, const char *want) {
+    midi_parser_t parser;
+    midi_event_t events[MAX_EVENTS];
+    uint32_t consumed;
+    char batch[512];
+    char bytewise[512];
+
+    midi_parser_init(&parser);
+    uint8_t n = midi_parse(&parser, bytes, len, events, MAX_EVENTS, &consumed);
+    describe(events, n, batch, sizeof(batch));
+
+    midi_parser_init(&parser);
+    uint8_t m = 0;
+    for (uint32_t i = 0; i < len && m < MAX_EVENTS; i++) {
+        if (midi_parse_byte(&parser, bytes[i], &events[m])) m++;
+    }
+    describe(events, m, bytewise, sizeof(bytewise));
+
+    bool ok = consumed == len && !strcmp(batch, want) && !strcmp(bytewise, want);
+    check(ok, "%s", name);
+    if (!ok) printf("     want: %s\n     got:  %s\n     bytes: %s\n", want, batch, bytewise);
+}
+
+#define EXPECT(name, want, ...)                       \
+    do {                                              \
+        static const uint8_t bytes[] = {__VA_ARGS__}; \
+        expect(name, bytes, sizeof(bytes), want);     \
+    } while (0)
+
+// a batch that's cut off at max_events picks up where it left off, running status and all
+static void resumes_after_max_events() {
+    static const uint8_t bytes[] = {0x99, 36, 100, 38, 90, 42, 80, 46, 70};
+    midi_parser_t parser;
+    midi_event_t events[2];
+    uint32_t consumed;
+    uint32_t offset = 0;
+    uint8_t notes[4];
+    uint8_t n_notes = 0;
+
+    midi_parser_init(&parser);
+    while (offset < sizeof(bytes)) {
+        uint8_t n = midi_parse(&parser, bytes + offset, sizeof(bytes) - offset, events, 2,
+                               &consumed);
+        for (uint8_t i = 0; i < n && n_notes < sizeof(notes); i++) {
+            notes[n_notes++] = events[i].data1;
+        }
+        if (!consumed) break;
+        offset += consumed;
+    }
+    check(n_notes == 4 && notes[0] == 36 && notes[1] == 38 && notes[2] == 42 && notes[3] == 46,
+          "resumes after max_events");
+
+    midi_parser_init(&parser);
+    uint8_t n = midi_parse(&parser, bytes, sizeof(bytes), events, 1, &consumed);
+    check(n == 1 && consumed == 3, "stops on the byte that fills max_events (consumed %u)",
+          (unsigned)consumed);
+}
+
+int main() {
+    EXPECT("note on", "on 9 36 100", 0x99, 36, 100);
+    EXPECT("note off", "off 9 36 64", 0x89, 36, 64);
+    EXPECT("velocity 0 note on is a note off", "on 9 38 90, off 9 38 0", 0x99, 38, 90, 0x99, 38,
+           0);
+    EXPECT("running status", "on 9 36 100, on 9 38 90, off 9 36 0, on 9 42 80", 0x99, 36, 100, 38,
+           90, 36, 0, 42, 80);
+    EXPECT("running status across a velocity 0 note on", "off 9 36 0, on 9 36 127", 0x99, 36, 0,
+           36, 127);
+    EXPECT("one data byte messages", "pc 0 5 0, pc 0 6 0", 0xc0, 5, 6);
+    EXPECT("channel is kept", "on 0 36 1, on 15 36 1", 0x90, 36, 1, 0x9f, 36, 1);
+
+    // realtime bytes can land anywhere, even between a note's data bytes, and don't disturb it
+    EXPECT("clock inside a note", "clock 0 0 0, on 9 36 100", 0x99, 0xf8, 36, 100);
+    EXPECT("clock between data bytes", "clock 0 0 0, on 9 36 100", 0x99, 36, 0xf8, 100);
+    EXPECT("realtime inside running status", "on 9 36 100, start 0 0 0, sensing 0 0 0, on 9 38 90",
+           0x99, 36, 100, 38, 0xfa, 0xfe, 90);
+    EXPECT("undefined realtime is dropped", "on 9 36 100", 0x99, 36, 0xfd, 100);
+
+    // sysex is skipped, whatever ends it - f7, or any status byte when the f7 never comes
+    EXPECT("sysex is skipped", "on 9 36 100", 0xf0, 0x43, 0x10, 0x4c, 0xf7, 0x99, 36, 100);
+    EXPECT("unterminated sysex ends on the next status", "on 9 36 100", 0xf0, 0x43, 0x10, 0x4c,
+           0x00, 0x99, 36, 100);
+    EXPECT("data after an unterminated sysex is dropped", "", 0xf0, 0x43, 36, 100);
+    EXPECT("sysex takes running status with it", "", 0x99, 0xf0, 0x7e, 0xf7, 36, 100);
+    EXPECT("realtime inside sysex", "clock 0 0 0, on 9 36 100", 0xf0, 0x43, 0xf8, 0x10, 0xf7,
+           0x99, 36, 100);
+
+    // system common messages have their own lengths and cancel running status
+    EXPECT("song position", "songpos 0 16 2", 0xf2, 16, 2);
+    EXPECT("song select cancels running status", "on 9 36 100, song 0 3 0", 0x99, 36, 100, 0xf3,
+           3, 38, 90);
+    EXPECT("tune request", "tune 0 0 0", 0xf6);
+    EXPECT("undefined system common cancels running status", "on 9 36 100", 0x99, 36, 100, 0xf4,
+           38, 90);
+
+    EXPECT("data with no status is dropped", "on 9 38 90", 36, 100, 0x99, 38, 90);
+    EXPECT("a new status mid message starts over", "on 9 38 90", 0x99, 36, 0x99, 38, 90);
+    EXPECT("truncated note is held", "", 0x99, 36);
+
+    // a note cut across two reads, the way usb packets and the serial irq deliver them
+    midi_parser_t parser;
+    midi_event_t event;
+    midi_parser_init(&parser);
+    bool early = midi_parse_byte(&parser, 0x99, &event) || midi_parse_byte(&parser, 36, &event);
+    bool done = midi_parse_byte(&parser, 100, &event);
+    check(!early && done && event.type == NoteOn && event.data1 == 36 && event.data2 == 100,
+          "note split across reads");
+
+    resumes_after_max_events();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,402 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "events.h"
+#include "sim.h"
+#include "xbox_controller_driver.h"
+
+// replays a session - console frames, controller reports and kit input at the times they happened
+// - through the host build, and writes out everything the adapter sent the console and the
+// controllers. with --golden that's compared against a trace from an earlier run and any
+// difference, in a frame or in the poll it went out on, fails
+//
+//     replay SESSION [--golden FILE] [--golden-out FILE]
+//
+// sessions are text, one event per line, `#` starts a comment:
+//
+//     <time_us> connect <poll_phase_us>   the console plugs in and configures us
+//     <time_us> disconnect | suspend | resume
+//     <time_us> plug <idx|kit>            a controller in host slot idx, or the usb midi kit
+//     <time_us> unplug <idx|kit>
+//     <time_us> console <hex>             a frame the console sends us
+//     <time_us> controller <idx> <hex>    an IN report from the controller in slot idx
+//     <time_us> kit <hex>                 one usb midi event packet
+//     <time_us> serial <hex>              bytes onto the serial midi wire
+//
+// tools/usb_replay.py --session-out turns a usbmon capture of a console session into one. golden
+// traces are one frame per line, `<time_us> console <hex>` or `<time_us> controller <idx> <hex>`.
+//
+// what each kind of packet cost to handle, in host time, goes to stdout as well. the clock the
+// adapter sees is simulated so those are only good for comparing one build against another on the
+// same machine, and never fail anything
+
+// time left after the last event for whatever it set off
+#define SETTLE_US TIMEBASE_MS(100)
+#define MAX_TRACE_LINE 256
+
+typedef enum {
+    EVENT_CONNECT,
+    EVENT_DISCONNECT,
+    EVENT_SUSPEND,
+    EVENT_RESUME,
+    EVENT_PLUG,
+    EVENT_UNPLUG,
+    EVENT_CONSOLE,
+    EVENT_CONTROLLER,
+    EVENT_KIT,
+    EVENT_SERIAL,
+} event_e;
+
+// idx for the usb midi kit in plug/unplug
+#define KIT_IDX UINT8_MAX
+
+typedef struct {
+    timebase_us_t at;
+    event_e type;
+    uint32_t arg;  // poll phase, or controller idx
+    uint8_t len;
+    uint8_t data[64];
+} session_event_t;
+
+static session_event_t *session = NULL;
+static size_t session_len = 0;
+
+static char **trace = NULL;
+static size_t trace_len = 0;
+static size_t trace_cap = 0;
+
+//--------------------------------------------------------------------+
+// session files
+//--------------------------------------------------------------------+
+
+static void fail(const char *path, int line, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s:%d: ", path, line);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(2);
+}
+
+static int parse_hex(const char *hex, uint8_t *out, uint8_t max) {
+    int n = 0;
+    for (; hex[0]; hex += 2) {
+        if (n == max || !isxdigit((unsigned char)hex[0]) || !isxdigit((unsigned char)hex[1]))
+            return -1;
+        char byte[3] = {hex[0], hex[1], '\0'};
+        out[n++] = (uint8_t)strtoul(byte, NULL, 16);
+    }
+    return n;
+}
+
+static bool parse_slot(const char *arg, uint32_t *idx) {
+    if (!strcmp(arg, "kit")) {
+        *idx = KIT_IDX;
+        return true;
+    }
+    char *end;
+    *idx = (uint32_t)strtoul(arg, &end, 10);
+    return end != arg && !*end && *idx < XBOX_MAX_CONTROLLERS;
+}
+
+static void load_session(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        exit(2);
+    }
+
+    size_t cap = 0;
+    char line[MAX_TRACE_LINE];
+    timebase_us_t last_at = 0;
+    for (int n = 1; fgets(line, sizeof(line), f); n++) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        unsigned long long at;
+        char type[16];
+        char args[2][2 * 64 + 2];
+        int fields = sscanf(line, "%llu %15s %129s %129s", &at, type, args[0], args[1]);
+        if (fields <= 0) continue;
+        if (fields < 2) fail(path, n, "expected <time_us> <event>");
+        if (at < last_at) fail(path, n, "events have to be in time order");
+        last_at = at;
+
+        if (session_len == cap) {
+            cap = cap ? cap * 2 : 256;
+            session = realloc(session, cap * sizeof(*session));
+            if (!session) abort();
+        }
+        session_event_t *event = &session[session_len++];
+        memset(event, 0, sizeof(*event));
+        event->at = TIMEBASE_MS(1) + at;
+
+        const char *payload = fields >= 3 ? args[0] : NULL;
+        if (!strcmp(type, "connect")) {
+            event->type = EVENT_CONNECT;
+            event->arg = payload ? (uint32_t)strtoul(payload, NULL, 10) : 0;
+            continue;
+        } else if (!strcmp(type, "disconnect")) {
+            event->type = EVENT_DISCONNECT;
+            continue;
+        } else if (!strcmp(type, "suspend")) {
+            event->type = EVENT_SUSPEND;
+            continue;
+        } else if (!strcmp(type, "resume")) {
+            event->type = EVENT_RESUME;
+            continue;
+        } else if (!strcmp(type, "plug") || !strcmp(type, "unplug")) {
+            event->type = type[0] == 'p' ? EVENT_PLUG : EVENT_UNPLUG;
+            if (!payload || !parse_slot(payload, &event->arg))
+                fail(path, n, "%s needs a controller slot or kit", type);
+            continue;
+        } else if (!strcmp(type, "console")) {
+            event->type = EVENT_CONSOLE;
+        } else if (!strcmp(type, "controller")) {
+            event->type = EVENT_CONTROLLER;
+            if (!payload || !parse_slot(payload, &event->arg) || event->arg == KIT_IDX)
+                fail(path, n, "controller needs a slot");
+            payload = fields >= 4 ? args[1] : NULL;
+        } else if (!strcmp(type, "kit")) {
+            event->type = EVENT_KIT;
+        } else if (!strcmp(type, "serial")) {
+            event->type = EVENT_SERIAL;
+        } else {
+            fail(path, n, "unknown event '%s'", type);
+        }
+
+        int len = payload ? parse_hex(payload, event->data, sizeof(event->data)) : -1;
+        if (len <= 0) fail(path, n, "%s needs a payload in hex", type);
+        if (event->type == EVENT_KIT && len != 4) fail(path, n, "kit packets are 4 bytes");
+        event->len = (uint8_t)len;
+    }
+    fclose(f);
+}
+
+static void play(uintptr_t i) {
+    const session_event_t *event = &session[i];
+    switch (event->type) {
+        case EVENT_CONNECT:
+            sim_console_connect(event->arg);
+            break;
+        case EVENT_DISCONNECT:
+            sim_console_disconnect();
+            break;
+        case EVENT_SUSPEND:
+            sim_console_suspend();
+            break;
+        case EVENT_RESUME:
+            sim_console_resume();
+            break;
+        case EVENT_PLUG:
+            if (event->arg == KIT_IDX)
+                sim_kit_usb_plug();
+            else
+                sim_controller_plug((uint8_t)event->arg);
+            break;
+        case EVENT_UNPLUG:
+            if (event->arg == KIT_IDX)
+                sim_kit_usb_unplug();
+            else
+                sim_controller_unplug((uint8_t)event->arg);
+            break;
+        case EVENT_CONSOLE:
+            sim_console_send(event->data, event->len);
+            break;
+        case EVENT_CONTROLLER:
+            sim_controller_send((uint8_t)event->arg, event->data, event->len);
+            break;
+        case EVENT_KIT:
+            sim_kit_usb_send(sim_now, event->data);
+            break;
+        case EVENT_SERIAL:
+            sim_kit_serial_send(sim_now, event->data, event->len);
+            break;
+    }
+}
+
+//--------------------------------------------------------------------+
+// what comes out
+//--------------------------------------------------------------------+
+
+static void record(const char *source, const sim_frame_t *frame) {
+    char line[MAX_TRACE_LINE];
+    int n = snprintf(line, sizeof(line), "%llu %s ",
+                     (unsigned long long)(frame->at - TIMEBASE_MS(1)), source);
+    for (uint8_t i = 0; i < frame->len; i++) n += snprintf(line + n, 3, "%02x", frame->data[i]);
+
+    if (trace_len == trace_cap) {
+        trace_cap = trace_cap ? trace_cap * 2 : 256;
+        trace = realloc(trace, trace_cap * sizeof(*trace));
+        if (!trace) abort();
+    }
+    trace[trace_len++] = strdup(line);
+}
+
+static void on_console_frame(const sim_frame_t *frame) { record("console", frame); }
+
+static void on_controller_frame(uint8_t idx, const sim_frame_t *frame) {
+    char source[16];
+    snprintf(source, sizeof(source), "controller %u", idx);
+    record(source, frame);
+}
+
+//--------------------------------------------------------------------+
+// handling cost
+//--------------------------------------------------------------------+
+
+typedef struct {
+    uint32_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} cost_t;
+
+static cost_t console_costs[256];
+static cost_t controller_costs[256];
+static cost_t drum_cost;
+static uint64_t handling_since[2];
+
+static void add_cost(cost_t *cost, uint64_t ns) {
+    cost->count++;
+    cost->total_ns += ns;
+    if (ns > cost->max_ns) cost->max_ns = ns;
+}
+
+static void on_trace(trace_event_e event, uint32_t arg0, uint32_t arg1) {
+    (void)arg1;
+    switch (event) {
+        case TRACE_XBOXD_RX:
+        case TRACE_XBOXH_RX:
+            handling_since[event == TRACE_XBOXH_RX] = sim_host_ns();
+            break;
+        case TRACE_XBOXD_HANDLED:
+            add_cost(&console_costs[arg0 & 0xff], sim_host_ns() - handling_since[0]);
+            break;
+        case TRACE_XBOXH_HANDLED:
+            add_cost(&controller_costs[arg0 & 0xff], sim_host_ns() - handling_since[1]);
+            break;
+        default:
+            break;
+    }
+}
+
+// drum_task runs on its own pass whenever the kit has something, the rest rides along with it
+static void on_pass(uint32_t tasks, uint64_t host_ns) {
+    if (tasks & TASK_BIT(TASK_DRUM)) add_cost(&drum_cost, host_ns);
+}
+
+static void print_cost(const char *source, const char *name, const cost_t *cost) {
+    printf("%-10s %-10s %6u %9.0f %9llu\n", source, name, (unsigned)cost->count,
+           (double)cost->total_ns / cost->count, (unsigned long long)cost->max_ns);
+}
+
+static void print_costs() {
+    printf("%-10s %-10s %6s %9s %9s  (host ns)\n", "from", "packet", "count", "mean", "max");
+    char name[8];
+    for (int command = 0; command < 256; command++) {
+        if (!console_costs[command].count) continue;
+        snprintf(name, sizeof(name), "0x%02x", command);
+        print_cost("console", name, &console_costs[command]);
+    }
+    for (int command = 0; command < 256; command++) {
+        if (!controller_costs[command].count) continue;
+        snprintf(name, sizeof(name), "0x%02x", command);
+        print_cost("controller", name, &controller_costs[command]);
+    }
+    if (drum_cost.count) print_cost("kit", "drum_task", &drum_cost);
+}
+
+//--------------------------------------------------------------------+
+// golden traces
+//--------------------------------------------------------------------+
+
+static void mismatch(int n, size_t i, const char *want, const char *got) {
+    if (n >= 10) return;
+    printf("#%zu: want %s\n", i, want);
+    printf("#%zu: got  %s\n", i, got);
+}
+
+// how many lines differ, -1 if the golden trace couldn't be read
+static int compare(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int mismatches = 0;
+    size_t i = 0;
+    char line[MAX_TRACE_LINE];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[0] || line[0] == '#') continue;
+        const char *got = i < trace_len ? trace[i] : "--";
+        if (strcmp(line, got)) mismatch(mismatches++, i, line, got);
+        i++;
+    }
+    fclose(f);
+    for (; i < trace_len; i++) mismatch(mismatches++, i, "--", trace[i]);
+    return mismatches;
+}
+
+static bool write_golden(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+    for (size_t i = 0; i < trace_len; i++) fprintf(f, "%s\n", trace[i]);
+    return fclose(f) == 0;
+}
+
+int main(int argc, char **argv) {
+    const char *session_path = NULL;
+    const char *golden = NULL;
+    const char *golden_out = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--golden") && i + 1 < argc) {
+            golden = argv[++i];
+        } else if (!strcmp(argv[i], "--golden-out") && i + 1 < argc) {
+            golden_out = argv[++i];
+        } else if (argv[i][0] != '-' && !session_path) {
+            session_path = argv[i];
+        } else {
+            session_path = NULL;
+            break;
+        }
+    }
+    if (!session_path) {
+        fprintf(stderr, "usage: %s SESSION [--golden FILE] [--golden-out FILE]\n", argv[0]);
+        return 2;
+    }
+
+    load_session(session_path);
+    if (!session_len) {
+        fprintf(stderr, "%s: nothing to replay\n", session_path);
+        return 2;
+    }
+
+    sim_init();
+    sim_console_set_hook(on_console_frame);
+    sim_controller_set_hook(on_controller_frame);
+    sim_set_trace_hook(on_trace);
+    sim_set_pass_hook(on_pass);
+    for (size_t i = 0; i < session_len; i++) sim_at(session[i].at, play, i);
+    sim_run_until(session[session_len - 1].at + SETTLE_US);
+
+    print_costs();
+    printf("%zu session events, %zu frames out\n", session_len, trace_len);
+
+    if (golden_out && !write_golden(golden_out)) return 2;
+    if (!golden) return 0;
+
+    int mismatches = compare(golden);
+    if (mismatches < 0) return 2;
+    if (mismatches) printf("%d frames differ from %s\n", mismatches, golden);
+    return mismatches ? 1 : 0;
+}
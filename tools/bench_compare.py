@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Compare two runs of the on-device benchmark image (cmake -DOPENRB_BENCH=ON), or of its native
+build against the host (build-host/bench, see test/bench.c).
+
+Capture the debug uart of each run to a file, e.g.
+
+    stty -F /dev/ttyUSB0 115200 raw && cat /dev/ttyUSB0 > v1.2.jsonl
+
+then compare them. Exits non-zero if any bench's mean got slower by more than --threshold.
+
+    ./bench_compare.py v1.2.jsonl v1.3.jsonl
+
+Every bench runs once with a warm xip cache, once flushed before each sample ("name (cold)") and
+once with core 1 busy on its own state ("name (contended)"). That's a synthetic loop copying a
+report's worth of words around wherever core 1's state is placed, not the usb host stack.
+Comparing a default image against one built with -DOPENRB_RAM_HOT_PATH=ON shows what running the
+hot path from sram buys, the xip column is the cache hit rate of each run. Building with
+-DOPENRB_SCRATCH_BANKS=OFF and comparing the contended rows shows what keeping core 1's own state
+in its scratch bank does to the jitter column (max - min cycles).
+
+Native runs are marked "name (native)" and count host nanoseconds instead of cycles, so they only
+line up with other native runs on the same machine:
+
+    build-host/bench > before.jsonl
+    ./bench_compare.py before.jsonl after.jsonl
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            try:
+                record = json.loads(line)
+            except json.JSONDecodeError:
+                continue
+            if "bench" in record:
+                name = record["bench"]
+                if record.get("cold"):
+                    name += " (cold)"
+                if record.get("contended"):
+                    name += " (contended)"
+                if record.get("native"):
+                    name += " (native)"
+                results[name] = record
+    return results
+
+
+def jitter_of(record):
+    if "jitter_cycles" in record:
+        return str(record["jitter_cycles"])
+    return str(record["max_cycles"] - record["min_cycles"])
+
+
+def hit_rate(record):
+    if "xip_hit_permille" not in record:
+        return "-"
+    return f"{record['xip_hit_permille'] / 10:.1f}%"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=5.0, metavar="PERCENT")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    candidate = load(args.candidate)
+    regressions = 0
+
+    print(f"{'bench':<44} {'base':>8} {'new':>8} {'change':>8} {'jitter':>11} {'xip':>13}"
+          "  (mean cycles)")
+    for name in sorted(baseline.keys() | candidate.keys()):
+        if name not in baseline or name not in candidate:
+            print(f"{name:<44} {'only in ' + ('baseline' if name in baseline else 'candidate')}")
+            continue
+        old = baseline[name]["mean_cycles"]
+        new = candidate[name]["mean_cycles"]
+        change = (new - old) * 100 / old if old else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSED"
+            regressions += 1
+        jitter = f"{jitter_of(baseline[name])}/{jitter_of(candidate[name])}"
+        xip = f"{hit_rate(baseline[name])}/{hit_rate(candidate[name])}"
+        print(f"{name:<44} {old:>8} {new:>8} {change:>+7.1f}% {jitter:>11} {xip:>13}{flag}")
+
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+"""Replay Standard MIDI File drum charts through the drum engine and score the result.
+
+Every note on in the chart is played into test/drum_replay, src/drums.c built for the host with
+the rest of the adapter around it and a simulated console polling it (see test/host/sim.h). So
+the velocity threshold, midi map, crosstalk masking, kick lane spill, hold, report coalescing and
+ON_DELAY_MS are the firmware's own, from the tree the host build was made from. To see what a
+change to any of them does to a chart, change inc/ or src/drums.c and rebuild it:
+
+    cmake -S test -B build-host && cmake --build build-host
+    ./chart_replay.py charts/*.mid
+    ./chart_replay.py --rb expert charts/*.mid --json
+    ./chart_replay.py --fast-poll charts/*.mid    # an OPENRB_FAST_POLL build the console took
+
+Each hit ends up as one of:
+
+  delivered      the console saw a new press on that lane, latency is chart time to the poll
+                 that collected it (the serial wire time is included with --transport serial)
+  merged_hold    dropped by the engine, its output was still held from an earlier hit
+  merged_report  accepted, but the console never saw the lane go up again - the release and the
+                 re-trigger landed between the same two reports
+  crosstalk      masked as bleed from a louder hit on a neighbouring pad
+  threshold      at or below VELOCITY_THRESH
+  unmapped       not in the midi map
+
+Per pad results are grouped by the lane inc/default_midi_mapping.tbl gives each note. General
+MIDI drum tracks go in as they are. Rock Band charts (a PART DRUMS track of gems) need --rb with a
+difficulty, their gems are turned into the notes the default map expects first.
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import struct
+import subprocess
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+INC = os.path.join(ROOT, "inc")
+
+OUTPUTS = ["KICK", "DOUBLE_KICK", "PAD_RED", "PAD_YELLOW", "PAD_BLUE", "PAD_GREEN", "CYM_YELLOW",
+           "CYM_BLUE", "CYM_GREEN"]
+
+# rock band gems to notes in the default map, cymbal unless the lane's tom marker is held
+RB_DIFFICULTY_BASE = {"easy": 60, "medium": 72, "hard": 84, "expert": 96}
+RB_KICK_2X = 95
+RB_TOM_MARKERS = {110: 2, 111: 3, 112: 4}  # marker note -> gem lane
+RB_LANE_NOTES = {0: 36, 1: 38, 2: (42, 48), 3: (51, 45), 4: (49, 43)}  # lane -> note/(cym, tom)
+
+OUTCOMES = ["delivered", "merged_hold", "merged_report", "crosstalk", "threshold", "unmapped"]
+
+
+def read_midi_map(path):
+    with open(path) as f:
+        text = f.read()
+    return {int(note): OUTPUTS.index(out)
+            for note, out in re.findall(r"^MIDI_MAP\((\d+),\s*OUT_(\w+)\)", text, re.M)}
+
+
+def read_smf(path):
+    """Returns [(track name, [(tick, status, data1, data2)])], ticks per beat and the tempo map."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"MThd":
+        sys.exit(f"{path}: not a standard midi file")
+    header_len, _, n_tracks, division = struct.unpack(">IHHH", data[4:14])
+    if division & 0x8000:
+        sys.exit(f"{path}: smpte time division isn't supported")
+
+    tracks, tempos = [], [(0, 500000)]
+    pos = 8 + header_len
+    for _ in range(n_tracks):
+        chunk, length = struct.unpack(">4sI", data[pos:pos + 8])
+        pos += 8
+        end = pos + length
+        if chunk != b"MTrk":
+            pos = end
+            continue
+
+        name, events, tick, status = "", [], 0, 0
+        while pos < end:
+            delta = 0
+            while True:
+                byte = data[pos]
+                pos += 1
+                delta = (delta << 7) | (byte & 0x7F)
+                if not byte & 0x80:
+                    break
+            tick += delta
+
+            if data[pos] & 0x80:
+                status = data[pos]
+                pos += 1
+            if status == 0xFF:
+                kind, length = data[pos], data[pos + 1]
+                pos += 2
+                if kind == 0x03:
+                    name = data[pos:pos + length].decode("latin-1")
+                elif kind == 0x51:
+                    tempos.append((tick, int.from_bytes(data[pos:pos + 3], "big")))
+                pos += length
+            elif status in (0xF0, 0xF7):
+                length = 0
+                while True:
+                    byte = data[pos]
+                    pos += 1
+                    length = (length << 7) | (byte & 0x7F)
+                    if not byte & 0x80:
+                        break
+                pos += length
+            elif status & 0xF0 in (0xC0, 0xD0):
+                events.append((tick, status, data[pos], 0))
+                pos += 1
+            else:
+                events.append((tick, status, data[pos], data[pos + 1]))
+                pos += 2
+        tracks.append((name, events))
+        pos = end
+
+    return tracks, division, sorted(tempos)
+
+
+def tick_to_us(tempos, division):
+    def convert(tick):
+        us, last_tick, tempo = 0.0, 0, tempos[0][1]
+        for at, next_tempo in tempos:
+            if at > tick:
+                break
+            us += (at - last_tick) * tempo / division
+            last_tick, tempo = at, next_tempo
+        return int(us + (tick - last_tick) * tempo / division)
+    return convert
+
+
+def chart_hits(path, channel, rb, velocity):
+    """(time_us, note, velocity) for every note on the chart plays, in order."""
+    tracks, division, tempos = read_smf(path)
+    to_us = tick_to_us(tempos, division)
+    hits = []
+
+    if rb:
+        drums = [events for name, events in tracks if name == "PART DRUMS"]
+        if not drums:
+            sys.exit(f"{path}: no PART DRUMS track")
+        base = RB_DIFFICULTY_BASE[rb]
+        toms = set()
+        for tick, status, note, vel in sorted(drums[0], key=lambda e: (e[0], e[2] < 110)):
+            on = status & 0xF0 == 0x90 and vel > 0
+            if note in RB_TOM_MARKERS:
+                (toms.add if on else toms.discard)(RB_TOM_MARKERS[note])
+                continue
+            if not on:
+                continue
+            if note == RB_KICK_2X and rb == "expert":
+                hits.append((to_us(tick), 35, velocity))
+            elif base <= note < base + 5:
+                lane = note - base
+                mapped = RB_LANE_NOTES[lane]
+                if isinstance(mapped, tuple):
+                    mapped = mapped[1] if lane in toms else mapped[0]
+                hits.append((to_us(tick), mapped, velocity))
+        return hits
+
+    for _, events in tracks:
+        for tick, status, note, vel in events:
+            if status & 0xF0 != 0x90 or vel == 0:
+                continue
+            if channel is not None and status & 0x0F != channel:
+                continue
+            hits.append((to_us(tick), note, vel))
+    return sorted(hits)
+
+
+def replay(binary, hits, transport, phase_us):
+    """Plays the hits into drum_replay, returns its config and (outcome, latency_us) per hit."""
+    text = "".join(f"{at} {note} {velocity}\n" for at, note, velocity in hits)
+    proc = subprocess.run([binary, "--transport", transport, "--poll-phase", str(phase_us)],
+                          input=text, capture_output=True, text=True)
+    if proc.returncode:
+        sys.exit(f"{binary}: {proc.stderr.strip() or 'exited ' + str(proc.returncode)}")
+
+    config, results = {}, []
+    for line in proc.stdout.splitlines():
+        fields = line.split()
+        if fields[0] == "config":
+            config = {key: int(value) for key, value in zip(fields[1::2], fields[2::2])}
+        elif fields[0] == "hit":
+            results.append((fields[2], None if fields[3] == "-" else int(fields[3])))
+    if len(results) != len(hits):
+        sys.exit(f"{binary}: {len(results)} outcomes for {len(hits)} hits")
+    return config, results
+
+
+def score(path, args, binary, midi_map, rng):
+    hits = chart_hits(path, args.channel, args.rb, args.velocity)
+    config, results = replay(binary, hits, args.transport, rng.randrange(1000000))
+
+    latency = {out: [] for out in range(len(OUTPUTS))}
+    per_pad = {out: {name: 0 for name in OUTCOMES} for out in range(len(OUTPUTS))}
+    totals = {name: 0 for name in OUTCOMES}
+    for (_, note, _), (result, latency_us) in zip(hits, results):
+        totals[result] += 1
+        out = midi_map.get(note)
+        if out is None:
+            continue
+        per_pad[out][result] += 1
+        if latency_us is not None:
+            latency[out].append(latency_us)
+
+    return config, {
+        "chart": os.path.basename(path),
+        "hits": len(hits),
+        "reports": config.pop("reports"),
+        "poll_phase_us": config.pop("poll_phase_us"),
+        "outcomes": totals,
+        "latency_us": summarize([us for values in latency.values() for us in values]),
+        "pads": {OUTPUTS[out]: {"outcomes": per_pad[out], "latency_us": summarize(latency[out])}
+                 for out in range(len(OUTPUTS)) if any(per_pad[out].values())},
+    }
+
+
+def summarize(values):
+    if not values:
+        return None
+    values = sorted(values)
+    return {
+        "p50": values[(len(values) - 1) // 2],
+        "p99": values[len(values) - 1 - len(values) // 100],
+        "max": values[-1],
+    }
+
+
+def percent(part, whole):
+    return 100 * part / whole if whole else 0
+
+
+def print_result(result):
+    total, outcomes = result["hits"], result["outcomes"]
+    print(f"{result['chart']}: {total} hits, {result['reports']} reports")
+    print("  " + "  ".join(f"{name} {percent(outcomes[name], total):.2f}%" for name in OUTCOMES
+                           if outcomes[name] or name == "delivered"))
+    print(f"  {'pad':<12} {'hits':>6} {'deliv%':>7} {'merged':>7} {'p50ms':>7} {'p99ms':>7} "
+          f"{'maxms':>7}")
+    for pad, stats in result["pads"].items():
+        pad_total = sum(stats["outcomes"].values())
+        merged = stats["outcomes"]["merged_hold"] + stats["outcomes"]["merged_report"]
+        latency = stats["latency_us"] or {"p50": 0, "p99": 0, "max": 0}
+        print(f"  {pad:<12} {pad_total:>6} "
+              f"{percent(stats['outcomes']['delivered'], pad_total):>7.2f} {merged:>7} "
+              f"{latency['p50'] / 1000:>7.2f} {latency['p99'] / 1000:>7.2f} "
+              f"{latency['max'] / 1000:>7.2f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("charts", nargs="+", help=".mid files")
+    parser.add_argument("--build", default=os.path.join(ROOT, "build-host"),
+                        help="host build with test/drum_replay in it (default build-host)")
+    parser.add_argument("--channel", type=int, default=None,
+                        help="only take notes on this channel (0-15), e.g. 9 for GM drums")
+    parser.add_argument("--rb", choices=list(RB_DIFFICULTY_BASE),
+                        help="treat the charts as rock band PART DRUMS at this difficulty")
+    parser.add_argument("--velocity", type=int, default=100,
+                        help="velocity for --rb gems (default 100)")
+    parser.add_argument("--transport", choices=["serial", "usb"], default="serial",
+                        help="how the kit reaches the adapter (default serial)")
+    parser.add_argument("--fast-poll", action="store_true",
+                        help="the OPENRB_FAST_POLL build, polled at ADAPTER_FAST_INTERVAL")
+    parser.add_argument("--seed", type=int, default=0,
+                        help="seeds the console's poll phase against the chart")
+    parser.add_argument("--json", action="store_true", help="print one json object per chart")
+    args = parser.parse_args()
+
+    binary = os.path.join(args.build, "drum_replay_fast_poll" if args.fast_poll else "drum_replay")
+    if not os.access(binary, os.X_OK):
+        sys.exit(f"{binary} isn't built - cmake -S test -B {args.build} && "
+                 f"cmake --build {args.build}")
+    midi_map = read_midi_map(os.path.join(INC, "default_midi_mapping.tbl"))
+    rng = random.Random(args.seed)
+
+    for path in args.charts:
+        config, result = score(path, args, binary, midi_map, rng)
+        if args.json:
+            print(json.dumps({"config": config, **result}))
+        else:
+            print_result(result)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""Stand in for the console and drive an adapter through its handshake from a Linux host.
+
+Plays the console's side of STATE_INIT -> STATE_IDENTIFYING -> STATE_AUTHENTICATING ->
+STATE_RUNNING against the adapter's device port:
+
+  announce  wait for the adapter's CMD_ANNOUNCE
+  identify  send CMD_IDENTIFY, then ack each identify chunk until the sequence starts over
+  auth      send the frames from --auth-script (hex, one per line, as captured from a console)
+            and time each forwarded controller reply, then send the "authenticated" frame
+  running   wait for the instrument notifications, then time a CMD_LIST_CONNECTED_INSTRUMENTS
+
+The adapter still needs a real controller on its host port - it won't announce without one, and
+that controller answers the auth frames. Nothing checks the auth replies, so any capture works.
+
+Prints per-phase timings and round trips, --json prints the same as one object for CI to track.
+
+Needs pyusb (libusb) and access to the device, e.g. run as root or add a udev rule for 0e6f:0175.
+The adapter should be freshly plugged in (or reset) so it's sitting in STATE_INIT.
+
+test/handshake.c plays the same console against a host build of src/adapter.c with simulated
+controllers, and fails ctest if any round trip takes more polls than it should.
+"""
+
+import argparse
+import json
+import statistics
+import sys
+import time
+
+import usb.core
+import usb.util
+
+USB_VID = 0x0E6F
+USB_PID = 0x0175
+
+CMD_ACKNOWLEDGE = 0x01
+CMD_ANNOUNCE = 0x02
+CMD_IDENTIFY = 0x04
+CMD_AUTHENTICATE = 0x06
+CMD_ADD_PLAYER = 0x22
+CMD_LIST_CONNECTED_INSTRUMENTS = 0x24
+
+# frame_t byte 1 is deviceId in the low nibble, type in the high one
+TYPE_COMMAND = 0x00
+TYPE_REQUEST = 0x20
+
+# handle_auth moves to STATE_RUNNING on this exact frame
+AUTH_DONE_PAYLOAD = bytes([0x01, 0x00])
+
+
+def find_endpoint(itf, direction):
+    return usb.util.find_descriptor(
+        itf, custom_match=lambda ep: usb.util.endpoint_direction(ep.bEndpointAddress) == direction)
+
+
+class Adapter:
+    def __init__(self, timeout_ms):
+        self.dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+        if self.dev is None:
+            sys.exit("adapter not found")
+        if self.dev.is_kernel_driver_active(0):
+            self.dev.detach_kernel_driver(0)
+        self.dev.set_configuration()
+        itf = self.dev.get_active_configuration()[(0, 0)]
+        self.ep_in = find_endpoint(itf, usb.util.ENDPOINT_IN)
+        self.ep_out = find_endpoint(itf, usb.util.ENDPOINT_OUT)
+        self.timeout_ms = timeout_ms
+        self.sequence = 0
+
+    def send(self, command, payload=b"", frame_type=TYPE_REQUEST):
+        self.sequence = (self.sequence + 1) & 0xFF
+        frame = bytes([command, frame_type, self.sequence, len(payload)]) + payload
+        self.send_raw(frame)
+        return time.perf_counter()
+
+    def send_raw(self, frame):
+        self.ep_out.write(frame, self.timeout_ms)
+
+    # returns (arrival time, packet) or (None, None) once timeout_ms passes without a packet
+    def receive(self, timeout_ms=None):
+        try:
+            data = bytes(self.ep_in.read(64, timeout_ms or self.timeout_ms))
+        except usb.core.USBTimeoutError:
+            return None, None
+        return time.perf_counter(), data
+
+    # skips anything that isn't one of commands, e.g. stray announces
+    def wait_for(self, commands, timeout_ms=None):
+        deadline = time.perf_counter() + (timeout_ms or self.timeout_ms) / 1000
+        while time.perf_counter() < deadline:
+            remaining = max(1, int((deadline - time.perf_counter()) * 1000))
+            at, data = self.receive(remaining)
+            if data and data[0] in commands:
+                return at, data
+        return None, None
+
+
+def summarize(round_trips):
+    if not round_trips:
+        return {"count": 0}
+    ms = [rt * 1000 for rt in round_trips]
+    return {"count": len(ms), "min_ms": min(ms), "median_ms": statistics.median(ms),
+            "max_ms": max(ms)}
+
+
+def identify(adapter, max_chunks):
+    round_trips = []
+    sent_at = adapter.send(CMD_IDENTIFY)
+    first = None
+    for _ in range(max_chunks):
+        at, data = adapter.wait_for((CMD_IDENTIFY,))
+        if data is None:
+            sys.exit("no identify reply")
+        # the adapter starts the sequence over once it's out of chunks, sequence byte aside
+        chunk = data[:2] + data[3:]
+        if first is None:
+            first = chunk
+        elif chunk == first:
+            break
+        round_trips.append(at - sent_at)
+        # the adapter only looks at the command, this is the shape a console acks with
+        ack = bytes([0x00, data[0], data[1], data[3], 0x00, 0x00, 0x00, 0x00, 0x00])
+        sent_at = adapter.send(CMD_ACKNOWLEDGE, ack)
+    return round_trips
+
+
+def authenticate(adapter, script, reply_timeout_ms):
+    round_trips = []
+    for frame in script:
+        sent_at = time.perf_counter()
+        adapter.send_raw(frame)
+        at, _ = adapter.wait_for((CMD_AUTHENTICATE,), reply_timeout_ms)
+        if at is not None:
+            round_trips.append(at - sent_at)
+    return round_trips
+
+
+def load_script(path):
+    if not path:
+        return []
+    with open(path) as f:
+        return [bytes.fromhex(line.split("#")[0]) for line in f if line.split("#")[0].strip()]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--auth-script", help="hex frames to send while authenticating")
+    parser.add_argument("--timeout", type=int, default=5000, metavar="MS",
+                        help="how long to wait on each phase")
+    parser.add_argument("--reply-timeout", type=int, default=200, metavar="MS",
+                        help="how long to wait for the controller to answer an auth frame")
+    parser.add_argument("--max-identify-chunks", type=int, default=32)
+    parser.add_argument("--json", action="store_true")
+    args = parser.parse_args()
+
+    script = load_script(args.auth_script)
+    adapter = Adapter(args.timeout)
+    results = {}
+
+    start = time.perf_counter()
+    announced_at, _ = adapter.wait_for((CMD_ANNOUNCE,))
+    if announced_at is None:
+        sys.exit("no announce, is a controller plugged into the adapter?")
+    results["announce_wait_ms"] = (announced_at - start) * 1000
+
+    identify_start = time.perf_counter()
+    results["identify"] = summarize(identify(adapter, args.max_identify_chunks))
+    results["identify_ms"] = (time.perf_counter() - identify_start) * 1000
+
+    auth_start = time.perf_counter()
+    results["auth"] = summarize(authenticate(adapter, script, args.reply_timeout))
+    done_at = adapter.send(CMD_AUTHENTICATE, AUTH_DONE_PAYLOAD, TYPE_COMMAND)
+    running_at, _ = adapter.wait_for((CMD_ADD_PLAYER,))
+    if running_at is None:
+        sys.exit("adapter never reported its instruments")
+    results["auth_ms"] = (done_at - auth_start) * 1000
+    results["auth_done_to_instruments_ms"] = (running_at - done_at) * 1000
+    results["time_to_running_ms"] = (running_at - announced_at) * 1000
+
+    list_sent_at = adapter.send(CMD_LIST_CONNECTED_INSTRUMENTS)
+    listed_at, _ = adapter.wait_for((CMD_ADD_PLAYER,))
+    results["list_instruments_ms"] = (listed_at - list_sent_at) * 1000 if listed_at else None
+
+    if args.json:
+        print(json.dumps(results))
+        return
+    for name, value in results.items():
+        if isinstance(value, dict):
+            print(f"{name:<28} " + " ".join(
+                f"{k}={v:.2f}" if isinstance(v, float) else f"{k}={v}" for k, v in value.items()))
+        elif value is None:
+            print(f"{name:<28} --")
+        else:
+            print(f"{name:<28} {value:.2f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Check hit-to-report latency and dropped hits against budgets on a running adapter.
+
+Drives the on-device hit generator (inc/loadgen.h) with a fixed pattern for a while, then reads
+the stats block and fails if the latency percentiles or the share of generated hits that never
+made it into a sent report are over budget. Meant for a bench rig with an adapter authenticated
+against a console, as a gate before a release:
+
+    ./latency_check.py --seconds 30 --p99-ms 28 --max-drop 0
+
+Latency is measured on the adapter from the first hit a drum report carries to that report
+completing on the IN endpoint. The firmware's own budget (HIT_LATENCY_BUDGET_US) is used for
+--p99-ms when it isn't given.
+
+test/latency.c is the build-time half of this check: it plays the same pattern, grooves and
+bursts through a host build of the adapter against the same budgets, under ctest.
+
+Needs pyusb (libusb) and access to the device, e.g. run as root or add a udev rule for 0e6f:0175.
+"""
+
+import argparse
+import sys
+import time
+
+import usb.core
+
+from openrb_loadgen import configure
+from openrb_stats import STATES, USB_PID, USB_VID, read_stats
+
+# kick, snare and a cymbal, well inside the hold window on every pad, so nothing should drop
+DEFAULT_PADS = [(36, 120), (38, 90), (42, 60)]
+
+
+def pad(spec):
+    note, _, interval = spec.partition(":")
+    return int(note), int(interval)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("pads", nargs="*", type=pad, metavar="NOTE:INTERVAL_MS",
+                        help="pattern to play, a kick/snare/hat groove if omitted")
+    parser.add_argument("--mode", choices=["pattern", "random"], default="pattern")
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--p50-ms", type=float)
+    parser.add_argument("--p99-ms", type=float)
+    parser.add_argument("--max-ms", type=float)
+    parser.add_argument("--max-drop", type=float, default=0, metavar="PERCENT",
+                        help="generated hits allowed to miss a sent report")
+    args = parser.parse_args()
+
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        sys.exit("adapter not found")
+    state = read_stats(dev)["state"]
+    if STATES[state] != "RUNNING":
+        sys.exit(f"adapter is in {STATES[state]}, it has to be authenticated with a console")
+
+    configure(dev, args.mode, args.pads or DEFAULT_PADS)
+    try:
+        time.sleep(args.seconds)
+    finally:
+        configure(dev, "off", [])
+    # let the last reports go out before counting
+    time.sleep(0.2)
+    stats = read_stats(dev)
+
+    latency = stats["hit_latency"]
+    loadgen = stats["loadgen"]
+    if not latency["count"] or not loadgen["generated"]:
+        sys.exit("no generated hits were reported, is the console polling?")
+
+    p99_budget_ms = args.p99_ms if args.p99_ms is not None else latency["budget_us"] / 1000
+    dropped = 100 * (1 - loadgen["reported"] / loadgen["generated"])
+    checks = [
+        ("p50", latency["p50_us"] / 1000, args.p50_ms),
+        ("p99", latency["p99_us"] / 1000, p99_budget_ms),
+        ("max", latency["max_us"] / 1000, args.max_ms),
+        ("dropped %", dropped, args.max_drop),
+    ]
+
+    failed = False
+    print(f"{loadgen['generated']} hits generated, {loadgen['reported']} reported, "
+          f"{latency['count']} reports timed")
+    for name, value, budget in checks:
+        over = budget is not None and value > budget
+        failed |= over
+        limit = f"{budget:.2f}" if budget is not None else "--"
+        print(f"{name:<10} {value:8.2f}  budget {limit:>8}{'  OVER' if over else ''}")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
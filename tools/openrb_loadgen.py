@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Start or stop the adapter's synthetic hit generator (inc/loadgen.h) over its vendor request.
+
+Generated hits go through the same note on path as a real kit, so the hold window, the report
+coalescing and the fifo all apply. openrb_stats.py shows how many of them reached a sent report,
+and tools/trace_decode.py marks each one as LOADGEN_HIT for latency measurements.
+
+Pads are given as NOTE:INTERVAL_MS, e.g. "36:8 38:50" drives the kick every 8ms and the red pad
+every 50ms.
+
+Needs pyusb (libusb) and access to the device, e.g. run as root or add a udev rule for 0e6f:0175.
+"""
+
+import argparse
+import struct
+import sys
+
+import usb.core
+
+USB_VID = 0x0E6F
+USB_PID = 0x0175
+
+LOADGEN_VENDOR_REQUEST = 0xA1
+LOADGEN_PADS = 8
+MODES = ["off", "pattern", "random"]
+
+# keep in sync with loadgen_config_t in inc/loadgen.h
+CONFIG = struct.Struct("<BBBBH%dH%dB" % (LOADGEN_PADS, LOADGEN_PADS))
+
+
+def pad(spec):
+    note, _, interval = spec.partition(":")
+    try:
+        return int(note), int(interval or 0)
+    except ValueError:
+        raise argparse.ArgumentTypeError(f"expected NOTE:INTERVAL_MS, got {spec!r}")
+
+
+def configure(dev, mode, pads, velocity=100, burst=0, gap_ms=0, controller_ms=0):
+    if len(pads) > LOADGEN_PADS:
+        sys.exit(f"at most {LOADGEN_PADS} pads")
+    pads = list(pads) + [(0, 0)] * (LOADGEN_PADS - len(pads))
+    data = CONFIG.pack(MODES.index(mode), velocity, burst, controller_ms, gap_ms,
+                       *(interval for _, interval in pads), *(note for note, _ in pads))
+    # bmRequestType: OUT | vendor | device
+    dev.ctrl_transfer(0x40, LOADGEN_VENDOR_REQUEST, 0, 0, data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("mode", choices=MODES)
+    parser.add_argument("pads", nargs="*", type=pad, metavar="NOTE:INTERVAL_MS")
+    parser.add_argument("--velocity", type=int, default=100)
+    parser.add_argument("--burst", type=int, default=0, metavar="HITS",
+                        help="hits per pad before each pause")
+    parser.add_argument("--gap", type=int, default=0, metavar="MS", help="pause between bursts")
+    parser.add_argument("--controller", type=int, default=0, metavar="MS",
+                        help="mix in a synthetic controller report this often")
+    args = parser.parse_args()
+
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        sys.exit("adapter not found")
+    configure(dev, args.mode, args.pads, args.velocity, args.burst, args.gap, args.controller)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Read the adapter's per-boot telemetry records (inc/persist.h) over its vendor control request.
+
+Index 0 is the running boot's live record, the rest come out of the flash log newest first. Each
+record says why its boot started, so a crash shows up as the record before a FAULT, WATCHDOG or
+REBOOT - that record carries the fault pc and the counters as they were when it went down.
+
+Needs pyusb (libusb) and access to the device, e.g. run as root or add a udev rule for 0e6f:0175.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+import usb.core
+
+USB_VID = 0x0E6F
+USB_PID = 0x0175
+
+PERSIST_VENDOR_REQUEST = 0xA2
+
+# keep in sync with persist_record_t in inc/persist.h
+HEADER = struct.Struct("<IHH")  # magic, version, size
+# the fields between the header and crc, each run with the version that added it. crc is always
+# the record's last four bytes, so whatever a newer version adds sits between these and it
+SECTIONS = [
+    (1, struct.Struct("<3I4B10I2IB3x"), [
+        "sequence", "boot", "uptime_ms", "reset_reason", "recovery", "adapter_state",
+        "fifo_high_water", "fifo_write_failures", "control_dropped", "host_restarts",
+        "device_recoveries", "hits_accepted", "hit_latency_count", "hit_latency_p50_us",
+        "hit_latency_p99_us", "hit_latency_max_us", "hit_latency_over_budget", "fault_pc",
+        "fault_lr", "fault_core",
+    ]),
+]
+RESET_REASONS = ["POWER_ON", "RUN_PIN", "DEBUGGER", "WATCHDOG", "REBOOT", "FAULT"]
+RECOVERIES = ["NONE", "HOST_STALL", "DEVICE_STALL", "WATCHDOG"]
+STATES = ["NONE", "INIT", "IDENTIFYING", "AUTHENTICATING", "RUNNING", "POWER_OFF"]
+
+
+def lookup(table, index):
+    return table[index] if index < len(table) else str(index)
+
+
+def read_record(dev, index):
+    try:
+        # bmRequestType: IN | vendor | device, the adapter stalls past the end of the log
+        data = bytes(dev.ctrl_transfer(0xC0, PERSIST_VENDOR_REQUEST, 0, index, 256))
+    except usb.core.USBError:
+        return None
+    if len(data) < HEADER.size:
+        sys.exit(f"short record ({len(data)} bytes)")
+    _, version, size = HEADER.unpack_from(data)
+    if version < 1:
+        sys.exit(f"unsupported record version {version}")
+    # anything newer than this tool knows is read as far as it knows, the rest is skipped
+    end = min(size, len(data)) - 4
+
+    record = {"version": version}
+    offset = HEADER.size
+    for introduced, section, names in SECTIONS:
+        if version < introduced:
+            break
+        if offset + section.size > end:
+            sys.exit(f"short record ({len(data)} bytes)")
+        record.update(zip(names, section.unpack_from(data, offset)))
+        offset += section.size
+    return record
+
+
+def print_record(index, record):
+    label = "live" if index == 0 else f"log -{index}"
+    print(f"[{label}] boot {record['boot']}, started by "
+          f"{lookup(RESET_REASONS, record['reset_reason'])}"
+          + (f" ({lookup(RECOVERIES, record['recovery'])})" if record["recovery"] else "")
+          + f", up {record['uptime_ms'] / 1000:.1f}s, "
+          f"last {lookup(STATES, record['adapter_state'])}")
+    if record["fault_pc"]:
+        print(f"  hard fault on core {record['fault_core']} at pc 0x{record['fault_pc']:08x} "
+              f"lr 0x{record['fault_lr']:08x}")
+    print(f"  hits {record['hits_accepted']}, fifo failures {record['fifo_write_failures']} "
+          f"(high water {record['fifo_high_water']}), control dropped "
+          f"{record['control_dropped']}, host restarts {record['host_restarts']}, "
+          f"device recoveries {record['device_recoveries']}")
+    if record["hit_latency_count"]:
+        print(f"  hit latency p50 {record['hit_latency_p50_us'] / 1000:.2f}ms "
+              f"p99 {record['hit_latency_p99_us'] / 1000:.2f}ms "
+              f"max {record['hit_latency_max_us'] / 1000:.2f}ms, "
+              f"{record['hit_latency_over_budget']} of {record['hit_latency_count']} over budget")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--count", type=int, default=16,
+                        help="how many records to read, newest first (default 16)")
+    parser.add_argument("--json", action="store_true", help="print one json object per record")
+    args = parser.parse_args()
+
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        sys.exit("adapter not found")
+
+    for index in range(args.count):
+        record = read_record(dev, index)
+        if record is None:
+            break
+        if args.json:
+            print(json.dumps({"index": index, **record}))
+        else:
+            print_record(index, record)
+
+
+if __name__ == "__main__":
+    main()
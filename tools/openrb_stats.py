@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Read the runtime stats block (inc/stats.h) from an adapter over its vendor control request.
+
+Needs pyusb (libusb) and access to the device, e.g. run as root or add a udev rule for 0e6f:0175.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import usb.core
+
+USB_VID = 0x0E6F
+USB_PID = 0x0175
+
+STATS_VENDOR_REQUEST = 0xA0
+
+# keep in sync with stat_e / stats_block_t in inc/stats.h
+COUNTERS = [
+    "fifo_write_failures",
+    "hits_accepted",
+    "hits_dropped_hold",
+    "hits_dropped_threshold",
+    "reports_sent",
+    "host_send_failures",
+    "state_transitions",
+]
+# later_counters, the block's last member - grows with stat_e, size says how many there are
+LATER_COUNTERS = [
+    "hits_dropped_crosstalk",
+    "control_dropped",
+    "host_restarts",
+    "device_recoveries",
+]
+BOOT_PHASES = ["clocks", "tud_init", "host_enumerated", "announce", "identify", "auth", "running"]
+STATES = ["NONE", "INIT", "IDENTIFYING", "AUTHENTICATING", "RUNNING", "POWER_OFF"]
+RECOVERIES = ["NONE", "HOST_STALL", "DEVICE_STALL", "WATCHDOG"]
+POLL_MODES = ["STANDARD", "FAST_PENDING", "FAST", "FALLING_BACK", "FELL_BACK"]
+
+# version, size, uptime_ms, adapter_state, fifo_high_water, later_counters_offset (v10)
+HEADER = struct.Struct("<HHIBBH")
+# v5 to v8 kept every counter in counters, in the middle of the block
+MID_BLOCK_COUNTERS = {5: 8, 6: 9, 7: 11, 8: 11}
+# the fields after counters, each with the version that added it
+SECTIONS = [
+    (1, "boot", struct.Struct("<%dI" % len(BOOT_PHASES))),
+    (2, "utilization", struct.Struct("<2H")),
+    (3, "loadgen", struct.Struct("<B3x3I")),
+    (4, "hit_latency", struct.Struct("<6I")),
+    (7, "resume", struct.Struct("<3Bx")),
+    (8, "in_poll", struct.Struct("<2B2x6I")),
+]
+LOADGEN = ["generated", "accepted", "reported"]
+HIT_LATENCY = ["count", "p50_us", "p99_us", "max_us", "budget_us", "over_budget"]
+IN_POLL = ["count", "min_us", "avg_us", "max_us", "budget_us", "over_budget"]
+
+
+def counter_names(n):
+    names = COUNTERS + LATER_COUNTERS
+    return names[:n] + ["counter_%d" % i for i in range(len(names), n)]
+
+
+def read_stats(dev):
+    # bmRequestType: IN | vendor | device
+    data = bytes(dev.ctrl_transfer(0xC0, STATS_VENDOR_REQUEST, 0, 0, 256))
+    if len(data) < HEADER.size:
+        sys.exit(f"short stats block ({len(data)} bytes)")
+    version, size, uptime_ms, state, high_water, later_offset = HEADER.unpack_from(data)
+    if version < 1:
+        sys.exit(f"unsupported stats version {version}")
+    # anything newer than this tool knows is read as far as it knows, the rest is skipped
+    size = min(size, len(data))
+    if version < 10:
+        later_offset = 0
+
+    offset = HEADER.size
+    n_counters = MID_BLOCK_COUNTERS.get(version, len(COUNTERS))
+    if offset + 4 * n_counters > size:
+        sys.exit(f"short stats block ({size} bytes)")
+    counters = list(struct.unpack_from("<%dI" % n_counters, data, offset))
+    offset += 4 * n_counters
+
+    stats = {
+        "version": version,
+        "uptime_ms": uptime_ms,
+        "state": state,
+        "fifo_high_water": high_water,
+    }
+    for introduced, name, section in SECTIONS:
+        if version < introduced or offset + section.size > size:
+            break
+        stats[name] = section.unpack_from(data, offset)
+        offset += section.size
+
+    # v9 put later_counters straight after the v8 fields, v10 on says where they are
+    if version == 9:
+        later_offset = offset
+    if later_offset:
+        n_later = max(0, size - later_offset) // 4
+        counters += struct.unpack_from("<%dI" % n_later, data, later_offset)
+    stats["counters"] = dict(zip(counter_names(len(counters)), counters))
+
+    if "boot" in stats:
+        stats["boot"] = dict(zip(BOOT_PHASES, stats["boot"]))
+    if "loadgen" in stats:
+        stats["loadgen_active"] = stats["loadgen"][0]
+        stats["loadgen"] = dict(zip(LOADGEN, stats["loadgen"][1:]))
+    if "hit_latency" in stats:
+        stats["hit_latency"] = dict(zip(HIT_LATENCY, stats["hit_latency"]))
+    if "resume" in stats:
+        stats["resume"] = dict(zip(("reason", "state", "reboots"), stats["resume"]))
+    if "in_poll" in stats:
+        stats["poll_mode"], stats["poll_interval_ms"] = stats["in_poll"][:2]
+        stats["in_poll"] = dict(zip(IN_POLL, stats["in_poll"][2:]))
+    return stats
+
+
+def print_stats(stats):
+    state = stats["state"]
+    print(f"uptime           {stats['uptime_ms'] / 1000:.1f}s")
+    print(f"adapter_state    {STATES[state] if state < len(STATES) else state}")
+    print(f"fifo_high_water  {stats['fifo_high_water']}")
+    resume = stats.get("resume")
+    if resume and resume["reboots"]:
+        reason, state = resume["reason"], resume["state"]
+        print(f"supervised reboots {resume['reboots']}, last "
+              f"{RECOVERIES[reason] if reason < len(RECOVERIES) else reason} while "
+              f"{STATES[state] if state < len(STATES) else state}")
+    for core, permille in enumerate(stats.get("utilization", ())):
+        print(f"core{core}_utilization {permille / 10:.1f}%")
+    for name, value in stats["counters"].items():
+        print(f"{name:<24} {value}")
+    print("boot phases (ms since boot):")
+    for name, us in stats.get("boot", {}).items():
+        print(f"  {name:<16} {us / 1000:.1f}" if us else f"  {name:<16} --")
+    latency = stats.get("hit_latency")
+    if latency and latency["count"]:
+        print(f"hit to report latency (budget {latency['budget_us'] / 1000:.1f}ms):")
+        for name in ("p50_us", "p99_us", "max_us"):
+            print(f"  {name[:-3]:<16} {latency[name] / 1000:.2f}ms")
+        print(f"  {'over_budget':<16} {latency['over_budget']} of {latency['count']}")
+    poll = stats.get("in_poll")
+    if poll:
+        mode = stats["poll_mode"]
+        print(f"IN polling {POLL_MODES[mode] if mode < len(POLL_MODES) else mode}, "
+              f"asked for every {stats['poll_interval_ms']}ms")
+    if poll and poll["count"]:
+        print(f"  measured         {poll['avg_us'] / 1000:.3f}ms avg "
+              f"({poll['min_us'] / 1000:.2f}-{poll['max_us'] / 1000:.2f}ms), "
+              f"{poll['over_budget']} of {poll['count']} over {poll['budget_us'] / 1000:.1f}ms")
+    loadgen = stats.get("loadgen")
+    if loadgen and (stats["loadgen_active"] or loadgen["generated"]):
+        print(f"load generator ({'running' if stats['loadgen_active'] else 'stopped'}):")
+        for name, value in loadgen.items():
+            print(f"  {name:<16} {value}")
+        if loadgen["generated"]:
+            print(f"  {'dropped':<16} "
+                  f"{100 * (1 - loadgen['reported'] / loadgen['generated']):.2f}%")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--watch", type=float, metavar="SECONDS",
+                        help="keep polling at this interval")
+    args = parser.parse_args()
+
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        sys.exit("adapter not found")
+
+    while True:
+        print_stats(read_stats(dev))
+        if not args.watch:
+            break
+        time.sleep(args.watch)
+        print()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""Decode the binary event trace (inc/trace.h) from the debug uart into a timeline.
+
+    stty -F /dev/ttyUSB0 921600 raw && ./trace_decode.py /dev/ttyUSB0
+    ./trace_decode.py capture.bin
+    ./trace_decode.py --costs capture.bin   # per command handling cost instead of a timeline
+"""
+
+import argparse
+import collections
+import struct
+import sys
+
+TRACE_SYNC = 0xA5
+RECORD = struct.Struct("<BBBBIII")
+# per core, see src/trace.c - the drain can't be holding back more than a ring's worth of one core's
+# records while it sends the other's, so this deep a queue means the other core has nothing older
+TRACE_RING_SIZE = 256
+HOLDBACK = 2 * TRACE_RING_SIZE
+
+# keep in sync with trace_event_e in inc/trace.h
+EVENT_NAMES = [
+    "NONE",
+    "STATE",
+    "XBOXD_RX",
+    "XBOXD_TX_START",
+    "XBOXD_TX_DONE",
+    "XBOXH_RX",
+    "XBOXH_TX",
+    "NOTE_ON",
+    "NOTE_OFF",
+    "DRUM_REPORT",
+    "FIFO_FULL",
+    "INSTRUMENT",
+    "POWER",
+    "LOADGEN_HIT",
+    "XBOXD_HANDLED",
+    "XBOXH_HANDLED",
+    "CROSSTALK",
+    "RECOVERY",
+    "HIT_DROPPED",
+]
+
+STATES = ["NONE", "INIT", "IDENTIFYING", "AUTHENTICATING", "RUNNING", "POWER_OFF"]
+RECOVERIES = ["NONE", "HOST_STALL", "DEVICE_STALL", "WATCHDOG"]
+HIT_DROPS = ["THRESHOLD", "UNMAPPED", "HOLD"]
+INSTRUMENTS = ["GUITAR_ONE", "GUITAR_TWO", "DRUMS"]
+OUTPUTS = ["KICK", "DOUBLE_KICK", "PAD_RED", "PAD_YELLOW", "PAD_BLUE", "PAD_GREEN", "CYM_YELLOW",
+           "CYM_BLUE", "CYM_GREEN"]
+
+
+def lookup(table, index):
+    return table[index] if index < len(table) else str(index)
+
+
+def describe(event, arg0, arg1):
+    if event == "STATE":
+        return lookup(STATES, arg0)
+    if event in ("XBOXD_RX", "XBOXD_TX_START", "XBOXD_TX_DONE", "XBOXH_RX", "XBOXH_TX"):
+        return f"cmd=0x{arg0:02x} len={arg1}"
+    if event == "NOTE_ON":
+        return f"note={arg0} velocity={arg1 & 0xff} {lookup(OUTPUTS, arg1 >> 8)}"
+    if event == "NOTE_OFF":
+        return lookup(OUTPUTS, arg0)
+    if event == "DRUM_REPORT":
+        return f"seq={arg0}"
+    if event == "FIFO_FULL":
+        return f"cmd=0x{arg0:02x}"
+    if event == "INSTRUMENT":
+        return f"{lookup(INSTRUMENTS, arg0)} {'connected' if arg1 else 'disconnected'}"
+    if event == "POWER":
+        return "sleep" if arg0 else "wake"
+    if event == "LOADGEN_HIT":
+        return f"note={arg0} pad={arg1}"
+    if event in ("XBOXD_HANDLED", "XBOXH_HANDLED"):
+        return f"cmd=0x{arg0:02x} {arg1}us"
+    if event == "CROSSTALK":
+        return f"note={arg0} masked by {lookup(OUTPUTS, arg1)}"
+    if event == "RECOVERY":
+        return f"{lookup(RECOVERIES, arg0)} ({arg1} earlier in window)"
+    if event == "HIT_DROPPED":
+        return f"note={arg0} {lookup(HIT_DROPS, arg1)}"
+    return f"{arg0} {arg1}"
+
+
+def records(stream):
+    buf = b""
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        buf += chunk
+        while len(buf) >= RECORD.size:
+            sync, event, core, seq, time_us, arg0, arg1 = RECORD.unpack_from(buf)
+            # resync a byte at a time on anything that can't be a record
+            if sync != TRACE_SYNC or event >= len(EVENT_NAMES) or core > 1:
+                buf = buf[1:]
+                continue
+            buf = buf[RECORD.size:]
+            yield core, seq, time_us, EVENT_NAMES[event], arg0, arg1
+
+
+# time_us is a free running 32 bit counter, unwrapped against the same core's last record - the
+# drain sends each core's ring in turn, up to TRACE_RING_SIZE records at a time, so across cores the
+# time goes backwards at every switch
+class CoreClock:
+    def __init__(self):
+        self.last = None
+        self.wraps = 0
+
+    def unwrap(self, time_us):
+        if self.last is not None and time_us < self.last and self.last - time_us > (1 << 31):
+            self.wraps += 1
+        self.last = time_us
+        return (self.wraps << 32) + time_us
+
+
+# both cores' records merged back into time order. each core's come out of the drain in order, so
+# it's a merge of two sorted streams - a record waits until the other core has one at least as
+# late, or, when the other core's gone quiet, until HOLDBACK records are waiting behind it
+class Timeline:
+    def __init__(self):
+        self.clocks = [CoreClock(), CoreClock()]
+        self.sequence = [None, None]
+        self.pending = [collections.deque(), collections.deque()]
+        self.start = None
+
+    def dropped(self, core, seq):
+        previous = self.sequence[core]
+        self.sequence[core] = seq
+        if previous is None:
+            return 0
+        return (seq - previous - 1) & 0xFF
+
+    def add(self, core, seq, time_us, event, arg0, arg1):
+        dropped = self.dropped(core, seq)
+        absolute = self.clocks[core].unwrap(time_us)
+        self.pending[core].append((absolute, core, dropped, event, arg0, arg1))
+
+    # (ms since the first record, core, records dropped before it, event, arg0, arg1) for every
+    # record that's safe to put in order, everything left with flush
+    def ready(self, flush=False):
+        core0, core1 = self.pending
+        while core0 or core1:
+            if core0 and core1:
+                queue = core0 if core0[0][0] <= core1[0][0] else core1
+            elif flush or len(core0 or core1) > HOLDBACK:
+                queue = core0 or core1
+            else:
+                return
+            absolute, core, dropped, event, arg0, arg1 = queue.popleft()
+            if self.start is None:
+                self.start = absolute
+            yield (absolute - self.start) / 1000, core, dropped, event, arg0, arg1
+
+
+class Costs:
+    def __init__(self):
+        self.samples = {}
+
+    def add(self, event, command, us):
+        self.samples.setdefault((event, command), []).append(us)
+
+    def print(self):
+        print(f"{'event':<15} {'cmd':>4} {'count':>7} {'mean':>8} {'p99':>6} {'max':>6}  (us)")
+        for (event, command), samples in sorted(self.samples.items()):
+            samples.sort()
+            p99 = samples[min(len(samples) - 1, len(samples) * 99 // 100)]
+            print(f"{event:<15} 0x{command:02x} {len(samples):>7} "
+                  f"{sum(samples) / len(samples):>8.1f} {p99:>6} {samples[-1]:>6}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="capture file or tty, stdin if omitted")
+    parser.add_argument("--costs", action="store_true",
+                        help="summarize *_HANDLED records per command instead")
+    args = parser.parse_args()
+
+    stream = open(args.input, "rb", buffering=0) if args.input else sys.stdin.buffer
+    timeline = Timeline()
+    costs = Costs()
+
+    def print_ready(flush=False):
+        for at, core, dropped, event, arg0, arg1 in timeline.ready(flush):
+            if dropped:
+                print(f"{'':>12}  core{core}  ** {dropped} records dropped **")
+            print(f"{at:12.3f}  core{core}  {event:<15} {describe(event, arg0, arg1)}")
+
+    try:
+        for core, seq, time_us, event, arg0, arg1 in records(stream):
+            if args.costs:
+                if event.endswith("_HANDLED"):
+                    costs.add(event, arg0, arg1)
+                continue
+            timeline.add(core, seq, time_us, event, arg0, arg1)
+            print_ready()
+    except KeyboardInterrupt:
+        pass
+    print_ready(flush=True)
+    if args.costs:
+        costs.print()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+"""Replay the console's side of a usbmon capture against an adapter and diff what comes back.
+
+Takes a pcap of a console <-> adapter session captured with usbmon (wireshark/tcpdump on a
+usbmonN interface, link type 189 or 220), pulls out the frames the console sent the adapter's OUT
+endpoint and sends them again in order. Everything the adapter answers on its IN endpoint is
+compared with what it answered in the capture, command by command with sequence numbers masked.
+
+    ./usb_replay.py session.pcap --device 1:7
+    ./usb_replay.py session.pcap --device 1:7 --realtime --golden-out golden.txt
+
+Per packet host side round trips are printed per command. For the adapter's own handling cost,
+capture the trace uart while replaying and run trace_decode.py --costs over it - every handled
+frame is traced with the time it took.
+
+Without an adapter, --session-out writes the capture out as a session for the host build's replay
+(test/replay.c), which plays it through the firmware with a controller and kit on the host port
+and diffs what comes out against a golden trace:
+
+    ./usb_replay.py session.pcap --device 1:7 --session-out session.txt
+    build-host/replay session.txt --golden-out golden.txt
+
+Controller reports and kit input aren't in a console side capture, add them to the session by hand
+(`<time_us> controller <idx> <hex>`, `<time_us> kit <hex>`, see replay.c) to have them replayed.
+
+Needs pyusb (libusb) and access to the device, e.g. run as root or add a udev rule for 0e6f:0175.
+Start from a freshly plugged adapter so it's in the same state the capture started in.
+"""
+
+import argparse
+import statistics
+import struct
+import sys
+import time
+
+# only needed to replay against an adapter, --session-out works without it
+try:
+    import usb.core
+    import usb.util
+except ImportError:
+    usb = None
+
+USB_VID = 0x0E6F
+USB_PID = 0x0175
+
+LINKTYPE_USB_LINUX = 189
+LINKTYPE_USB_LINUX_MMAPPED = 220
+
+# struct usbmon_packet, the mmapped variant has 16 more bytes of iso bookkeeping after it
+USBMON = struct.Struct("<QBBBBHBBqiiII8s")
+XFER_INTERRUPT = 1
+XFER_BULK = 3
+
+
+def pcap_packets(path):
+    with open(path, "rb") as f:
+        header = f.read(24)
+        magic = struct.unpack_from("<I", header)[0]
+        if magic in (0xA1B2C3D4, 0xA1B23C4D):
+            endian = "<"
+        elif magic in (0xD4C3B2A1, 0x4D3CB2A1):
+            endian = ">"
+        else:
+            sys.exit("not a pcap file (pcapng isn't supported, convert it with editcap -F pcap)")
+        linktype = struct.unpack_from(endian + "I", header, 20)[0]
+        if linktype not in (LINKTYPE_USB_LINUX, LINKTYPE_USB_LINUX_MMAPPED):
+            sys.exit(f"link type {linktype} isn't a usbmon capture")
+        usbmon_size = USBMON.size + (16 if linktype == LINKTYPE_USB_LINUX_MMAPPED else 0)
+
+        while True:
+            record = f.read(16)
+            if len(record) < 16:
+                return
+            _, _, incl_len, _ = struct.unpack(endian + "IIII", record)
+            data = f.read(incl_len)
+            if len(data) < usbmon_size:
+                continue
+            # usbmon headers are always host endian, which for anything we capture on is little
+            (_, event, xfer_type, epnum, devnum, busnum, _, _, ts_sec, ts_usec, _, _, _,
+             _) = USBMON.unpack_from(data)
+            yield (chr(event), xfer_type, epnum, devnum, busnum, ts_sec + ts_usec / 1e6,
+                   data[usbmon_size:])
+
+
+# OUT frames are taken at submit, IN frames at completion - that's when each carries its data
+def load_session(path, bus, device):
+    session = []
+    for event, xfer_type, epnum, devnum, busnum, at, payload in pcap_packets(path):
+        if (busnum, devnum) != (bus, device) or xfer_type not in (XFER_INTERRUPT, XFER_BULK):
+            continue
+        if not payload:
+            continue
+        is_in = bool(epnum & 0x80)
+        if is_in and event == "C":
+            session.append(("in", at, payload))
+        elif not is_in and event == "S":
+            session.append(("out", at, payload))
+    return session
+
+
+def masked(frame):
+    # byte 2 is the frame sequence, which depends on everything the adapter sent before
+    return frame[:2] + frame[3:]
+
+
+# the session starts with the console connecting, the usb kit and a controller on the host port -
+# the capture's first frame, the adapter's announce, is lined up with the controller mounting
+SESSION_CONTROLLER_US = 100000
+
+
+def write_session(path, session):
+    first_us = round(session[0][1] * 1e6)
+    with open(path, "w") as f:
+        f.write("# converted from a usbmon capture by usb_replay.py --session-out\n")
+        f.write("0 connect 250\n0 plug kit\n")
+        f.write(f"{SESSION_CONTROLLER_US} plug 0\n")
+        for direction, at, payload in session:
+            if direction == "out":
+                us = SESSION_CONTROLLER_US + round(at * 1e6) - first_us
+                f.write(f"{us} console {payload.hex()}\n")
+
+
+def find_endpoint(itf, direction):
+    return usb.util.find_descriptor(
+        itf, custom_match=lambda ep: usb.util.endpoint_direction(ep.bEndpointAddress) == direction)
+
+
+def replay(dev, session, realtime, settle_ms):
+    if dev.is_kernel_driver_active(0):
+        dev.detach_kernel_driver(0)
+    dev.set_configuration()
+    itf = dev.get_active_configuration()[(0, 0)]
+    ep_in = find_endpoint(itf, usb.util.ENDPOINT_IN)
+    ep_out = find_endpoint(itf, usb.util.ENDPOINT_OUT)
+
+    received = []
+    round_trips = {}
+
+    def drain(timeout_ms, sent=None):
+        deadline = time.perf_counter() + timeout_ms / 1000
+        while True:
+            remaining = int((deadline - time.perf_counter()) * 1000)
+            if remaining <= 0:
+                return
+            try:
+                frame = bytes(ep_in.read(64, remaining))
+            except usb.core.USBTimeoutError:
+                return
+            at = time.perf_counter()
+            received.append(frame)
+            if sent is not None:
+                command, sent_at = sent
+                round_trips.setdefault(command, []).append(at - sent_at)
+                sent = None
+
+    outs = [(at, payload) for direction, at, payload in session if direction == "out"]
+    start = time.perf_counter()
+    for at, payload in outs:
+        if realtime:
+            wait = (at - outs[0][0]) - (time.perf_counter() - start)
+            if wait > 0:
+                drain(wait * 1000)
+        ep_out.write(payload)
+        drain(settle_ms, (payload[0], time.perf_counter()))
+    drain(settle_ms * 10)
+    return received, round_trips
+
+
+def compare(golden, received):
+    mismatches = 0
+    for i in range(max(len(golden), len(received))):
+        want = golden[i] if i < len(golden) else None
+        got = received[i] if i < len(received) else None
+        if want is not None and got is not None and masked(want) == masked(got):
+            continue
+        mismatches += 1
+        print(f"#{i}: want {want.hex() if want else '--'}")
+        print(f"{'':>{len(str(i)) + 2}} got  {got.hex() if got else '--'}")
+    return mismatches
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", help="usbmon pcap of a console session")
+    parser.add_argument("--device", required=True, metavar="BUS:ADDR",
+                        help="the adapter's bus and address in the capture (lsusb at capture time)")
+    parser.add_argument("--realtime", action="store_true",
+                        help="keep the capture's spacing instead of sending back to back")
+    parser.add_argument("--settle", type=int, default=20, metavar="MS",
+                        help="how long to collect replies after each frame")
+    parser.add_argument("--golden-out", metavar="FILE",
+                        help="also write the captured IN frames out, one hex frame per line")
+    parser.add_argument("--session-out", metavar="FILE",
+                        help="write a session for test/replay.c instead of replaying to an adapter")
+    args = parser.parse_args()
+
+    bus, _, addr = args.device.partition(":")
+    session = load_session(args.capture, int(bus), int(addr))
+    golden = [payload for direction, _, payload in session if direction == "in"]
+    if not any(direction == "out" for direction, _, _ in session):
+        sys.exit("no OUT frames for that device in the capture")
+    if args.golden_out:
+        with open(args.golden_out, "w") as f:
+            f.writelines(frame.hex() + "\n" for frame in golden)
+    if args.session_out:
+        write_session(args.session_out, session)
+        return
+
+    if usb is None:
+        sys.exit("replaying to an adapter needs pyusb")
+    dev = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if dev is None:
+        sys.exit("adapter not found")
+    received, round_trips = replay(dev, session, args.realtime, args.settle)
+
+    print(f"{'cmd':>4} {'count':>6} {'median':>8} {'max':>8}  (ms, host side round trip)")
+    for command, samples in sorted(round_trips.items()):
+        ms = [s * 1000 for s in samples]
+        print(f"0x{command:02x} {len(ms):>6} {statistics.median(ms):>8.2f} {max(ms):>8.2f}")
+
+    mismatches = compare(golden, received)
+    print(f"{len(received)} frames back, {len(golden)} in the capture, {mismatches} differ")
+    sys.exit(1 if mismatches else 0)
+
+
+if __name__ == "__main__":
+    main()